@@ -63,4 +63,10 @@ typedef enum {
     LLAISYS_MEMCPY_D2D = 3,
 } llaisysMemcpyKind_t;
 
+// Device Memory Allocators
+typedef enum {
+    LLAISYS_ALLOCATOR_NAIVE = 0,
+    LLAISYS_ALLOCATOR_CACHING = 1,
+} llaisysAllocatorType_t;
+
 #endif // __LLAISYS_H__
@@ -29,14 +29,136 @@ __C {
         llaisysTensor_t *mlp_down_w;
     };
 
+    struct LlaisysQwen2SamplingParams {
+        float temperature; // <= 0 picks the most likely token
+        size_t top_k;      // 0 keeps every token, 1 is greedy
+        float top_p;       // nucleus mass kept, in (0, 1]
+        uint64_t seed;
+        // Penalties on tokens already in the sequence, prompt included:
+        // positive logits are divided and negative ones multiplied by
+        // repetition_penalty (1, or 0, is off), and presence_penalty is
+        // subtracted from all of them (0 is off).
+        float repetition_penalty;
+        float presence_penalty;
+    };
+
+    // Tokens proposed and kept by one speculative generation, and the number
+    // of verifying forward steps; accepted / drafted is the acceptance rate.
+    struct LlaisysQwen2SpeculativeStats {
+        size_t drafted;
+        size_t accepted;
+        size_t steps;
+    };
+
+    // Called for every generated token; a nonzero return stops generation.
+    typedef int (*llaisysQwen2TokenCallback)(int64_t token, void *user_data);
+
     struct LlaisysQwen2Model;
 
-    __export struct LlaisysQwen2Model *llaisysQwen2ModelCreate(const LlaisysQwen2Meta *meta, llaisysDeviceType_t device, int *device_ids, int ndevice);
+    // kv_tokens is the capacity of the KV cache shared by all sequences, in
+    // tokens (0 means meta->maxseq); maxseq bounds each sequence.
+    __export struct LlaisysQwen2Model *llaisysQwen2ModelCreate(const LlaisysQwen2Meta *meta, llaisysDeviceType_t device, int *device_ids, int ndevice,
+                                                               size_t kv_tokens);
 
     __export void llaisysQwen2ModelDestroy(struct LlaisysQwen2Model * model);
 
     __export struct LlaisysQwen2Weights *llaisysQwen2ModelWeights(struct LlaisysQwen2Model * model);
 
+    // Once the weights are loaded, replaces the projection matrices and
+    // out_embed with int8 copies and f32 scales, one per output channel if
+    // group_size is 0 and one per group_size input columns otherwise;
+    // group_size must then divide every matrix width and be a multiple of 32.
+    // The handles in the weights struct refer to the int8 tensors afterwards.
+    __export void llaisysQwen2ModelQuantizeInt8(struct LlaisysQwen2Model * model, size_t group_size);
+
+    // Starts a new sequence: the next Infer call begins at position 0.
+    __export void llaisysQwen2ModelReset(struct LlaisysQwen2Model * model);
+
+    // Appends ntoken tokens to the current sequence and returns the argmax next
+    // token, or -1 without appending anything if the KV cache cannot hold them.
     __export int64_t llaisysQwen2ModelInfer(struct LlaisysQwen2Model * model, int64_t * token_ids, size_t ntoken);
+
+    // Appends the prompt to the current sequence, then samples up to
+    // max_new_tokens tokens, stopping after end_token, when the KV cache is
+    // full, or when the callback (may be NULL) asks to. Generated tokens are stored to out_tokens if it is
+    // not NULL; returns how many were generated.
+    __export size_t llaisysQwen2ModelGenerate(struct LlaisysQwen2Model * model, int64_t * token_ids, size_t ntoken,
+                                              size_t max_new_tokens, const struct LlaisysQwen2SamplingParams *sampling,
+                                              llaisysQwen2TokenCallback callback, void *user_data, int64_t *out_tokens);
+
+    // Generate with speculative decoding: every step checks up to num_draft
+    // guessed tokens at once and keeps those the sampler confirms, so the
+    // output follows the same distribution as Generate. Guesses come from
+    // greedy decoding with draft_model, which must share the vocabulary, or
+    // from prompt lookup in the tokens so far if draft_model is NULL. stats
+    // may be NULL.
+    __export size_t llaisysQwen2ModelGenerateSpeculative(struct LlaisysQwen2Model * model, struct LlaisysQwen2Model * draft_model,
+                                                         int64_t * token_ids, size_t ntoken, size_t max_new_tokens, size_t num_draft,
+                                                         const struct LlaisysQwen2SamplingParams *sampling,
+                                                         llaisysQwen2TokenCallback callback, void *user_data, int64_t *out_tokens,
+                                                         struct LlaisysQwen2SpeculativeStats *stats);
+
+    // Samples n continuations of one prompt with a single prefill; sample i
+    // uses seed sampling->seed + i. Its tokens are stored to
+    // out_tokens[i * max_new_tokens ...] and their count to out_lengths[i].
+    __export void llaisysQwen2ModelGenerateN(struct LlaisysQwen2Model * model, const int64_t *token_ids, size_t ntoken, size_t n,
+                                             size_t max_new_tokens, const struct LlaisysQwen2SamplingParams *sampling,
+                                             int64_t *out_tokens, size_t *out_lengths);
+
+    // Beam search over beam_width forks of the prompt. Stores the hypothesis
+    // with the best log-probability per token to out_tokens (room for
+    // max_new_tokens) and returns its length.
+    __export size_t llaisysQwen2ModelBeamSearch(struct LlaisysQwen2Model * model, const int64_t *token_ids, size_t ntoken,
+                                                size_t beam_width, size_t max_new_tokens, int64_t *out_tokens);
+
+    // Continuous batching: independent sequences sharing the model's KV cache.
+    __export int64_t llaisysQwen2ModelCreateSequence(struct LlaisysQwen2Model * model);
+
+    __export void llaisysQwen2ModelReleaseSequence(struct LlaisysQwen2Model * model, int64_t seq);
+
+    // A new sequence continuing from seq. The two share KV blocks until they
+    // diverge; only the partially filled last block is ever copied.
+    __export int64_t llaisysQwen2ModelForkSequence(struct LlaisysQwen2Model * model, int64_t seq);
+
+    // Tokens the KV cache can still take across all sequences.
+    __export size_t llaisysQwen2ModelFreeKVTokens(struct LlaisysQwen2Model * model);
+
+    // One forward step over nseq distinct sequences: sequence seq_ids[i]
+    // appends ntokens[i] tokens (token_ids holds them back to back) and
+    // out_tokens[i] receives its next token, sampled with sampling[i] (greedy
+    // if sampling is NULL). Returns 0 without running anything if the KV cache
+    // cannot hold the new tokens, 1 otherwise.
+    __export uint8_t llaisysQwen2ModelStep(struct LlaisysQwen2Model * model, const int64_t *seq_ids, size_t nseq,
+                                           const int64_t *token_ids, const size_t *ntokens,
+                                           const struct LlaisysQwen2SamplingParams *sampling, int64_t *out_tokens);
+
+    // Prefix caching, on by default: prompts reuse the KV blocks of earlier
+    // prompts that share their prefix. Disabling it drops the cached blocks.
+    __export void llaisysQwen2ModelSetPrefixCaching(struct LlaisysQwen2Model * model, uint8_t enabled);
+
+    // Request scheduling on top of Step. Submitted prompts are prefilled in
+    // chunks that share each step with the decodes of running requests.
+    // Returns the request id; sampling may be NULL for greedy decoding.
+    __export int64_t llaisysQwen2ModelSubmit(struct LlaisysQwen2Model * model, const int64_t *token_ids, size_t ntoken,
+                                             size_t max_new_tokens, const struct LlaisysQwen2SamplingParams *sampling);
+
+    __export void llaisysQwen2ModelCancel(struct LlaisysQwen2Model * model, int64_t request);
+
+    // Submitted requests that have not finished.
+    __export size_t llaisysQwen2ModelPending(struct LlaisysQwen2Model * model);
+
+    // Token budget of a scheduled step, shared by decodes and prompt chunks.
+    __export void llaisysQwen2ModelSetChunkTokens(struct LlaisysQwen2Model * model, size_t ntoken);
+
+    // Runs one scheduled step. Entry i of the outputs tells that request
+    // out_requests[i] produced out_tokens[i], and whether it has finished;
+    // they need room for one entry per pending request. Returns the number of
+    // entries.
+    __export size_t llaisysQwen2ModelScheduleStep(struct LlaisysQwen2Model * model, int64_t *out_requests, int64_t *out_tokens,
+                                                  uint8_t *out_finished);
+
+    // Bytes of the activation arena used by a forward step of up to
+    // max_tokens tokens over up to max_seqs sequences.
+    __export size_t llaisysQwen2ActivationBytes(const LlaisysQwen2Meta *meta, size_t max_tokens, size_t max_seqs);
 }
 #endif // LLAISYS_MODELS_QWEN2_H
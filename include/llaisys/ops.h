@@ -8,10 +8,29 @@ __C {
     __export void llaisysArgmax(llaisysTensor_t max_idx, llaisysTensor_t max_val, llaisysTensor_t vals);
     __export void llaisysEmbedding(llaisysTensor_t out, llaisysTensor_t index, llaisysTensor_t weight);
     __export void llaisysLinear(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t bias);
+    // out = in * weight^T + bias + residual; bias may be NULL, residual may be out.
+    __export void llaisysLinearResidual(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t bias, llaisysTensor_t residual);
+    // Linear with an int8 weight and its f32 scales from llaisysQuantize; bias and residual may be NULL.
+    __export void llaisysLinearInt8(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t scales, llaisysTensor_t bias, llaisysTensor_t residual);
+    // out = swiglu(gate, up) with the gate rows followed by the up rows in gate_up_weight; gate_up_bias may be NULL.
+    __export void llaisysLinearSwiGLU(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t gate_up_weight, llaisysTensor_t gate_up_bias);
+    __export void llaisysLinearSwiGLUInt8(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t gate_up_weight, llaisysTensor_t gate_up_scales, llaisysTensor_t gate_up_bias);
+    __export void llaisysLmHeadTopk(llaisysTensor_t top_idx, llaisysTensor_t top_val, llaisysTensor_t hidden, llaisysTensor_t norm_w, llaisysTensor_t out_embed, float eps);
+    // qkv_bias may be NULL; k_cache and v_cache rows slots[i] receive token i.
+    __export void llaisysQKVRope(llaisysTensor_t q, llaisysTensor_t k_cache, llaisysTensor_t v_cache, llaisysTensor_t in, llaisysTensor_t qkv_weight, llaisysTensor_t qkv_bias, llaisysTensor_t pos_ids, llaisysTensor_t slots, float theta);
+    // Symmetric int8 quantization of a [n, k] weight into out and f32 scales [n, groups].
+    __export void llaisysQuantize(llaisysTensor_t out, llaisysTensor_t scales, llaisysTensor_t in);
     __export void llaisysRearrange(llaisysTensor_t out, llaisysTensor_t in);
     __export void llaisysRmsNorm(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, float eps);
+    // residual += in, then out = rms_norm(residual).
+    __export void llaisysAddRmsNorm(llaisysTensor_t out, llaisysTensor_t residual, llaisysTensor_t in, llaisysTensor_t weight, float eps);
     __export void llaisysROPE(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t pos_ids, float theta);
+    // ids and prev_tokens may be NULL; see the C++ op for the semantics.
+    __export void llaisysSample(llaisysTensor_t out_idx, llaisysTensor_t logits, llaisysTensor_t ids, llaisysTensor_t prev_tokens, float temperature, size_t top_k, float top_p, float repetition_penalty, float presence_penalty, uint64_t seed);
     __export void llaisysSelfAttention(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k, llaisysTensor_t v, float scale);
+    __export void llaisysPagedAttention(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k_cache, llaisysTensor_t v_cache, llaisysTensor_t block_table, size_t total_len, float scale);
+    __export void llaisysPagedVarlenAttention(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k_cache, llaisysTensor_t v_cache, llaisysTensor_t block_tables, llaisysTensor_t cu_seqlens_q, llaisysTensor_t kv_lens, float scale);
+    __export void llaisysVarlenAttention(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k, llaisysTensor_t v, llaisysTensor_t cu_seqlens_q, llaisysTensor_t cu_seqlens_k, float scale);
     __export void llaisysSwiGLU(llaisysTensor_t out, llaisysTensor_t gate, llaisysTensor_t up);
 }
 
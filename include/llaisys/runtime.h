@@ -42,6 +42,21 @@ __C {
 
     // Llaisys API for switching device context
     __export void llaisysSetContextRuntime(llaisysDeviceType_t, int);
+
+    // Llaisys API for choosing the device allocator of the context runtime (cache_limit 0 means unlimited)
+    __export void llaisysSetContextAllocator(llaisysAllocatorType_t, size_t cache_limit);
+
+    // Llaisys API for returning cached device memory of the context runtime
+    __export void llaisysEmptyCache();
+
+    // Llaisys API for the bytes of live allocations and the bytes held from the device (including the cache) by the
+    // allocator of the context runtime; allocators other than the caching one report 0
+    __export size_t llaisysMemoryAllocated();
+    __export size_t llaisysMemoryReserved();
+
+    // Llaisys API for sizing the CPU thread pool shared by all kernels (0 means one thread per core)
+    __export void llaisysSetNumThreads(size_t);
+    __export size_t llaisysGetNumThreads();
 }
 
 #endif // LLAISYS_RUNTIME_H
@@ -8,10 +8,15 @@ from .runtime import LlaisysRuntimeAPI
 from .llaisys_types import llaisysDeviceType_t, DeviceType
 from .llaisys_types import llaisysDataType_t, DataType
 from .llaisys_types import llaisysMemcpyKind_t, MemcpyKind
+from .llaisys_types import llaisysAllocatorType_t, AllocatorType
 from .llaisys_types import llaisysStream_t
 from .tensor import llaisysTensor_t
 from .tensor import load_tensor
 from .ops import load_ops
+from .qwen2 import load_qwen2
+from .qwen2 import LlaisysQwen2Meta, LlaisysQwen2Weights, llaisysQwen2Model_t
+from .qwen2 import LlaisysQwen2SamplingParams, llaisysQwen2TokenCallback
+from .qwen2 import LlaisysQwen2SpeculativeStats
 
 
 def load_shared_library():
@@ -38,6 +43,7 @@ LIB_LLAISYS = load_shared_library()
 load_runtime(LIB_LLAISYS)
 load_tensor(LIB_LLAISYS)
 load_ops(LIB_LLAISYS)
+load_qwen2(LIB_LLAISYS)
 
 
 __all__ = [
@@ -51,5 +57,13 @@ __all__ = [
     "DeviceType",
     "llaisysMemcpyKind_t",
     "MemcpyKind",
+    "llaisysAllocatorType_t",
+    "AllocatorType",
     "llaisysStream_t",
+    "LlaisysQwen2Meta",
+    "LlaisysQwen2Weights",
+    "llaisysQwen2Model_t",
+    "LlaisysQwen2SamplingParams",
+    "llaisysQwen2TokenCallback",
+    "LlaisysQwen2SpeculativeStats",
 ]
@@ -49,6 +49,14 @@ class MemcpyKind(IntEnum):
 
 llaisysMemcpyKind_t = ctypes.c_int
 
+# Device Memory Allocator enum
+class AllocatorType(IntEnum):
+    NAIVE = 0
+    CACHING = 1
+
+
+llaisysAllocatorType_t = ctypes.c_int
+
 # Stream type (opaque pointer)
 llaisysStream_t = ctypes.c_void_p
 
@@ -59,5 +67,7 @@ __all__ = [
     "DataType",
     "llaisysMemcpyKind_t",
     "MemcpyKind",
+    "llaisysAllocatorType_t",
+    "AllocatorType",
     "llaisysStream_t",
 ]
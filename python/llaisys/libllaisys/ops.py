@@ -1,5 +1,5 @@
 from .tensor import llaisysTensor_t
-from ctypes import c_float
+from ctypes import c_float, c_size_t, c_uint64
 
 def load_ops(lib):
     lib.llaisysAdd.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
@@ -14,15 +14,70 @@ def load_ops(lib):
     lib.llaisysLinear.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
     lib.llaisysLinear.restype = None
 
+    lib.llaisysLinearResidual.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
+    lib.llaisysLinearResidual.restype = None
+
+    lib.llaisysLinearInt8.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
+    lib.llaisysLinearInt8.restype = None
+
+    lib.llaisysLinearSwiGLU.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
+    lib.llaisysLinearSwiGLU.restype = None
+
+    lib.llaisysLinearSwiGLUInt8.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
+    lib.llaisysLinearSwiGLUInt8.restype = None
+
+    lib.llaisysLmHeadTopk.argtypes = [
+        llaisysTensor_t,  # top_idx
+        llaisysTensor_t,  # top_val
+        llaisysTensor_t,  # hidden
+        llaisysTensor_t,  # norm_w
+        llaisysTensor_t,  # out_embed
+        c_float    # eps
+    ]
+    lib.llaisysLmHeadTopk.restype = None
+
+    lib.llaisysQKVRope.argtypes = [
+        llaisysTensor_t,  # q
+        llaisysTensor_t,  # k_cache
+        llaisysTensor_t,  # v_cache
+        llaisysTensor_t,  # in
+        llaisysTensor_t,  # qkv_weight
+        llaisysTensor_t,  # qkv_bias
+        llaisysTensor_t,  # pos_ids
+        llaisysTensor_t,  # slots
+        c_float,  # theta
+    ]
+    lib.llaisysQKVRope.restype = None
+
+    lib.llaisysQuantize.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
+    lib.llaisysQuantize.restype = None
+
     lib.llaisysRearrange.argtypes = [llaisysTensor_t, llaisysTensor_t]
     lib.llaisysRearrange.restype = None
 
     lib.llaisysRmsNorm.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, c_float]
     lib.llaisysRmsNorm.restype = None
 
+    lib.llaisysAddRmsNorm.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, c_float]
+    lib.llaisysAddRmsNorm.restype = None
+
     lib.llaisysROPE.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t, c_float]
     lib.llaisysROPE.restype = None
 
+    lib.llaisysSample.argtypes = [
+        llaisysTensor_t,  # out_idx
+        llaisysTensor_t,  # logits
+        llaisysTensor_t,  # ids
+        llaisysTensor_t,  # prev_tokens
+        c_float,  # temperature
+        c_size_t,  # top_k
+        c_float,  # top_p
+        c_float,  # repetition_penalty
+        c_float,  # presence_penalty
+        c_uint64  # seed
+    ]
+    lib.llaisysSample.restype = None
+
     lib.llaisysSelfAttention.argtypes = [
         llaisysTensor_t,  # attn_val
         llaisysTensor_t,  # q
@@ -32,5 +87,39 @@ def load_ops(lib):
     ]
     lib.llaisysSelfAttention.restype = None
 
+    lib.llaisysPagedAttention.argtypes = [
+        llaisysTensor_t,  # attn_val
+        llaisysTensor_t,  # q
+        llaisysTensor_t,  # k_cache
+        llaisysTensor_t,  # v_cache
+        llaisysTensor_t,  # block_table
+        c_size_t,  # total_len
+        c_float    # scale
+    ]
+    lib.llaisysPagedAttention.restype = None
+
+    lib.llaisysPagedVarlenAttention.argtypes = [
+        llaisysTensor_t,  # attn_val
+        llaisysTensor_t,  # q
+        llaisysTensor_t,  # k_cache
+        llaisysTensor_t,  # v_cache
+        llaisysTensor_t,  # block_tables
+        llaisysTensor_t,  # cu_seqlens_q
+        llaisysTensor_t,  # kv_lens
+        c_float    # scale
+    ]
+    lib.llaisysPagedVarlenAttention.restype = None
+
+    lib.llaisysVarlenAttention.argtypes = [
+        llaisysTensor_t,  # attn_val
+        llaisysTensor_t,  # q
+        llaisysTensor_t,  # k
+        llaisysTensor_t,  # v
+        llaisysTensor_t,  # cu_seqlens_q
+        llaisysTensor_t,  # cu_seqlens_k
+        c_float    # scale
+    ]
+    lib.llaisysVarlenAttention.restype = None
+
     lib.llaisysSwiGLU.argtypes = [llaisysTensor_t, llaisysTensor_t, llaisysTensor_t]
     lib.llaisysSwiGLU.restype = None
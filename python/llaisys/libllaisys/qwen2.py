@@ -0,0 +1,196 @@
+from .tensor import llaisysTensor_t
+from .llaisys_types import llaisysDataType_t, llaisysDeviceType_t
+from ctypes import CFUNCTYPE, POINTER, Structure, c_float, c_int, c_int64, c_size_t, c_uint8, c_uint64, c_void_p
+
+
+class LlaisysQwen2Meta(Structure):
+    _fields_ = [
+        ("dtype", llaisysDataType_t),
+        ("nlayer", c_size_t),
+        ("hs", c_size_t),
+        ("nh", c_size_t),
+        ("nkvh", c_size_t),
+        ("dh", c_size_t),
+        ("di", c_size_t),
+        ("maxseq", c_size_t),
+        ("voc", c_size_t),
+        ("epsilon", c_float),
+        ("theta", c_float),
+        ("end_token", c_int64),
+    ]
+
+
+class LlaisysQwen2Weights(Structure):
+    _fields_ = [
+        ("in_embed", llaisysTensor_t),
+        ("out_embed", llaisysTensor_t),
+        ("out_norm_w", llaisysTensor_t),
+        ("attn_norm_w", POINTER(llaisysTensor_t)),
+        ("attn_q_w", POINTER(llaisysTensor_t)),
+        ("attn_q_b", POINTER(llaisysTensor_t)),
+        ("attn_k_w", POINTER(llaisysTensor_t)),
+        ("attn_k_b", POINTER(llaisysTensor_t)),
+        ("attn_v_w", POINTER(llaisysTensor_t)),
+        ("attn_v_b", POINTER(llaisysTensor_t)),
+        ("attn_o_w", POINTER(llaisysTensor_t)),
+        ("mlp_norm_w", POINTER(llaisysTensor_t)),
+        ("mlp_gate_w", POINTER(llaisysTensor_t)),
+        ("mlp_up_w", POINTER(llaisysTensor_t)),
+        ("mlp_down_w", POINTER(llaisysTensor_t)),
+    ]
+
+
+class LlaisysQwen2SamplingParams(Structure):
+    _fields_ = [
+        ("temperature", c_float),
+        ("top_k", c_size_t),
+        ("top_p", c_float),
+        ("seed", c_uint64),
+        ("repetition_penalty", c_float),
+        ("presence_penalty", c_float),
+    ]
+
+
+class LlaisysQwen2SpeculativeStats(Structure):
+    _fields_ = [
+        ("drafted", c_size_t),
+        ("accepted", c_size_t),
+        ("steps", c_size_t),
+    ]
+
+
+# int (*)(int64_t token, void *user_data); nonzero stops generation
+llaisysQwen2TokenCallback = CFUNCTYPE(c_int, c_int64, c_void_p)
+
+# Handle type
+llaisysQwen2Model_t = c_void_p
+
+
+def load_qwen2(lib):
+    lib.llaisysQwen2ModelCreate.argtypes = [
+        POINTER(LlaisysQwen2Meta),
+        llaisysDeviceType_t,
+        POINTER(c_int),  # device_ids
+        c_int,  # ndevice
+        c_size_t,  # kv_tokens
+    ]
+    lib.llaisysQwen2ModelCreate.restype = llaisysQwen2Model_t
+
+    lib.llaisysQwen2ModelDestroy.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelDestroy.restype = None
+
+    lib.llaisysQwen2ModelWeights.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelWeights.restype = POINTER(LlaisysQwen2Weights)
+
+    lib.llaisysQwen2ModelQuantizeInt8.argtypes = [llaisysQwen2Model_t, c_size_t]
+    lib.llaisysQwen2ModelQuantizeInt8.restype = None
+
+    lib.llaisysQwen2ModelReset.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelReset.restype = None
+
+    lib.llaisysQwen2ModelInfer.argtypes = [llaisysQwen2Model_t, POINTER(c_int64), c_size_t]
+    lib.llaisysQwen2ModelInfer.restype = c_int64
+
+    lib.llaisysQwen2ModelGenerate.argtypes = [
+        llaisysQwen2Model_t,
+        POINTER(c_int64),  # token_ids
+        c_size_t,  # ntoken
+        c_size_t,  # max_new_tokens
+        POINTER(LlaisysQwen2SamplingParams),
+        llaisysQwen2TokenCallback,  # callback, may be None
+        c_void_p,  # user_data
+        POINTER(c_int64),  # out_tokens, may be None
+    ]
+    lib.llaisysQwen2ModelGenerate.restype = c_size_t
+
+    lib.llaisysQwen2ModelGenerateSpeculative.argtypes = [
+        llaisysQwen2Model_t,
+        llaisysQwen2Model_t,  # draft_model, None for prompt lookup
+        POINTER(c_int64),  # token_ids
+        c_size_t,  # ntoken
+        c_size_t,  # max_new_tokens
+        c_size_t,  # num_draft
+        POINTER(LlaisysQwen2SamplingParams),
+        llaisysQwen2TokenCallback,  # callback, may be None
+        c_void_p,  # user_data
+        POINTER(c_int64),  # out_tokens, may be None
+        POINTER(LlaisysQwen2SpeculativeStats),  # stats, may be None
+    ]
+    lib.llaisysQwen2ModelGenerateSpeculative.restype = c_size_t
+
+    lib.llaisysQwen2ModelGenerateN.argtypes = [
+        llaisysQwen2Model_t,
+        POINTER(c_int64),  # token_ids
+        c_size_t,  # ntoken
+        c_size_t,  # n
+        c_size_t,  # max_new_tokens
+        POINTER(LlaisysQwen2SamplingParams),
+        POINTER(c_int64),  # out_tokens
+        POINTER(c_size_t),  # out_lengths
+    ]
+    lib.llaisysQwen2ModelGenerateN.restype = None
+
+    lib.llaisysQwen2ModelBeamSearch.argtypes = [
+        llaisysQwen2Model_t,
+        POINTER(c_int64),  # token_ids
+        c_size_t,  # ntoken
+        c_size_t,  # beam_width
+        c_size_t,  # max_new_tokens
+        POINTER(c_int64),  # out_tokens
+    ]
+    lib.llaisysQwen2ModelBeamSearch.restype = c_size_t
+
+    lib.llaisysQwen2ModelCreateSequence.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelCreateSequence.restype = c_int64
+
+    lib.llaisysQwen2ModelReleaseSequence.argtypes = [llaisysQwen2Model_t, c_int64]
+    lib.llaisysQwen2ModelReleaseSequence.restype = None
+
+    lib.llaisysQwen2ModelForkSequence.argtypes = [llaisysQwen2Model_t, c_int64]
+    lib.llaisysQwen2ModelForkSequence.restype = c_int64
+
+    lib.llaisysQwen2ModelFreeKVTokens.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelFreeKVTokens.restype = c_size_t
+
+    lib.llaisysQwen2ModelStep.argtypes = [
+        llaisysQwen2Model_t,
+        POINTER(c_int64),  # seq_ids
+        c_size_t,  # nseq
+        POINTER(c_int64),  # token_ids
+        POINTER(c_size_t),  # ntokens
+        POINTER(LlaisysQwen2SamplingParams),  # sampling, may be None
+        POINTER(c_int64),  # out_tokens
+    ]
+    lib.llaisysQwen2ModelStep.restype = c_uint8
+
+    lib.llaisysQwen2ModelSetPrefixCaching.argtypes = [llaisysQwen2Model_t, c_uint8]
+    lib.llaisysQwen2ModelSetPrefixCaching.restype = None
+
+    lib.llaisysQwen2ModelSubmit.argtypes = [
+        llaisysQwen2Model_t,
+        POINTER(c_int64),  # token_ids
+        c_size_t,  # ntoken
+        c_size_t,  # max_new_tokens
+        POINTER(LlaisysQwen2SamplingParams),  # sampling, may be None
+    ]
+    lib.llaisysQwen2ModelSubmit.restype = c_int64
+
+    lib.llaisysQwen2ModelCancel.argtypes = [llaisysQwen2Model_t, c_int64]
+    lib.llaisysQwen2ModelCancel.restype = None
+
+    lib.llaisysQwen2ModelPending.argtypes = [llaisysQwen2Model_t]
+    lib.llaisysQwen2ModelPending.restype = c_size_t
+
+    lib.llaisysQwen2ModelSetChunkTokens.argtypes = [llaisysQwen2Model_t, c_size_t]
+    lib.llaisysQwen2ModelSetChunkTokens.restype = None
+
+    lib.llaisysQwen2ModelScheduleStep.argtypes = [
+        llaisysQwen2Model_t,
+        POINTER(c_int64),  # out_requests
+        POINTER(c_int64),  # out_tokens
+        POINTER(c_uint8),  # out_finished
+    ]
+    lib.llaisysQwen2ModelScheduleStep.restype = c_size_t
+
+    lib.llaisysQwen2ActivationBytes.argtypes = [POINTER(LlaisysQwen2Meta), c_size_t, c_size_t]
+    lib.llaisysQwen2ActivationBytes.restype = c_size_t
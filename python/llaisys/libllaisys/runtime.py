@@ -46,3 +46,21 @@ def load_runtime(lib):
 
     lib.llaisysSetContextRuntime.argtypes = [llaisysDeviceType_t, c_int]
     lib.llaisysSetContextRuntime.restype = None
+
+    lib.llaisysSetContextAllocator.argtypes = [llaisysAllocatorType_t, c_size_t]
+    lib.llaisysSetContextAllocator.restype = None
+
+    lib.llaisysEmptyCache.argtypes = []
+    lib.llaisysEmptyCache.restype = None
+
+    lib.llaisysMemoryAllocated.argtypes = []
+    lib.llaisysMemoryAllocated.restype = c_size_t
+
+    lib.llaisysMemoryReserved.argtypes = []
+    lib.llaisysMemoryReserved.restype = c_size_t
+
+    lib.llaisysSetNumThreads.argtypes = [c_size_t]
+    lib.llaisysSetNumThreads.restype = None
+
+    lib.llaisysGetNumThreads.argtypes = []
+    lib.llaisysGetNumThreads.restype = c_size_t
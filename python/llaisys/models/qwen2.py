@@ -1,23 +1,156 @@
-from typing import Sequence
+from typing import Sequence, Tuple
 from ..libllaisys import LIB_LLAISYS
-from ..libllaisys import DeviceType
+from ..libllaisys import DeviceType, DataType
+from ..libllaisys import LlaisysQwen2Meta, LlaisysQwen2SamplingParams
+from ..libllaisys import llaisysQwen2TokenCallback, LlaisysQwen2SpeculativeStats
 
 from pathlib import Path
-import safetensors
+from ctypes import byref, c_int, c_int64, c_size_t, c_uint8, c_void_p
+import json
+import queue
+import struct
+import threading
+
+import numpy as np
+
+
+_DTYPES = {
+    "bfloat16": DataType.BF16,
+    "float16": DataType.F16,
+    "float32": DataType.F32,
+}
+
+_SAFETENSORS_DTYPES = {
+    "BF16": DataType.BF16,
+    "F16": DataType.F16,
+    "F32": DataType.F32,
+}
+
+
+def _read_safetensors(file):
+    """Yields (name, dtype, raw bytes) of every tensor in a .safetensors file.
+
+    The file is parsed directly because numpy has no bfloat16.
+    """
+    data = np.memmap(file, dtype=np.uint8, mode="r")
+    (header_len,) = struct.unpack("<Q", data[:8].tobytes())
+    header = json.loads(data[8 : 8 + header_len].tobytes())
+    base = 8 + header_len
+    for name, info in header.items():
+        if name == "__metadata__":
+            continue
+        begin, end = info["data_offsets"]
+        yield name, _SAFETENSORS_DTYPES.get(info["dtype"]), data[base + begin : base + end]
 
 
 class Qwen2:
 
-    def __init__(self, model_path, device: DeviceType = DeviceType.CPU):
-        # TODO: Implement model constructor
+    def __init__(
+        self,
+        model_path,
+        device: DeviceType = DeviceType.CPU,
+        max_seq_len: int = None,
+        int8: bool = False,
+        group_size: int = 128,
+        kv_cache_tokens: int = None,
+    ):
+        """Loads a Qwen2 checkpoint.
+
+        max_seq_len bounds every sequence, while kv_cache_tokens sizes the KV
+        cache they all share (by default max_seq_len tokens).
 
+        With int8, the projection matrices and the LM head are quantized
+        after loading, with one scale per group_size input columns of every
+        output channel (0: one per channel), which halves the weight bytes a
+        decode step streams.
+        """
         model_path = Path(model_path)
+        with open(model_path / "config.json") as f:
+            config = json.load(f)
 
+        eos = config.get("eos_token_id", -1)
+        self.meta = LlaisysQwen2Meta(
+            dtype=_DTYPES[config.get("torch_dtype", "bfloat16")],
+            nlayer=config["num_hidden_layers"],
+            hs=config["hidden_size"],
+            nh=config["num_attention_heads"],
+            nkvh=config["num_key_value_heads"],
+            dh=config["hidden_size"] // config["num_attention_heads"],
+            di=config["intermediate_size"],
+            maxseq=max_seq_len or config["max_position_embeddings"],
+            voc=config["vocab_size"],
+            epsilon=config["rms_norm_eps"],
+            theta=config.get("rope_theta", 10000.0),
+            end_token=eos[0] if isinstance(eos, list) else eos,
+        )
+
+        device_ids = (c_int * 1)(0)
+        self._model = LIB_LLAISYS.llaisysQwen2ModelCreate(
+            byref(self.meta), device, device_ids, 1, kv_cache_tokens or 0
+        )
+        weights = LIB_LLAISYS.llaisysQwen2ModelWeights(self._model).contents
+
+        targets = {
+            "model.embed_tokens.weight": weights.in_embed,
+            "lm_head.weight": weights.out_embed,
+            "model.norm.weight": weights.out_norm_w,
+        }
+        per_layer = {
+            "input_layernorm.weight": weights.attn_norm_w,
+            "self_attn.q_proj.weight": weights.attn_q_w,
+            "self_attn.q_proj.bias": weights.attn_q_b,
+            "self_attn.k_proj.weight": weights.attn_k_w,
+            "self_attn.k_proj.bias": weights.attn_k_b,
+            "self_attn.v_proj.weight": weights.attn_v_w,
+            "self_attn.v_proj.bias": weights.attn_v_b,
+            "self_attn.o_proj.weight": weights.attn_o_w,
+            "post_attention_layernorm.weight": weights.mlp_norm_w,
+            "mlp.gate_proj.weight": weights.mlp_gate_w,
+            "mlp.up_proj.weight": weights.mlp_up_w,
+            "mlp.down_proj.weight": weights.mlp_down_w,
+        }
+        for i in range(self.meta.nlayer):
+            for suffix, array in per_layer.items():
+                targets[f"model.layers.{i}.{suffix}"] = array[i]
+
+        loaded = set()
         for file in sorted(model_path.glob("*.safetensors")):
-            data_ = safetensors.safe_open(file, framework="numpy", device="cpu")
-            for name_ in data_.keys():
-                ## TODO: load the model weights
-                pass
+            for name_, dtype_, data_ in _read_safetensors(file):
+                if name_ not in targets:
+                    continue
+                if dtype_ != self.meta.dtype:
+                    raise ValueError(f"{name_}: expected {DataType(self.meta.dtype).name} weights")
+                LIB_LLAISYS.tensorLoad(targets[name_], c_void_p(data_.ctypes.data))
+                loaded.add(name_)
+                if name_ == "model.embed_tokens.weight" and config.get("tie_word_embeddings", False):
+                    LIB_LLAISYS.tensorLoad(weights.out_embed, c_void_p(data_.ctypes.data))
+                    loaded.add("lm_head.weight")
+
+        missing = set(targets) - loaded
+        if missing:
+            raise ValueError(f"missing weights: {sorted(missing)[:5]}")
+        if int8:
+            LIB_LLAISYS.llaisysQwen2ModelQuantizeInt8(self._model, group_size)
+
+    def __del__(self):
+        if hasattr(self, "_model") and self._model is not None:
+            LIB_LLAISYS.llaisysQwen2ModelDestroy(self._model)
+            self._model = None
+
+    def _sampling(self, top_k, top_p, temperature, seed, repetition_penalty, presence_penalty):
+        return LlaisysQwen2SamplingParams(
+            temperature=temperature,
+            top_k=top_k,
+            top_p=top_p,
+            seed=seed,
+            repetition_penalty=repetition_penalty,
+            presence_penalty=presence_penalty,
+        )
+
+    def _max_new_tokens(self, inputs, max_new_tokens):
+        if max_new_tokens is None:
+            return self.meta.maxseq - len(inputs)
+        return max_new_tokens
 
     def generate(
         self,
@@ -26,8 +159,251 @@ class Qwen2:
         top_k: int = 1,
         top_p: float = 0.8,
         temperature: float = 0.8,
+        seed: int = 0,
+        repetition_penalty: float = 1.0,
+        presence_penalty: float = 0.0,
+    ):
+        """Returns the prompt followed by the generated tokens.
+
+        The whole decode loop runs in C++; top_k=1 or temperature=0 is greedy.
+        repetition_penalty (> 1) and presence_penalty (> 0) discourage tokens
+        already in the prompt or output.
+        """
+        tokens = list(inputs)
+        max_new_tokens = self._max_new_tokens(tokens, max_new_tokens)
+        ids = (c_int64 * len(tokens))(*tokens)
+        out = (c_int64 * max(max_new_tokens, 1))()
+        sampling = self._sampling(top_k, top_p, temperature, seed, repetition_penalty, presence_penalty)
+
+        LIB_LLAISYS.llaisysQwen2ModelReset(self._model)
+        n = LIB_LLAISYS.llaisysQwen2ModelGenerate(
+            self._model, ids, len(tokens), max_new_tokens, byref(sampling),
+            llaisysQwen2TokenCallback(), None, out,
+        )
+        return tokens + list(out[:n])
+
+    def generate_speculative(
+        self,
+        inputs: Sequence[int],
+        max_new_tokens: int = None,
+        num_draft: int = 4,
+        draft_model: "Qwen2" = None,
+        top_k: int = 1,
+        top_p: float = 0.8,
+        temperature: float = 0.8,
+        seed: int = 0,
+        repetition_penalty: float = 1.0,
+        presence_penalty: float = 0.0,
+    ):
+        """generate() with speculative decoding.
+
+        Up to num_draft tokens per step are guessed by draft_model, which
+        must share the vocabulary, or by prompt lookup if it is None. Returns
+        the tokens and a dict with the drafted, accepted and step counts and
+        the acceptance rate.
+        """
+        tokens = list(inputs)
+        max_new_tokens = self._max_new_tokens(tokens, max_new_tokens)
+        ids = (c_int64 * len(tokens))(*tokens)
+        out = (c_int64 * max(max_new_tokens, 1))()
+        sampling = self._sampling(top_k, top_p, temperature, seed, repetition_penalty, presence_penalty)
+        stats = LlaisysQwen2SpeculativeStats()
+
+        LIB_LLAISYS.llaisysQwen2ModelReset(self._model)
+        n = LIB_LLAISYS.llaisysQwen2ModelGenerateSpeculative(
+            self._model, None if draft_model is None else draft_model._model,
+            ids, len(tokens), max_new_tokens, num_draft, byref(sampling),
+            llaisysQwen2TokenCallback(), None, out, byref(stats),
+        )
+        return tokens + list(out[:n]), {
+            "drafted": stats.drafted,
+            "accepted": stats.accepted,
+            "steps": stats.steps,
+            "acceptance_rate": stats.accepted / stats.drafted if stats.drafted else 0.0,
+        }
+
+    def generate_n(
+        self,
+        inputs: Sequence[int],
+        n: int,
+        max_new_tokens: int = None,
+        top_k: int = 1,
+        top_p: float = 0.8,
+        temperature: float = 0.8,
+        seed: int = 0,
+        repetition_penalty: float = 1.0,
+        presence_penalty: float = 0.0,
     ):
+        """Returns n sampled continuations of the prompt, prefilled once.
+
+        Sample i uses seed + i.
+        """
+        tokens = list(inputs)
+        max_new_tokens = max(self._max_new_tokens(tokens, max_new_tokens), 1)
+        ids = (c_int64 * len(tokens))(*tokens)
+        out = (c_int64 * (n * max_new_tokens))()
+        lengths = (c_size_t * n)()
+        sampling = self._sampling(top_k, top_p, temperature, seed, repetition_penalty, presence_penalty)
+        LIB_LLAISYS.llaisysQwen2ModelGenerateN(
+            self._model, ids, len(tokens), n, max_new_tokens, byref(sampling), out, lengths
+        )
+        return [
+            list(out[i * max_new_tokens : i * max_new_tokens + lengths[i]]) for i in range(n)
+        ]
+
+    def beam_search(self, inputs: Sequence[int], beam_width: int = 4, max_new_tokens: int = None):
+        """Returns the prompt followed by the best beam."""
+        tokens = list(inputs)
+        max_new_tokens = max(self._max_new_tokens(tokens, max_new_tokens), 1)
+        ids = (c_int64 * len(tokens))(*tokens)
+        out = (c_int64 * max_new_tokens)()
+        n = LIB_LLAISYS.llaisysQwen2ModelBeamSearch(
+            self._model, ids, len(tokens), beam_width, max_new_tokens, out
+        )
+        return tokens + list(out[:n])
+
+    def create_sequence(self) -> int:
+        """Starts a sequence for step(); it holds KV cache blocks until released."""
+        return int(LIB_LLAISYS.llaisysQwen2ModelCreateSequence(self._model))
+
+    def release_sequence(self, seq: int):
+        LIB_LLAISYS.llaisysQwen2ModelReleaseSequence(self._model, seq)
+
+    def fork_sequence(self, seq: int) -> int:
+        """Returns a sequence continuing from seq that shares its KV cache."""
+        return int(LIB_LLAISYS.llaisysQwen2ModelForkSequence(self._model, seq))
+
+    def free_kv_tokens(self) -> int:
+        return int(LIB_LLAISYS.llaisysQwen2ModelFreeKVTokens(self._model))
+
+    def step(
+        self,
+        batch: Sequence[Tuple[int, Sequence[int]]],
+        top_k: int = 1,
+        top_p: float = 0.8,
+        temperature: float = 0.8,
+        seed: int = 0,
+        repetition_penalty: float = 1.0,
+        presence_penalty: float = 0.0,
+    ):
+        """Runs one forward pass over (sequence, new tokens) pairs.
+
+        Prefilling and decoding sequences can share a step. Returns the next
+        token of every sequence in batch order, or None if the KV cache cannot
+        hold the new tokens.
+        """
+        nseq = len(batch)
+        seq_ids = (c_int64 * nseq)(*(seq for seq, _ in batch))
+        ntokens = (c_size_t * nseq)(*(len(tokens) for _, tokens in batch))
+        flat = [token for _, tokens in batch for token in tokens]
+        token_ids = (c_int64 * len(flat))(*flat)
+        sampling = (LlaisysQwen2SamplingParams * nseq)(
+            *(self._sampling(top_k, top_p, temperature, seed, repetition_penalty, presence_penalty) for _ in batch)
+        )
+        out = (c_int64 * nseq)()
+        if not LIB_LLAISYS.llaisysQwen2ModelStep(
+            self._model, seq_ids, nseq, token_ids, ntokens, sampling, out
+        ):
+            return None
+        return list(out)
+
+    def set_prefix_caching(self, enabled: bool):
+        """Toggles reuse of cached KV blocks across prompts sharing a prefix."""
+        LIB_LLAISYS.llaisysQwen2ModelSetPrefixCaching(self._model, 1 if enabled else 0)
+
+    def submit(
+        self,
+        inputs: Sequence[int],
+        max_new_tokens: int = None,
+        top_k: int = 1,
+        top_p: float = 0.8,
+        temperature: float = 0.8,
+        seed: int = 0,
+        repetition_penalty: float = 1.0,
+        presence_penalty: float = 0.0,
+    ) -> int:
+        """Queues a request for schedule_step() and returns its id."""
+        tokens = list(inputs)
+        max_new_tokens = self._max_new_tokens(tokens, max_new_tokens)
+        ids = (c_int64 * len(tokens))(*tokens)
+        sampling = self._sampling(top_k, top_p, temperature, seed, repetition_penalty, presence_penalty)
+        return int(
+            LIB_LLAISYS.llaisysQwen2ModelSubmit(
+                self._model, ids, len(tokens), max(max_new_tokens, 1), byref(sampling)
+            )
+        )
+
+    def cancel(self, request: int):
+        LIB_LLAISYS.llaisysQwen2ModelCancel(self._model, request)
+
+    def pending(self) -> int:
+        return int(LIB_LLAISYS.llaisysQwen2ModelPending(self._model))
+
+    def set_chunk_tokens(self, ntoken: int):
+        """Sets the per-step token budget shared by decodes and prompt chunks."""
+        LIB_LLAISYS.llaisysQwen2ModelSetChunkTokens(self._model, ntoken)
+
+    def schedule_step(self):
+        """Runs one step over the submitted requests.
+
+        Returns (request, token, finished) for every request that produced a
+        token; requests still prefilling a long prompt produce none.
+        """
+        n = max(self.pending(), 1)
+        requests = (c_int64 * n)()
+        tokens = (c_int64 * n)()
+        finished = (c_uint8 * n)()
+        count = LIB_LLAISYS.llaisysQwen2ModelScheduleStep(self._model, requests, tokens, finished)
+        return [(requests[i], tokens[i], bool(finished[i])) for i in range(count)]
+
+    def stream(
+        self,
+        inputs: Sequence[int],
+        max_new_tokens: int = None,
+        top_k: int = 1,
+        top_p: float = 0.8,
+        temperature: float = 0.8,
+        seed: int = 0,
+        repetition_penalty: float = 1.0,
+        presence_penalty: float = 0.0,
+    ):
+        """Yields generated tokens as the C++ decode loop emits them.
+
+        Decoding runs on a worker thread; closing the generator early stops it
+        after the token in flight.
+        """
+        tokens = list(inputs)
+        max_new_tokens = self._max_new_tokens(tokens, max_new_tokens)
+        ids = (c_int64 * len(tokens))(*tokens)
+        sampling = self._sampling(top_k, top_p, temperature, seed, repetition_penalty, presence_penalty)
+        emitted = queue.Queue()
+        stop = threading.Event()
+        done = object()
+
+        def on_token(token, _user_data):
+            emitted.put(token)
+            return 1 if stop.is_set() else 0
+
+        callback = llaisysQwen2TokenCallback(on_token)
 
-        # TODO: Implement generate function
+        def run():
+            try:
+                LIB_LLAISYS.llaisysQwen2ModelReset(self._model)
+                LIB_LLAISYS.llaisysQwen2ModelGenerate(
+                    self._model, ids, len(tokens), max_new_tokens, byref(sampling),
+                    callback, None, None,
+                )
+            finally:
+                emitted.put(done)
 
-        return []
+        worker = threading.Thread(target=run, daemon=True)
+        worker.start()
+        try:
+            while True:
+                token = emitted.get()
+                if token is done:
+                    return
+                yield token
+        finally:
+            stop.set()
+            worker.join()
@@ -1,6 +1,6 @@
 from .libllaisys import LIB_LLAISYS
 from .tensor import Tensor
-from ctypes import c_float, c_int
+from ctypes import c_float, c_int, c_size_t, c_uint64
 
 
 class Ops:
@@ -19,11 +19,87 @@ class Ops:
         )
 
     @staticmethod
-    def linear(out: Tensor, inp: Tensor, weight: Tensor, bias: Tensor):
-        LIB_LLAISYS.llaisysLinear(
-            out.lib_tensor(), inp.lib_tensor(), weight.lib_tensor(), bias.lib_tensor()
+    def linear(out: Tensor, inp: Tensor, weight: Tensor, bias: Tensor, residual: Tensor = None, scales: Tensor = None):
+        if scales is not None:
+            LIB_LLAISYS.llaisysLinearInt8(
+                out.lib_tensor(),
+                inp.lib_tensor(),
+                weight.lib_tensor(),
+                scales.lib_tensor(),
+                bias.lib_tensor() if bias is not None else None,
+                residual.lib_tensor() if residual is not None else None,
+            )
+            return
+        if residual is None:
+            LIB_LLAISYS.llaisysLinear(
+                out.lib_tensor(), inp.lib_tensor(), weight.lib_tensor(), bias.lib_tensor()
+            )
+            return
+        LIB_LLAISYS.llaisysLinearResidual(
+            out.lib_tensor(),
+            inp.lib_tensor(),
+            weight.lib_tensor(),
+            bias.lib_tensor() if bias is not None else None,
+            residual.lib_tensor(),
         )
 
+    @staticmethod
+    def linear_swiglu(out: Tensor, inp: Tensor, gate_up_weight: Tensor, gate_up_bias: Tensor = None, gate_up_scales: Tensor = None):
+        if gate_up_scales is not None:
+            LIB_LLAISYS.llaisysLinearSwiGLUInt8(
+                out.lib_tensor(),
+                inp.lib_tensor(),
+                gate_up_weight.lib_tensor(),
+                gate_up_scales.lib_tensor(),
+                gate_up_bias.lib_tensor() if gate_up_bias is not None else None,
+            )
+            return
+        LIB_LLAISYS.llaisysLinearSwiGLU(
+            out.lib_tensor(),
+            inp.lib_tensor(),
+            gate_up_weight.lib_tensor(),
+            gate_up_bias.lib_tensor() if gate_up_bias is not None else None,
+        )
+
+    @staticmethod
+    def lm_head_topk(top_idx: Tensor, top_val: Tensor, hidden: Tensor, norm_w: Tensor, out_embed: Tensor, eps: float):
+        LIB_LLAISYS.llaisysLmHeadTopk(
+            top_idx.lib_tensor(),
+            top_val.lib_tensor(),
+            hidden.lib_tensor(),
+            norm_w.lib_tensor(),
+            out_embed.lib_tensor(),
+            c_float(eps),
+        )
+
+    @staticmethod
+    def qkv_rope(
+        q: Tensor,
+        k_cache: Tensor,
+        v_cache: Tensor,
+        inp: Tensor,
+        qkv_weight: Tensor,
+        qkv_bias: Tensor,
+        pos_ids: Tensor,
+        slots: Tensor,
+        theta: float,
+    ):
+        LIB_LLAISYS.llaisysQKVRope(
+            q.lib_tensor(),
+            k_cache.lib_tensor(),
+            v_cache.lib_tensor(),
+            inp.lib_tensor(),
+            qkv_weight.lib_tensor(),
+            qkv_bias.lib_tensor() if qkv_bias is not None else None,
+            pos_ids.lib_tensor(),
+            slots.lib_tensor(),
+            c_float(theta),
+        )
+
+    @staticmethod
+    def quantize(out: Tensor, scales: Tensor, inp: Tensor):
+        LIB_LLAISYS.llaisysQuantize(out.lib_tensor(), scales.lib_tensor(), inp.lib_tensor())
+
     @staticmethod
     def rearrange(out: Tensor, inp: Tensor):
         LIB_LLAISYS.llaisysRearrange(out.lib_tensor(), inp.lib_tensor())
@@ -34,12 +110,44 @@ class Ops:
             out.lib_tensor(), inp.lib_tensor(), weight.lib_tensor(), c_float(eps)
         )
 
+    @staticmethod
+    def add_rms_norm(out: Tensor, residual: Tensor, inp: Tensor, weight: Tensor, eps: float):
+        LIB_LLAISYS.llaisysAddRmsNorm(
+            out.lib_tensor(), residual.lib_tensor(), inp.lib_tensor(), weight.lib_tensor(), c_float(eps)
+        )
+
     @staticmethod
     def rope(out: Tensor, inp: Tensor, pos_ids: Tensor, theta: float):
         LIB_LLAISYS.llaisysROPE(
             out.lib_tensor(), inp.lib_tensor(), pos_ids.lib_tensor(), c_float(theta)
         )
 
+    @staticmethod
+    def sample(
+        out_idx: Tensor,
+        logits: Tensor,
+        ids: Tensor = None,
+        prev_tokens: Tensor = None,
+        temperature: float = 1.0,
+        top_k: int = 0,
+        top_p: float = 1.0,
+        repetition_penalty: float = 1.0,
+        presence_penalty: float = 0.0,
+        seed: int = 0,
+    ):
+        LIB_LLAISYS.llaisysSample(
+            out_idx.lib_tensor(),
+            logits.lib_tensor(),
+            ids.lib_tensor() if ids is not None else None,
+            prev_tokens.lib_tensor() if prev_tokens is not None else None,
+            c_float(temperature),
+            c_size_t(top_k),
+            c_float(top_p),
+            c_float(repetition_penalty),
+            c_float(presence_penalty),
+            c_uint64(seed),
+        )
+
     @staticmethod
     def self_attention(attn_val: Tensor, q: Tensor, k: Tensor, v: Tensor, scale: float):
         LIB_LLAISYS.llaisysSelfAttention(
@@ -50,6 +158,68 @@ class Ops:
             c_float(scale),
         )
 
+    @staticmethod
+    def paged_attention(
+        attn_val: Tensor,
+        q: Tensor,
+        k_cache: Tensor,
+        v_cache: Tensor,
+        block_table: Tensor,
+        total_len: int,
+        scale: float,
+    ):
+        LIB_LLAISYS.llaisysPagedAttention(
+            attn_val.lib_tensor(),
+            q.lib_tensor(),
+            k_cache.lib_tensor(),
+            v_cache.lib_tensor(),
+            block_table.lib_tensor(),
+            c_size_t(total_len),
+            c_float(scale),
+        )
+
+    @staticmethod
+    def paged_varlen_attention(
+        attn_val: Tensor,
+        q: Tensor,
+        k_cache: Tensor,
+        v_cache: Tensor,
+        block_tables: Tensor,
+        cu_seqlens_q: Tensor,
+        kv_lens: Tensor,
+        scale: float,
+    ):
+        LIB_LLAISYS.llaisysPagedVarlenAttention(
+            attn_val.lib_tensor(),
+            q.lib_tensor(),
+            k_cache.lib_tensor(),
+            v_cache.lib_tensor(),
+            block_tables.lib_tensor(),
+            cu_seqlens_q.lib_tensor(),
+            kv_lens.lib_tensor(),
+            c_float(scale),
+        )
+
+    @staticmethod
+    def varlen_attention(
+        attn_val: Tensor,
+        q: Tensor,
+        k: Tensor,
+        v: Tensor,
+        cu_seqlens_q: Tensor,
+        cu_seqlens_k: Tensor,
+        scale: float,
+    ):
+        LIB_LLAISYS.llaisysVarlenAttention(
+            attn_val.lib_tensor(),
+            q.lib_tensor(),
+            k.lib_tensor(),
+            v.lib_tensor(),
+            cu_seqlens_q.lib_tensor(),
+            cu_seqlens_k.lib_tensor(),
+            c_float(scale),
+        )
+
     @staticmethod
     def swiglu(out: Tensor, gate: Tensor, up: Tensor):
         LIB_LLAISYS.llaisysSwiGLU(out.lib_tensor(), gate.lib_tensor(), up.lib_tensor())
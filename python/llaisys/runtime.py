@@ -1,6 +1,36 @@
 from . import libllaisys
 from .libllaisys import LIB_LLAISYS
-from ctypes import c_void_p
+from ctypes import c_void_p, c_size_t
+
+
+def set_allocator(allocator: libllaisys.AllocatorType, cache_limit: int = 0) -> None:
+    # cache_limit caps the cached bytes of the caching allocator; 0 means no limit
+    LIB_LLAISYS.llaisysSetContextAllocator(
+        libllaisys.llaisysAllocatorType_t(allocator), c_size_t(cache_limit)
+    )
+
+
+def empty_cache() -> None:
+    LIB_LLAISYS.llaisysEmptyCache()
+
+
+def memory_allocated() -> int:
+    # bytes of live allocations; only the caching allocator keeps count
+    return int(LIB_LLAISYS.llaisysMemoryAllocated())
+
+
+def memory_reserved() -> int:
+    # bytes held from the device, cached or in use
+    return int(LIB_LLAISYS.llaisysMemoryReserved())
+
+
+def set_num_threads(nthreads: int) -> None:
+    # 0 means one thread per core
+    LIB_LLAISYS.llaisysSetNumThreads(c_size_t(nthreads))
+
+
+def get_num_threads() -> int:
+    return int(LIB_LLAISYS.llaisysGetNumThreads())
 
 
 class RuntimeAPI:
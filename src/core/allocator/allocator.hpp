@@ -14,6 +14,12 @@ public:
     virtual ~MemoryAllocator() = default;
     virtual std::byte *allocate(size_t size) = 0;
     virtual void release(std::byte *memory) = 0;
+    // Returns memory kept for reuse to the runtime; no-op for uncached allocators.
+    virtual void emptyCache() {}
+    // Bytes of live allocations, and bytes held from the runtime including the
+    // cache; only the caching allocator keeps count, the others report 0.
+    virtual size_t allocatedBytes() const { return 0; }
+    virtual size_t reservedBytes() const { return 0; }
 };
 
 } // namespace llaisys::core
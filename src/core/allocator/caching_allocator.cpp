@@ -0,0 +1,214 @@
+#include "caching_allocator.hpp"
+
+#include "../../utils.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace llaisys::core::allocators {
+namespace {
+// Granularity of small size classes and alignment of every block.
+constexpr size_t MIN_BLOCK = 512;
+constexpr size_t SEGMENT_ALIGN = 64;
+// Largest request served from shared segments, and their size.
+constexpr size_t SMALL_SIZE = size_t(1) << 20;
+constexpr size_t SMALL_SEGMENT = size_t(2) << 20;
+// Large segments are rounded to this granularity.
+constexpr size_t LARGE_ROUND = size_t(2) << 20;
+
+size_t round_up(size_t size, size_t unit) {
+    return (size + unit - 1) / unit * unit;
+}
+} // namespace
+
+CachingAllocator::CachingAllocator(const LlaisysRuntimeAPI *runtime_api, size_t cache_limit)
+    : MemoryAllocator(runtime_api), _cache_limit(cache_limit), _bins(SMALL_SIZE / MIN_BLOCK + 1) {}
+
+CachingAllocator::~CachingAllocator() {
+    emptyCache();
+}
+
+// Multiples of MIN_BLOCK up to SMALL_SIZE; above that four classes per power
+// of two, which bounds the waste per block to 25%.
+size_t CachingAllocator::_roundSize(size_t size) {
+    if (size <= SMALL_SIZE) {
+        return round_up(std::max(size, size_t(1)), MIN_BLOCK);
+    }
+    size_t power = SMALL_SIZE;
+    while (power < size / 2) {
+        power *= 2;
+    }
+    return round_up(size, power / 4);
+}
+
+std::byte *CachingAllocator::allocate(size_t size) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t rounded = _roundSize(size);
+    bool small = rounded <= SMALL_SIZE;
+    FreeBlocks &pool = small ? _small_blocks : _large_blocks;
+
+    Block *block = nullptr;
+    if (small && !_bins[rounded / MIN_BLOCK].empty()) {
+        block = _bins[rounded / MIN_BLOCK].back();
+        _bins[rounded / MIN_BLOCK].pop_back();
+        block->binned = false;
+    } else {
+        Block key{nullptr, rounded, small};
+        auto it = pool.lower_bound(&key);
+        if (it == pool.end() && small) {
+            _flushBins();
+            it = pool.lower_bound(&key);
+        }
+        if (it != pool.end()) {
+            block = *it;
+            pool.erase(it);
+        } else {
+            block = _newSegment(small ? SMALL_SEGMENT : round_up(rounded, LARGE_ROUND), small);
+        }
+        _split(block, rounded);
+    }
+    block->allocated = true;
+    _allocated_bytes += block->size;
+    _live_blocks.emplace(block->ptr, block);
+    return block->ptr;
+}
+
+void CachingAllocator::release(std::byte *memory) {
+    if (memory == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _live_blocks.find(memory);
+    ASSERT(it != _live_blocks.end(), "CachingAllocator: releasing memory it does not own.");
+    Block *block = it->second;
+    _live_blocks.erase(it);
+    block->allocated = false;
+    _allocated_bytes -= block->size;
+
+    if (block->small) {
+        block->binned = true;
+        _bins[block->size / MIN_BLOCK].push_back(block);
+    } else {
+        _free(block);
+    }
+    if (_cache_limit != 0 && _reserved_bytes - _allocated_bytes > _cache_limit) {
+        _flushBins();
+        _releaseFreeSegments(_cache_limit);
+    }
+}
+
+// Merges a free block with its free neighbours and makes it available for
+// best-fit lookups.
+void CachingAllocator::_free(Block *block) {
+    FreeBlocks &pool = block->small ? _small_blocks : _large_blocks;
+    if (block->prev != nullptr && !block->prev->allocated && !block->prev->binned) {
+        Block *prev = block->prev;
+        pool.erase(prev);
+        prev->size += block->size;
+        prev->next = block->next;
+        if (block->next != nullptr) {
+            block->next->prev = prev;
+        }
+        delete block;
+        block = prev;
+    }
+    if (block->next != nullptr && !block->next->allocated && !block->next->binned) {
+        Block *next = block->next;
+        pool.erase(next);
+        block->size += next->size;
+        block->next = next->next;
+        if (next->next != nullptr) {
+            next->next->prev = block;
+        }
+        delete next;
+    }
+    pool.insert(block);
+}
+
+void CachingAllocator::_flushBins() {
+    for (auto &bin : _bins) {
+        for (Block *block : bin) {
+            block->binned = false;
+            _free(block);
+        }
+        bin.clear();
+    }
+}
+
+void CachingAllocator::emptyCache() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _flushBins();
+    _releaseFreeSegments(0);
+}
+
+void CachingAllocator::setCacheLimit(size_t cache_limit) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _cache_limit = cache_limit;
+    if (_cache_limit != 0 && _reserved_bytes - _allocated_bytes > _cache_limit) {
+        _flushBins();
+        _releaseFreeSegments(_cache_limit);
+    }
+}
+
+size_t CachingAllocator::allocatedBytes() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _allocated_bytes;
+}
+
+size_t CachingAllocator::reservedBytes() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _reserved_bytes;
+}
+
+CachingAllocator::Block *CachingAllocator::_newSegment(size_t size, bool small) {
+    void *raw = _api->malloc_device(size + SEGMENT_ALIGN);
+    if (raw == nullptr) {
+        // Cached segments may be what stands between us and the request.
+        _flushBins();
+        _releaseFreeSegments(0);
+        raw = _api->malloc_device(size + SEGMENT_ALIGN);
+    }
+    ASSERT(raw != nullptr, "CachingAllocator: out of device memory.");
+
+    auto base = reinterpret_cast<std::byte *>(round_up(reinterpret_cast<uintptr_t>(raw), SEGMENT_ALIGN));
+    _segments.emplace(base, raw);
+    _reserved_bytes += size;
+    return new Block{base, size, small};
+}
+
+// Splits the tail of a free block off into a new free block when it is big
+// enough to serve another request of the same pool.
+void CachingAllocator::_split(Block *block, size_t size) {
+    size_t remaining = block->size - size;
+    if (block->small ? remaining < MIN_BLOCK : remaining <= SMALL_SIZE) {
+        return;
+    }
+    Block *rest = new Block{block->ptr + size, remaining, block->small};
+    rest->prev = block;
+    rest->next = block->next;
+    if (block->next != nullptr) {
+        block->next->prev = rest;
+    }
+    block->next = rest;
+    block->size = size;
+    (block->small ? _small_blocks : _large_blocks).insert(rest);
+}
+
+// Frees whole free segments, largest first, until the cached bytes drop to target.
+void CachingAllocator::_releaseFreeSegments(size_t target) {
+    for (FreeBlocks *pool : {&_large_blocks, &_small_blocks}) {
+        for (auto it = pool->end(); it != pool->begin() && _reserved_bytes - _allocated_bytes > target;) {
+            Block *block = *--it;
+            if (block->prev != nullptr || block->next != nullptr) {
+                continue;
+            }
+            auto segment = _segments.find(block->ptr);
+            _api->free_device(segment->second);
+            _segments.erase(segment);
+            _reserved_bytes -= block->size;
+            it = pool->erase(it);
+            delete block;
+        }
+    }
+}
+} // namespace llaisys::core::allocators
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "allocator.hpp"
+
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace llaisys::core::allocators {
+// Keeps freed device memory for reuse instead of returning it to the runtime.
+//
+// Requests are rounded up to a size class. Blocks are carved out of larger
+// segments obtained from malloc_device: requests up to SMALL_SIZE share
+// SMALL_SEGMENT segments, while larger ones get a segment of their own.
+// Oversized blocks are split, and freed blocks merge with free neighbours of
+// the same segment, then serve later requests best-fit. Small blocks are
+// first parked in a per-size-class bin, so the steady state of a decode loop
+// (the same temporaries every step) is a bin pop and push; the bins are merged
+// back before a new segment is requested. Segments that become entirely free
+// are handed back by emptyCache(), when the cached bytes exceed the cache
+// limit, or when malloc_device fails.
+class CachingAllocator : public MemoryAllocator {
+public:
+    // cache_limit caps the free bytes kept for reuse; 0 means no limit.
+    CachingAllocator(const LlaisysRuntimeAPI *runtime_api, size_t cache_limit = 0);
+    ~CachingAllocator() override;
+    std::byte *allocate(size_t size) override;
+    void release(std::byte *memory) override;
+    void emptyCache() override;
+
+    void setCacheLimit(size_t cache_limit);
+    // Bytes handed out to live allocations (after size-class rounding).
+    size_t allocatedBytes() const override;
+    // Bytes currently obtained from the runtime, cached or in use.
+    size_t reservedBytes() const override;
+
+private:
+    struct Block {
+        std::byte *ptr;
+        size_t size;
+        bool small;
+        bool allocated = false;
+        bool binned = false;
+        // Address-ordered neighbours within the same segment.
+        Block *prev = nullptr;
+        Block *next = nullptr;
+    };
+
+    struct BlockOrder {
+        bool operator()(const Block *a, const Block *b) const {
+            return a->size != b->size ? a->size < b->size : a->ptr < b->ptr;
+        }
+    };
+    using FreeBlocks = std::set<Block *, BlockOrder>;
+
+    static size_t _roundSize(size_t size);
+    Block *_newSegment(size_t size, bool small);
+    void _split(Block *block, size_t size);
+    void _free(Block *block);
+    void _flushBins();
+    void _releaseFreeSegments(size_t target);
+
+    mutable std::mutex _mutex;
+    size_t _cache_limit;
+    size_t _allocated_bytes = 0;
+    size_t _reserved_bytes = 0;
+    FreeBlocks _small_blocks;
+    FreeBlocks _large_blocks;
+    // Freed small blocks per size class, not merged with their neighbours yet.
+    std::vector<std::vector<Block *>> _bins;
+    std::unordered_map<std::byte *, Block *> _live_blocks;
+    // Aligned segment base -> pointer returned by malloc_device.
+    std::unordered_map<std::byte *, void *> _segments;
+};
+} // namespace llaisys::core::allocators
@@ -7,3 +7,4 @@
 #include "context/context.hpp"
 #include "runtime/runtime.hpp"
 #include "storage/storage.hpp"
+#include "thread_pool/thread_pool.hpp"
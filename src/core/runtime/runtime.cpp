@@ -1,22 +1,23 @@
 #include "runtime.hpp"
 
 #include "../../device/runtime_api.hpp"
+#include "../allocator/caching_allocator.hpp"
 #include "../allocator/naive_allocator.hpp"
+#include "../../utils.hpp"
 
 namespace llaisys::core {
 Runtime::Runtime(llaisysDeviceType_t device_type, int device_id)
     : _device_type(device_type), _device_id(device_id), _is_active(false) {
     _api = llaisys::device::getRuntimeAPI(_device_type);
     _stream = _api->create_stream();
-    _allocator = new allocators::NaiveAllocator(_api);
+    _allocator = std::make_shared<allocators::CachingAllocator>(_api);
 }
 
 Runtime::~Runtime() {
     if (!_is_active) {
         std::cerr << "Mallicious destruction of inactive runtime." << std::endl;
     }
-    delete _allocator;
-    _allocator = nullptr;
+    _allocator.reset();
     _api->destroy_stream(_stream);
     _api = nullptr;
 }
@@ -47,7 +48,7 @@ const LlaisysRuntimeAPI *Runtime::api() const {
 }
 
 storage_t Runtime::allocateDeviceStorage(size_t size) {
-    return std::shared_ptr<Storage>(new Storage(_allocator->allocate(size), size, *this, false));
+    return std::shared_ptr<Storage>(new Storage(_allocator->allocate(size), size, *this, false, _allocator));
 }
 
 storage_t Runtime::allocateHostStorage(size_t size) {
@@ -58,10 +59,35 @@ void Runtime::freeStorage(Storage *storage) {
     if (storage->isHost()) {
         _api->free_host(storage->memory());
     } else {
-        _allocator->release(storage->memory());
+        storage->_allocator->release(storage->memory());
     }
 }
 
+void Runtime::setAllocator(llaisysAllocatorType_t type, size_t cache_limit) {
+    switch (type) {
+    case LLAISYS_ALLOCATOR_NAIVE:
+        _allocator = std::make_shared<allocators::NaiveAllocator>(_api);
+        return;
+    case LLAISYS_ALLOCATOR_CACHING:
+        _allocator = std::make_shared<allocators::CachingAllocator>(_api, cache_limit);
+        return;
+    default:
+        CHECK_ARGUMENT(false, "unknown allocator type");
+    }
+}
+
+void Runtime::emptyCache() {
+    _allocator->emptyCache();
+}
+
+size_t Runtime::memoryAllocated() const {
+    return _allocator->allocatedBytes();
+}
+
+size_t Runtime::memoryReserved() const {
+    return _allocator->reservedBytes();
+}
+
 llaisysStream_t Runtime::stream() const {
     return _stream;
 }
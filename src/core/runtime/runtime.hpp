@@ -10,7 +10,7 @@ private:
     llaisysDeviceType_t _device_type;
     int _device_id;
     const LlaisysRuntimeAPI *_api;
-    MemoryAllocator *_allocator;
+    std::shared_ptr<MemoryAllocator> _allocator;
     bool _is_active;
     void _activate();
     void _deactivate();
@@ -37,10 +37,17 @@ public:
     const LlaisysRuntimeAPI *api() const;
 
     storage_t allocateDeviceStorage(size_t size);
-    ;
     storage_t allocateHostStorage(size_t size);
     void freeStorage(Storage *storage);
 
+    // Selects the allocator for subsequent device allocations; memory already
+    // handed out is still returned to the allocator it came from.
+    void setAllocator(llaisysAllocatorType_t type, size_t cache_limit = 0);
+    void emptyCache();
+    // Statistics of the current allocator (see MemoryAllocator).
+    size_t memoryAllocated() const;
+    size_t memoryReserved() const;
+
     llaisysStream_t stream() const;
     void synchronize() const;
 };
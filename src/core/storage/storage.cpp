@@ -3,8 +3,8 @@
 #include "../runtime/runtime.hpp"
 
 namespace llaisys::core {
-Storage::Storage(std::byte *memory, size_t size, Runtime &runtime, bool is_host)
-    : _memory(memory), _size(size), _runtime(runtime), _is_host(is_host) {}
+Storage::Storage(std::byte *memory, size_t size, Runtime &runtime, bool is_host, std::shared_ptr<MemoryAllocator> allocator)
+    : _memory(memory), _size(size), _runtime(runtime), _is_host(is_host), _allocator(std::move(allocator)) {}
 
 Storage::~Storage() {
     _runtime.freeStorage(this);
@@ -12,7 +12,9 @@ private:
     size_t _size;
     Runtime &_runtime;
     bool _is_host;
-    Storage(std::byte *memory, size_t size, Runtime &runtime, bool is_host);
+    // Allocator that owns device memory, kept alive until the storage is freed.
+    std::shared_ptr<MemoryAllocator> _allocator;
+    Storage(std::byte *memory, size_t size, Runtime &runtime, bool is_host, std::shared_ptr<MemoryAllocator> allocator = nullptr);
 
 public:
     friend class Runtime;
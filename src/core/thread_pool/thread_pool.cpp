@@ -0,0 +1,217 @@
+#include "thread_pool.hpp"
+
+#include "../../utils.hpp"
+
+#include <algorithm>
+
+namespace llaisys::core {
+namespace {
+// Set on pool workers and on a caller while it runs its share of a loop.
+thread_local bool in_parallel_region = false;
+
+// Chunks handed to each participant up front; more than one leaves room for
+// stealing when the work per chunk is uneven.
+constexpr size_t CHUNKS_PER_THREAD = 4;
+
+// A participant's remaining chunks [begin, end), packed in one word so the
+// owner (popping the front) and thieves (popping the back) agree via CAS.
+uint64_t pack(uint32_t begin, uint32_t end) {
+    return (static_cast<uint64_t>(begin) << 32) | end;
+}
+
+bool pop_front(std::atomic<uint64_t> &range, size_t &chunk) {
+    uint64_t cur = range.load(std::memory_order_relaxed);
+    for (;;) {
+        uint32_t begin = static_cast<uint32_t>(cur >> 32), end = static_cast<uint32_t>(cur);
+        if (begin >= end) {
+            return false;
+        }
+        if (range.compare_exchange_weak(cur, pack(begin + 1, end), std::memory_order_acq_rel)) {
+            chunk = begin;
+            return true;
+        }
+    }
+}
+
+bool pop_back(std::atomic<uint64_t> &range, size_t &chunk) {
+    uint64_t cur = range.load(std::memory_order_relaxed);
+    for (;;) {
+        uint32_t begin = static_cast<uint32_t>(cur >> 32), end = static_cast<uint32_t>(cur);
+        if (begin >= end) {
+            return false;
+        }
+        if (range.compare_exchange_weak(cur, pack(begin, end - 1), std::memory_order_acq_rel)) {
+            chunk = end - 1;
+            return true;
+        }
+    }
+}
+} // namespace
+
+struct ThreadPool::Job {
+    const task_t *fn;
+    size_t n;
+    size_t chunk;
+    size_t nparticipants;
+    // The pool's _ranges; _run_mutex keeps one job using them at a time.
+    std::atomic<uint64_t> *ranges;
+
+    std::mutex error_mutex;
+    std::exception_ptr error;
+};
+
+ThreadPool::ThreadPool(size_t nthreads) {
+    _start(nthreads);
+}
+
+ThreadPool::~ThreadPool() {
+    _stop();
+}
+
+size_t ThreadPool::numThreads() const {
+    return _nthreads.load(std::memory_order_relaxed);
+}
+
+void ThreadPool::setNumThreads(size_t nthreads) {
+    // A task would wait on the loop it runs in, or a worker would join itself.
+    CHECK_ARGUMENT(!in_parallel_region, "ThreadPool: setNumThreads() cannot be called from a parallel_for task.");
+    std::lock_guard<std::mutex> run_lock(_run_mutex);
+    _stop();
+    _start(nthreads);
+}
+
+void ThreadPool::_start(size_t nthreads) {
+    if (nthreads == 0) {
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    _stopping = false;
+    for (size_t id = 1; id < nthreads; id++) {
+        // No loop is running here, so workers start from the current generation.
+        _workers.emplace_back([this, id, generation = _generation]() { _workerLoop(id, generation); });
+    }
+    _ranges.reset(new std::atomic<uint64_t>[_workers.size() + 1]);
+    _nthreads.store(_workers.size() + 1, std::memory_order_relaxed);
+}
+
+void ThreadPool::_stop() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    for (auto &worker : _workers) {
+        worker.join();
+    }
+    _workers.clear();
+    _nthreads.store(1, std::memory_order_relaxed);
+}
+
+void ThreadPool::_workerLoop(size_t id, uint64_t generation) {
+    in_parallel_region = true;
+    uint64_t seen = generation;
+    for (;;) {
+        Job *job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&]() { return _stopping || _generation != seen; });
+            if (_stopping) {
+                return;
+            }
+            seen = _generation;
+            job = _job;
+        }
+        _work(*job, id);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (--_active == 0) {
+                _done.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::_work(Job &job, size_t id) {
+    auto run = [&job](size_t chunk) {
+        size_t begin = chunk * job.chunk;
+        try {
+            (*job.fn)(begin, std::min(job.n, begin + job.chunk));
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(job.error_mutex);
+            if (!job.error) {
+                job.error = std::current_exception();
+            }
+        }
+    };
+
+    size_t chunk;
+    while (pop_front(job.ranges[id], chunk)) {
+        run(chunk);
+    }
+    for (size_t i = 1; i < job.nparticipants; i++) {
+        auto &victim = job.ranges[(id + i) % job.nparticipants];
+        while (pop_back(victim, chunk)) {
+            run(chunk);
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t n, size_t grain, const task_t &fn) {
+    if (n == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    if (n <= grain || in_parallel_region) {
+        return fn(0, n);
+    }
+    std::unique_lock<std::mutex> run_lock(_run_mutex, std::try_to_lock);
+    if (!run_lock.owns_lock()) {
+        return fn(0, n);
+    }
+    // setNumThreads() holds _run_mutex, so the workers stay as counted here
+    // until the loop is over.
+    size_t nthreads = _workers.size() + 1;
+    if (nthreads == 1) {
+        run_lock.unlock();
+        return fn(0, n);
+    }
+
+    Job job;
+    job.fn = &fn;
+    job.n = n;
+    job.chunk = std::max(grain, (n + nthreads * CHUNKS_PER_THREAD - 1) / (nthreads * CHUNKS_PER_THREAD));
+    size_t nchunks = (n + job.chunk - 1) / job.chunk;
+    job.nparticipants = nthreads;
+    job.ranges = _ranges.get();
+    for (size_t p = 0; p < nthreads; p++) {
+        size_t begin = p * nchunks / nthreads;
+        size_t end = (p + 1) * nchunks / nthreads;
+        job.ranges[p].store(pack(static_cast<uint32_t>(begin), static_cast<uint32_t>(end)), std::memory_order_relaxed);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _job = &job;
+        _active = nthreads - 1;
+        _generation++;
+    }
+    _wake.notify_all();
+
+    in_parallel_region = true;
+    _work(job, 0);
+    in_parallel_region = false;
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [&]() { return _active == 0; });
+        _job = nullptr;
+    }
+    if (job.error) {
+        std::rethrow_exception(job.error);
+    }
+}
+
+ThreadPool &threadPool() {
+    static ThreadPool pool;
+    return pool;
+}
+} // namespace llaisys::core
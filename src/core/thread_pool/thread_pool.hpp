@@ -0,0 +1,78 @@
+#pragma once
+#include "../core.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace llaisys::core {
+// Process-wide pool of CPU workers that all CPU kernels dispatch through.
+//
+// A parallel loop is cut into chunks of at least `grain` items; every
+// participant (the workers plus the calling thread) starts on its own
+// contiguous share of chunks and, once done, steals chunks from the back of
+// the others' shares. Only one loop runs on the pool at a time: a loop issued
+// from inside a pool task, or while another thread owns the pool, runs inline
+// on the calling thread, so nested parallelism and concurrent callers never
+// deadlock or oversubscribe the machine.
+class ThreadPool {
+public:
+    using task_t = std::function<void(size_t, size_t)>;
+
+    explicit ThreadPool(size_t nthreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Number of threads taking part in a loop, including the caller.
+    size_t numThreads() const;
+    // Restarts the workers; 0 means one thread per hardware thread. Throws
+    // when called from a pool task.
+    void setNumThreads(size_t nthreads);
+
+    void parallelFor(size_t n, size_t grain, const task_t &fn);
+
+private:
+    struct Job;
+
+    void _start(size_t nthreads);
+    void _stop();
+    void _workerLoop(size_t id, uint64_t generation);
+    static void _work(Job &job, size_t id);
+
+    std::vector<std::thread> _workers;
+    // Held by the thread running a loop, and while workers are restarted.
+    std::mutex _run_mutex;
+    // _workers.size() + 1, readable without _run_mutex.
+    std::atomic<size_t> _nthreads{1};
+    // Every participant's remaining chunks in the running loop, one per
+    // thread; sized in _start() so a loop allocates nothing.
+    std::unique_ptr<std::atomic<uint64_t>[]> _ranges;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    Job *_job = nullptr;
+    uint64_t _generation = 0;
+    size_t _active = 0;
+    bool _stopping = false;
+};
+
+ThreadPool &threadPool();
+
+// Runs fn(begin, end) over disjoint sub-ranges covering [0, n), each at least
+// `grain` items long except possibly the last one.
+template <typename F>
+void parallel_for(size_t n, size_t grain, F &&fn) {
+    // Wrapping a reference keeps std::function from copying the closure to the heap.
+    threadPool().parallelFor(n, grain, std::ref(fn));
+}
+} // namespace llaisys::core
@@ -6,11 +6,17 @@
 #include "../ops/argmax/op.hpp"
 #include "../ops/embedding/op.hpp"
 #include "../ops/linear/op.hpp"
+#include "../ops/lm_head_topk/op.hpp"
+#include "../ops/paged_attention/op.hpp"
+#include "../ops/qkv_rope/op.hpp"
+#include "../ops/quantize/op.hpp"
 #include "../ops/rearrange/op.hpp"
 #include "../ops/rms_norm/op.hpp"
 #include "../ops/rope/op.hpp"
+#include "../ops/sample/op.hpp"
 #include "../ops/self_attention/op.hpp"
 #include "../ops/swiglu/op.hpp"
+#include "../ops/varlen_attention/op.hpp"
 
 __C {
     void llaisysAdd(llaisysTensor_t c, llaisysTensor_t a, llaisysTensor_t b) {
@@ -25,18 +31,56 @@ __C {
     void llaisysLinear(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t bias) {
         llaisys::ops::linear(out->tensor, in->tensor, weight->tensor, bias->tensor);
     }
+    void llaisysLinearResidual(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t bias, llaisysTensor_t residual) {
+        llaisys::ops::linear(out->tensor, in->tensor, weight->tensor, bias ? bias->tensor : nullptr, residual->tensor);
+    }
+    void llaisysLinearInt8(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, llaisysTensor_t scales, llaisysTensor_t bias, llaisysTensor_t residual) {
+        llaisys::ops::linear(out->tensor, in->tensor, weight->tensor, bias ? bias->tensor : nullptr, residual ? residual->tensor : nullptr, scales->tensor);
+    }
+    void llaisysLinearSwiGLU(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t gate_up_weight, llaisysTensor_t gate_up_bias) {
+        llaisys::ops::linear_swiglu(out->tensor, in->tensor, gate_up_weight->tensor, gate_up_bias ? gate_up_bias->tensor : nullptr);
+    }
+    void llaisysLinearSwiGLUInt8(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t gate_up_weight, llaisysTensor_t gate_up_scales, llaisysTensor_t gate_up_bias) {
+        llaisys::ops::linear_swiglu(out->tensor, in->tensor, gate_up_weight->tensor, gate_up_bias ? gate_up_bias->tensor : nullptr, gate_up_scales->tensor);
+    }
+    void llaisysLmHeadTopk(llaisysTensor_t top_idx, llaisysTensor_t top_val, llaisysTensor_t hidden, llaisysTensor_t norm_w, llaisysTensor_t out_embed, float eps) {
+        llaisys::ops::lm_head_topk(top_idx->tensor, top_val->tensor, hidden->tensor, norm_w->tensor, out_embed->tensor, eps);
+    }
+    void llaisysQKVRope(llaisysTensor_t q, llaisysTensor_t k_cache, llaisysTensor_t v_cache, llaisysTensor_t in, llaisysTensor_t qkv_weight, llaisysTensor_t qkv_bias, llaisysTensor_t pos_ids, llaisysTensor_t slots, float theta) {
+        llaisys::ops::qkv_rope(q->tensor, k_cache->tensor, v_cache->tensor, in->tensor, qkv_weight->tensor, qkv_bias ? qkv_bias->tensor : nullptr, pos_ids->tensor, slots->tensor, theta);
+    }
+    void llaisysQuantize(llaisysTensor_t out, llaisysTensor_t scales, llaisysTensor_t in) {
+        llaisys::ops::quantize(out->tensor, scales->tensor, in->tensor);
+    }
     void llaisysRearrange(llaisysTensor_t out, llaisysTensor_t in) {
         llaisys::ops::rearrange(out->tensor, in->tensor);
     }
     void llaisysRmsNorm(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t weight, float eps) {
         llaisys::ops::rms_norm(out->tensor, in->tensor, weight->tensor, eps);
     }
+    void llaisysAddRmsNorm(llaisysTensor_t out, llaisysTensor_t residual, llaisysTensor_t in, llaisysTensor_t weight, float eps) {
+        llaisys::ops::add_rms_norm(out->tensor, residual->tensor, in->tensor, weight->tensor, eps);
+    }
     void llaisysROPE(llaisysTensor_t out, llaisysTensor_t in, llaisysTensor_t pos_ids, float theta) {
         llaisys::ops::rope(out->tensor, in->tensor, pos_ids->tensor, theta);
     }
+    void llaisysSample(llaisysTensor_t out_idx, llaisysTensor_t logits, llaisysTensor_t ids, llaisysTensor_t prev_tokens, float temperature, size_t top_k, float top_p, float repetition_penalty, float presence_penalty, uint64_t seed) {
+        llaisys::ops::SampleParams params{temperature, top_k, top_p, repetition_penalty, presence_penalty};
+        llaisys::utils::Rng rng(seed);
+        llaisys::ops::sample(out_idx->tensor, logits->tensor, ids ? ids->tensor : nullptr, prev_tokens ? prev_tokens->tensor : nullptr, params, rng);
+    }
     void llaisysSelfAttention(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k, llaisysTensor_t v, float scale) {
         llaisys::ops::self_attention(attn_val->tensor, q->tensor, k->tensor, v->tensor, scale);
     }
+    void llaisysPagedAttention(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k_cache, llaisysTensor_t v_cache, llaisysTensor_t block_table, size_t total_len, float scale) {
+        llaisys::ops::paged_attention(attn_val->tensor, q->tensor, k_cache->tensor, v_cache->tensor, block_table->tensor, total_len, scale);
+    }
+    void llaisysPagedVarlenAttention(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k_cache, llaisysTensor_t v_cache, llaisysTensor_t block_tables, llaisysTensor_t cu_seqlens_q, llaisysTensor_t kv_lens, float scale) {
+        llaisys::ops::paged_varlen_attention(attn_val->tensor, q->tensor, k_cache->tensor, v_cache->tensor, block_tables->tensor, cu_seqlens_q->tensor, kv_lens->tensor, scale);
+    }
+    void llaisysVarlenAttention(llaisysTensor_t attn_val, llaisysTensor_t q, llaisysTensor_t k, llaisysTensor_t v, llaisysTensor_t cu_seqlens_q, llaisysTensor_t cu_seqlens_k, float scale) {
+        llaisys::ops::varlen_attention(attn_val->tensor, q->tensor, k->tensor, v->tensor, cu_seqlens_q->tensor, cu_seqlens_k->tensor, scale);
+    }
     void llaisysSwiGLU(llaisysTensor_t out, llaisysTensor_t gate, llaisysTensor_t up) {
         llaisys::ops::swiglu(out->tensor, gate->tensor, up->tensor);
     }
@@ -0,0 +1,217 @@
+#include "llaisys/models/qwen2.h"
+
+#include "llaisys_tensor.hpp"
+
+#include "../models/qwen2/qwen2_model.hpp"
+#include "../models/qwen2/qwen2_scheduler.hpp"
+#include "../models/qwen2/qwen2_speculative.hpp"
+
+#include <memory>
+#include <vector>
+
+struct LlaisysQwen2Model {
+    std::unique_ptr<llaisys::models::Qwen2Model> model;
+    std::unique_ptr<llaisys::models::Qwen2Scheduler> scheduler;
+    LlaisysQwen2Weights weights;
+    // Handles backing `weights`; they share the model's tensors, so loading
+    // through them fills the weights in place.
+    std::vector<llaisysTensor_t> handles;
+    std::vector<std::vector<llaisysTensor_t>> per_layer;
+};
+
+namespace {
+llaisysTensor_t wrap(LlaisysQwen2Model *model, const llaisys::tensor_t &tensor) {
+    model->handles.push_back(new LlaisysTensor{tensor});
+    return model->handles.back();
+}
+
+llaisysTensor_t *wrap(LlaisysQwen2Model *model, const std::vector<llaisys::tensor_t> &tensors) {
+    std::vector<llaisysTensor_t> layer;
+    for (const auto &tensor : tensors) {
+        layer.push_back(wrap(model, tensor));
+    }
+    model->per_layer.push_back(std::move(layer));
+    return model->per_layer.back().data();
+}
+
+void rebind(llaisysTensor_t handle, const llaisys::tensor_t &tensor) {
+    handle->tensor = tensor;
+}
+
+void rebind(llaisysTensor_t *handles, const std::vector<llaisys::tensor_t> &tensors) {
+    for (size_t i = 0; i < tensors.size(); i++) {
+        handles[i]->tensor = tensors[i];
+    }
+}
+} // namespace
+
+__C {
+    struct LlaisysQwen2Model *llaisysQwen2ModelCreate(const LlaisysQwen2Meta *meta, llaisysDeviceType_t device, int *device_ids, int ndevice,
+                                                      size_t kv_tokens) {
+        int device_id = ndevice > 0 && device_ids != nullptr ? device_ids[0] : 0;
+        auto model = new LlaisysQwen2Model{std::make_unique<llaisys::models::Qwen2Model>(*meta, device, device_id, kv_tokens), nullptr, {}, {}, {}};
+        model->scheduler = std::make_unique<llaisys::models::Qwen2Scheduler>(*model->model);
+
+        auto &w = model->model->weights();
+        model->weights.in_embed = wrap(model, w.in_embed);
+        model->weights.out_embed = wrap(model, w.out_embed);
+        model->weights.out_norm_w = wrap(model, w.out_norm_w);
+        model->weights.attn_norm_w = wrap(model, w.attn_norm_w);
+        model->weights.attn_q_w = wrap(model, w.attn_q_w);
+        model->weights.attn_q_b = wrap(model, w.attn_q_b);
+        model->weights.attn_k_w = wrap(model, w.attn_k_w);
+        model->weights.attn_k_b = wrap(model, w.attn_k_b);
+        model->weights.attn_v_w = wrap(model, w.attn_v_w);
+        model->weights.attn_v_b = wrap(model, w.attn_v_b);
+        model->weights.attn_o_w = wrap(model, w.attn_o_w);
+        model->weights.mlp_norm_w = wrap(model, w.mlp_norm_w);
+        model->weights.mlp_gate_w = wrap(model, w.mlp_gate_w);
+        model->weights.mlp_up_w = wrap(model, w.mlp_up_w);
+        model->weights.mlp_down_w = wrap(model, w.mlp_down_w);
+        return model;
+    }
+
+    void llaisysQwen2ModelDestroy(struct LlaisysQwen2Model * model) {
+        for (auto handle : model->handles) {
+            delete handle;
+        }
+        delete model;
+    }
+
+    struct LlaisysQwen2Weights *llaisysQwen2ModelWeights(struct LlaisysQwen2Model * model) {
+        return &model->weights;
+    }
+
+    void llaisysQwen2ModelQuantizeInt8(struct LlaisysQwen2Model * model, size_t group_size) {
+        model->model->quantizeInt8(group_size);
+        // Dropping the old handles' references frees the original matrices.
+        auto &w = model->model->weights();
+        rebind(model->weights.out_embed, w.out_embed);
+        rebind(model->weights.attn_q_w, w.attn_q_w);
+        rebind(model->weights.attn_k_w, w.attn_k_w);
+        rebind(model->weights.attn_v_w, w.attn_v_w);
+        rebind(model->weights.attn_o_w, w.attn_o_w);
+        rebind(model->weights.mlp_gate_w, w.mlp_gate_w);
+        rebind(model->weights.mlp_up_w, w.mlp_up_w);
+        rebind(model->weights.mlp_down_w, w.mlp_down_w);
+    }
+
+    void llaisysQwen2ModelReset(struct LlaisysQwen2Model * model) {
+        model->model->reset();
+    }
+
+    int64_t llaisysQwen2ModelInfer(struct LlaisysQwen2Model * model, int64_t * token_ids, size_t ntoken) {
+        return model->model->infer(token_ids, ntoken);
+    }
+
+    size_t llaisysQwen2ModelGenerate(struct LlaisysQwen2Model * model, int64_t * token_ids, size_t ntoken,
+                                     size_t max_new_tokens, const struct LlaisysQwen2SamplingParams *sampling,
+                                     llaisysQwen2TokenCallback callback, void *user_data, int64_t *out_tokens) {
+        size_t count = 0;
+        return model->model->generate(token_ids, ntoken, max_new_tokens, *sampling, [&](int64_t token) {
+            if (out_tokens != nullptr) {
+                out_tokens[count] = token;
+            }
+            count++;
+            return callback == nullptr || callback(token, user_data) == 0;
+        });
+    }
+
+    size_t llaisysQwen2ModelGenerateSpeculative(struct LlaisysQwen2Model * model, struct LlaisysQwen2Model * draft_model,
+                                                int64_t * token_ids, size_t ntoken, size_t max_new_tokens, size_t num_draft,
+                                                const struct LlaisysQwen2SamplingParams *sampling,
+                                                llaisysQwen2TokenCallback callback, void *user_data, int64_t *out_tokens,
+                                                struct LlaisysQwen2SpeculativeStats *stats) {
+        std::unique_ptr<llaisys::models::Drafter> drafter;
+        if (draft_model != nullptr) {
+            drafter = std::make_unique<llaisys::models::ModelDrafter>(*draft_model->model);
+        } else {
+            drafter = std::make_unique<llaisys::models::PromptLookupDrafter>();
+        }
+        llaisys::models::SpeculativeStats result;
+        size_t count = 0;
+        size_t generated = model->model->generateSpeculative(
+            token_ids, ntoken, max_new_tokens, *sampling, *drafter, num_draft, [&](int64_t token) {
+                if (out_tokens != nullptr) {
+                    out_tokens[count] = token;
+                }
+                count++;
+                return callback == nullptr || callback(token, user_data) == 0;
+            },
+            result);
+        if (stats != nullptr) {
+            *stats = LlaisysQwen2SpeculativeStats{result.drafted, result.accepted, result.steps};
+        }
+        return generated;
+    }
+
+    void llaisysQwen2ModelGenerateN(struct LlaisysQwen2Model * model, const int64_t *token_ids, size_t ntoken, size_t n,
+                                    size_t max_new_tokens, const struct LlaisysQwen2SamplingParams *sampling,
+                                    int64_t *out_tokens, size_t *out_lengths) {
+        model->model->generateN(token_ids, ntoken, n, max_new_tokens, *sampling, out_tokens, out_lengths);
+    }
+
+    size_t llaisysQwen2ModelBeamSearch(struct LlaisysQwen2Model * model, const int64_t *token_ids, size_t ntoken,
+                                       size_t beam_width, size_t max_new_tokens, int64_t *out_tokens) {
+        return model->model->beamSearch(token_ids, ntoken, beam_width, max_new_tokens, out_tokens);
+    }
+
+    int64_t llaisysQwen2ModelCreateSequence(struct LlaisysQwen2Model * model) {
+        return model->model->createSequence();
+    }
+
+    void llaisysQwen2ModelReleaseSequence(struct LlaisysQwen2Model * model, int64_t seq) {
+        model->model->releaseSequence(seq);
+    }
+
+    int64_t llaisysQwen2ModelForkSequence(struct LlaisysQwen2Model * model, int64_t seq) {
+        return model->model->forkSequence(seq);
+    }
+
+    size_t llaisysQwen2ModelFreeKVTokens(struct LlaisysQwen2Model * model) {
+        return model->model->freeKVTokens();
+    }
+
+    uint8_t llaisysQwen2ModelStep(struct LlaisysQwen2Model * model, const int64_t *seq_ids, size_t nseq,
+                                  const int64_t *token_ids, const size_t *ntokens,
+                                  const struct LlaisysQwen2SamplingParams *sampling, int64_t *out_tokens) {
+        return uint8_t(model->model->step(seq_ids, nseq, token_ids, ntokens, sampling, out_tokens));
+    }
+
+    void llaisysQwen2ModelSetPrefixCaching(struct LlaisysQwen2Model * model, uint8_t enabled) {
+        model->model->setPrefixCaching(enabled != 0);
+    }
+
+    int64_t llaisysQwen2ModelSubmit(struct LlaisysQwen2Model * model, const int64_t *token_ids, size_t ntoken,
+                                    size_t max_new_tokens, const struct LlaisysQwen2SamplingParams *sampling) {
+        LlaisysQwen2SamplingParams greedy{0.0f, 1, 1.0f, 0, 1.0f, 0.0f};
+        return model->scheduler->submit(token_ids, ntoken, max_new_tokens, sampling != nullptr ? *sampling : greedy);
+    }
+
+    void llaisysQwen2ModelCancel(struct LlaisysQwen2Model * model, int64_t request) {
+        model->scheduler->cancel(request);
+    }
+
+    size_t llaisysQwen2ModelPending(struct LlaisysQwen2Model * model) {
+        return model->scheduler->numPending();
+    }
+
+    void llaisysQwen2ModelSetChunkTokens(struct LlaisysQwen2Model * model, size_t ntoken) {
+        model->scheduler->setChunkTokens(ntoken);
+    }
+
+    size_t llaisysQwen2ModelScheduleStep(struct LlaisysQwen2Model * model, int64_t *out_requests, int64_t *out_tokens,
+                                         uint8_t *out_finished) {
+        const auto &events = model->scheduler->step();
+        for (size_t i = 0; i < events.size(); i++) {
+            out_requests[i] = events[i].request;
+            out_tokens[i] = events[i].token;
+            out_finished[i] = events[i].finished;
+        }
+        return events.size();
+    }
+
+    size_t llaisysQwen2ActivationBytes(const LlaisysQwen2Meta *meta, size_t max_tokens, size_t max_seqs) {
+        return llaisys::models::Qwen2Activations::arenaBytes(*meta, max_tokens, max_seqs);
+    }
+}
@@ -1,5 +1,6 @@
 #include "llaisys/runtime.h"
 #include "../core/context/context.hpp"
+#include "../core/thread_pool/thread_pool.hpp"
 #include "../device/runtime_api.hpp"
 
 // Llaisys API for setting context runtime.
@@ -7,6 +8,34 @@ __C void llaisysSetContextRuntime(llaisysDeviceType_t device_type, int device_id
     llaisys::core::context().setDevice(device_type, device_id);
 }
 
+// Llaisys API for choosing the device allocator of the context runtime.
+__C void llaisysSetContextAllocator(llaisysAllocatorType_t type, size_t cache_limit) {
+    llaisys::core::context().runtime().setAllocator(type, cache_limit);
+}
+
+// Llaisys API for returning cached device memory of the context runtime.
+__C void llaisysEmptyCache() {
+    llaisys::core::context().runtime().emptyCache();
+}
+
+// Llaisys API for the allocator statistics of the context runtime.
+__C size_t llaisysMemoryAllocated() {
+    return llaisys::core::context().runtime().memoryAllocated();
+}
+
+__C size_t llaisysMemoryReserved() {
+    return llaisys::core::context().runtime().memoryReserved();
+}
+
+// Llaisys API for sizing the CPU thread pool.
+__C void llaisysSetNumThreads(size_t nthreads) {
+    llaisys::core::threadPool().setNumThreads(nthreads);
+}
+
+__C size_t llaisysGetNumThreads() {
+    return llaisys::core::threadPool().numThreads();
+}
+
 // Llaisys API for getting the runtime APIs
 __C const LlaisysRuntimeAPI *llaisysGetRuntimeAPI(llaisysDeviceType_t device_type) {
     return llaisys::device::getRuntimeAPI(device_type);
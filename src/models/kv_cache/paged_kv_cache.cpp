@@ -0,0 +1,224 @@
+#include "paged_kv_cache.hpp"
+
+#include "../../utils.hpp"
+
+#include <algorithm>
+
+namespace llaisys::models {
+PagedKVCache::PagedKVCache(size_t nlayer, size_t nkvh, size_t dh, size_t block_size, size_t nblocks,
+                           llaisysDataType_t dtype, llaisysDeviceType_t device_type, int device_id)
+    : _nkvh(nkvh), _dh(dh), _block_size(block_size), _nblocks(nblocks), _dtype(dtype), _device_type(device_type), _device_id(device_id) {
+    CHECK_ARGUMENT(block_size > 0 && nblocks > 0, "PagedKVCache: block size and block count must be positive.");
+    for (size_t layer = 0; layer < nlayer; layer++) {
+        _keys.push_back(Tensor::create({nblocks, block_size, nkvh, dh}, dtype, device_type, device_id));
+        _values.push_back(Tensor::create({nblocks, block_size, nkvh, dh}, dtype, device_type, device_id));
+    }
+    // Hand out low block ids first.
+    _free_blocks.resize(nblocks);
+    for (size_t i = 0; i < nblocks; i++) {
+        _free_blocks[i] = static_cast<int64_t>(nblocks - 1 - i);
+    }
+    _refs.assign(nblocks, 0);
+}
+
+size_t PagedKVCache::blockSize() const {
+    return _block_size;
+}
+
+size_t PagedKVCache::numBlocks() const {
+    return _nblocks;
+}
+
+size_t PagedKVCache::numFreeBlocks() const {
+    return _free_blocks.size();
+}
+
+tensor_t PagedKVCache::keys(size_t layer) const {
+    return _keys.at(layer);
+}
+
+tensor_t PagedKVCache::values(size_t layer) const {
+    return _values.at(layer);
+}
+
+PagedKVCache::seq_t PagedKVCache::createSequence() {
+    seq_t seq = _next_seq++;
+    _sequences.emplace(seq, Sequence{});
+    return seq;
+}
+
+PagedKVCache::seq_t PagedKVCache::fork(seq_t seq) {
+    Sequence copy = _sequence(seq);
+    for (int64_t block : copy.blocks) {
+        retain(block);
+    }
+    seq_t child = _next_seq++;
+    _sequences.emplace(child, std::move(copy));
+    return child;
+}
+
+void PagedKVCache::releaseSequence(seq_t seq) {
+    Sequence &sequence = _sequence(seq);
+    for (auto it = sequence.blocks.rbegin(); it != sequence.blocks.rend(); ++it) {
+        release(*it);
+    }
+    _sequences.erase(seq);
+}
+
+bool PagedKVCache::hasSequence(seq_t seq) const {
+    return _sequences.count(seq) != 0;
+}
+
+size_t PagedKVCache::length(seq_t seq) const {
+    return _sequence(seq).length;
+}
+
+size_t PagedKVCache::blocksNeeded(seq_t seq, size_t ntoken) const {
+    const Sequence &sequence = _sequence(seq);
+    size_t needed = (sequence.length + ntoken + _block_size - 1) / _block_size;
+    size_t added = needed - std::min(needed, sequence.blocks.size());
+    return added + (ntoken > 0 && sharesLastBlock(seq) ? 1 : 0);
+}
+
+bool PagedKVCache::sharesLastBlock(seq_t seq) const {
+    const Sequence &sequence = _sequence(seq);
+    size_t tail = sequence.length / _block_size;
+    return sequence.length % _block_size != 0 && _refs[sequence.blocks[tail]] > 1;
+}
+
+bool PagedKVCache::reserve(seq_t seq, size_t ntoken) {
+    if (blocksNeeded(seq, ntoken) > _free_blocks.size()) {
+        return false;
+    }
+    Sequence &sequence = _sequence(seq);
+    if (ntoken > 0 && sharesLastBlock(seq)) {
+        int64_t &tail = sequence.blocks[sequence.length / _block_size];
+        int64_t copy = _allocate();
+        _copyBlock(copy, tail, sequence.length % _block_size);
+        release(tail);
+        tail = copy;
+    }
+    size_t needed = (sequence.length + ntoken + _block_size - 1) / _block_size;
+    while (sequence.blocks.size() < needed) {
+        sequence.blocks.push_back(_allocate());
+    }
+    return true;
+}
+
+void PagedKVCache::share(seq_t seq, const std::vector<int64_t> &blocks) {
+    Sequence &sequence = _sequence(seq);
+    CHECK_ARGUMENT(sequence.blocks.empty(), "PagedKVCache: can only share blocks into an empty sequence.");
+    for (int64_t block : blocks) {
+        retain(block);
+    }
+    sequence.blocks = blocks;
+    sequence.length = blocks.size() * _block_size;
+}
+
+void PagedKVCache::retain(int64_t block) {
+    CHECK_ARGUMENT(block >= 0 && static_cast<size_t>(block) < _nblocks && _refs[block] > 0, "PagedKVCache: retaining a free block.");
+    _refs[block]++;
+}
+
+void PagedKVCache::release(int64_t block) {
+    CHECK_ARGUMENT(block >= 0 && static_cast<size_t>(block) < _nblocks && _refs[block] > 0, "PagedKVCache: releasing a free block.");
+    if (--_refs[block] == 0) {
+        _free_blocks.push_back(block);
+    }
+}
+
+size_t PagedKVCache::refCount(int64_t block) const {
+    return _refs.at(block);
+}
+
+void PagedKVCache::write(size_t layer, seq_t seq, tensor_t k, tensor_t v) {
+    const Sequence &sequence = _sequence(seq);
+    CHECK_SAME_DTYPE(_dtype, k->dtype(), v->dtype());
+    CHECK_SAME_SHAPE(k->shape(), v->shape());
+    ASSERT(k->isContiguous() && v->isContiguous(), "PagedKVCache: k and v must be contiguous.");
+    ASSERT(k->ndim() == 3 && k->shape()[1] == _nkvh && k->shape()[2] == _dh, "PagedKVCache: expected k/v of shape [n, nkvh, dh].");
+    size_t ntoken = k->shape()[0];
+    ASSERT(sequence.length + ntoken <= sequence.blocks.size() * _block_size, "PagedKVCache: write past the reserved blocks.");
+
+    _copyRows(_keys.at(layer)->data(), k->data(), sequence, ntoken);
+    _copyRows(_values.at(layer)->data(), v->data(), sequence, ntoken);
+}
+
+void PagedKVCache::advance(seq_t seq, size_t ntoken) {
+    Sequence &sequence = _sequence(seq);
+    ASSERT(sequence.length + ntoken <= sequence.blocks.size() * _block_size, "PagedKVCache: advance past the reserved blocks.");
+    sequence.length += ntoken;
+}
+
+void PagedKVCache::truncate(seq_t seq, size_t ntoken) {
+    Sequence &sequence = _sequence(seq);
+    CHECK_ARGUMENT(ntoken <= sequence.length, "PagedKVCache: truncating past the end of a sequence.");
+    size_t needed = (ntoken + _block_size - 1) / _block_size;
+    while (sequence.blocks.size() > needed) {
+        release(sequence.blocks.back());
+        sequence.blocks.pop_back();
+    }
+    sequence.length = ntoken;
+}
+
+const std::vector<int64_t> &PagedKVCache::blocks(seq_t seq) const {
+    return _sequence(seq).blocks;
+}
+
+tensor_t PagedKVCache::blockTable(seq_t seq) const {
+    const Sequence &sequence = _sequence(seq);
+    auto table = Tensor::create({std::max<size_t>(sequence.blocks.size(), 1)}, LLAISYS_DTYPE_I64, _device_type, _device_id);
+    if (!sequence.blocks.empty()) {
+        table->load(sequence.blocks.data());
+    }
+    return table;
+}
+
+PagedKVCache::Sequence &PagedKVCache::_sequence(seq_t seq) {
+    auto it = _sequences.find(seq);
+    CHECK_ARGUMENT(it != _sequences.end(), "PagedKVCache: unknown sequence.");
+    return it->second;
+}
+
+const PagedKVCache::Sequence &PagedKVCache::_sequence(seq_t seq) const {
+    auto it = _sequences.find(seq);
+    CHECK_ARGUMENT(it != _sequences.end(), "PagedKVCache: unknown sequence.");
+    return it->second;
+}
+
+int64_t PagedKVCache::_allocate() {
+    int64_t block = _free_blocks.back();
+    _free_blocks.pop_back();
+    _refs[block] = 1;
+    return block;
+}
+
+// Copies the first ntoken rows of a block in every layer.
+void PagedKVCache::_copyBlock(int64_t dst, int64_t src, size_t ntoken) const {
+    size_t block_bytes = _block_size * _nkvh * _dh * utils::dsize(_dtype);
+    size_t bytes = ntoken * _nkvh * _dh * utils::dsize(_dtype);
+    core::context().setDevice(_device_type, _device_id);
+    auto api = core::context().runtime().api();
+    for (size_t layer = 0; layer < _keys.size(); layer++) {
+        for (const tensor_t &pool : {_keys[layer], _values[layer]}) {
+            api->memcpy_sync(pool->data() + dst * block_bytes, pool->data() + src * block_bytes, bytes, LLAISYS_MEMCPY_D2D);
+        }
+    }
+}
+
+// Tokens are contiguous within a block, so each block is filled by one copy.
+void PagedKVCache::_copyRows(std::byte *pool, const std::byte *src, const Sequence &sequence, size_t ntoken) const {
+    size_t row_bytes = _nkvh * _dh * utils::dsize(_dtype);
+    core::context().setDevice(_device_type, _device_id);
+    auto api = core::context().runtime().api();
+    size_t pos = sequence.length;
+    for (size_t done = 0; done < ntoken;) {
+        size_t block = static_cast<size_t>(sequence.blocks[pos / _block_size]);
+        size_t offset = pos % _block_size;
+        size_t n = std::min(_block_size - offset, ntoken - done);
+        api->memcpy_sync(pool + (block * _block_size + offset) * row_bytes, src + done * row_bytes, n * row_bytes, LLAISYS_MEMCPY_D2D);
+        done += n;
+        pos += n;
+    }
+}
+} // namespace llaisys::models
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "../../tensor/tensor.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace llaisys::models {
+// KV cache shared by all sequences of a model. Memory is a fixed pool of
+// blocks holding `block_size` tokens each, per layer laid out as
+// [nblocks, block_size, nkvh, dh]; every sequence owns a block table listing
+// the blocks that hold its tokens in order. Blocks are handed out from a free
+// list, so concurrent sequences only pay for the tokens they actually hold.
+//
+// Blocks are reference counted: a block can be shared by several sequences
+// and by outside holders such as a prefix cache, and returns to the free list
+// when its last holder lets go. Sequences only ever write past their length,
+// so the one shared block that can still be written is the partially filled
+// last block of a fork; reserve() gives the writer a private copy first.
+class PagedKVCache {
+public:
+    using seq_t = int64_t;
+
+    PagedKVCache(size_t nlayer, size_t nkvh, size_t dh, size_t block_size, size_t nblocks,
+                 llaisysDataType_t dtype, llaisysDeviceType_t device_type, int device_id);
+    ~PagedKVCache() = default;
+
+    PagedKVCache(const PagedKVCache &) = delete;
+    PagedKVCache &operator=(const PagedKVCache &) = delete;
+
+    size_t blockSize() const;
+    size_t numBlocks() const;
+    size_t numFreeBlocks() const;
+
+    // Block pools of one layer, [nblocks, block_size, nkvh, dh].
+    tensor_t keys(size_t layer) const;
+    tensor_t values(size_t layer) const;
+
+    seq_t createSequence();
+    // A new sequence sharing every block and the length of `seq`.
+    seq_t fork(seq_t seq);
+    // Returns every block of the sequence to the free list.
+    void releaseSequence(seq_t seq);
+    bool hasSequence(seq_t seq) const;
+
+    // Number of tokens committed with advance().
+    size_t length(seq_t seq) const;
+    // Free blocks reserve(seq, ntoken) would take, counting the copy of a
+    // shared last block.
+    size_t blocksNeeded(seq_t seq, size_t ntoken) const;
+    // Whether the partially filled last block is shared, so that the next
+    // reserve() replaces it in the block table with a copy.
+    bool sharesLastBlock(seq_t seq) const;
+    // Grows the block table so that ntoken more tokens fit. Returns false and
+    // leaves the sequence unchanged if the pool has too few free blocks.
+    bool reserve(seq_t seq, size_t ntoken);
+    // Copies k/v rows [n, nkvh, dh] of one layer to positions [length, length + n).
+    void write(size_t layer, seq_t seq, tensor_t k, tensor_t v);
+    // Commits n written tokens once every layer has been written.
+    void advance(seq_t seq, size_t ntoken);
+    // Keeps the first ntoken tokens, e.g. to drop rejected speculative ones,
+    // and releases the blocks past them.
+    void truncate(seq_t seq, size_t ntoken);
+
+    // Makes the full blocks `blocks` the start of an empty sequence, which
+    // then holds blocks.size() * block_size tokens.
+    void share(seq_t seq, const std::vector<int64_t> &blocks);
+    // References held outside of any sequence.
+    void retain(int64_t block);
+    void release(int64_t block);
+    size_t refCount(int64_t block) const;
+
+    const std::vector<int64_t> &blocks(seq_t seq) const;
+    // Block table as an i64 tensor on the cache device, for paged attention.
+    tensor_t blockTable(seq_t seq) const;
+
+private:
+    struct Sequence {
+        std::vector<int64_t> blocks;
+        size_t length = 0;
+    };
+
+    Sequence &_sequence(seq_t seq);
+    const Sequence &_sequence(seq_t seq) const;
+    void _copyRows(std::byte *pool, const std::byte *src, const Sequence &sequence, size_t ntoken) const;
+    int64_t _allocate();
+    void _copyBlock(int64_t dst, int64_t src, size_t ntoken) const;
+
+    size_t _nkvh;
+    size_t _dh;
+    size_t _block_size;
+    size_t _nblocks;
+    llaisysDataType_t _dtype;
+    llaisysDeviceType_t _device_type;
+    int _device_id;
+
+    std::vector<tensor_t> _keys;
+    std::vector<tensor_t> _values;
+    std::vector<int64_t> _free_blocks;
+    std::vector<uint32_t> _refs;
+    std::unordered_map<seq_t, Sequence> _sequences;
+    seq_t _next_seq = 0;
+};
+} // namespace llaisys::models
@@ -0,0 +1,129 @@
+#include "prefix_cache.hpp"
+
+#include "../../utils.hpp"
+
+#include <queue>
+
+namespace llaisys::models {
+PrefixCache::PrefixCache(PagedKVCache &kv_cache) : _kv_cache(kv_cache) {}
+
+PrefixCache::~PrefixCache() {
+    clear();
+}
+
+std::vector<int64_t> PrefixCache::match(const int64_t *tokens, size_t ntoken) {
+    size_t block_size = _kv_cache.blockSize();
+    std::vector<int64_t> blocks;
+    std::vector<int64_t> key(block_size);
+    uint64_t now = ++_clock;
+    Node *node = &_root;
+    for (size_t pos = 0; pos + block_size <= ntoken; pos += block_size) {
+        key.assign(tokens + pos, tokens + pos + block_size);
+        auto it = node->children.find(key);
+        if (it == node->children.end()) {
+            break;
+        }
+        node = it->second.get();
+        node->last_used = now;
+        blocks.push_back(node->block);
+    }
+    return blocks;
+}
+
+void PrefixCache::insert(const int64_t *tokens, size_t ntoken, const std::vector<int64_t> &blocks) {
+    size_t block_size = _kv_cache.blockSize();
+    CHECK_ARGUMENT(blocks.size() * block_size >= ntoken / block_size * block_size, "PrefixCache: too few blocks for the tokens.");
+    std::vector<int64_t> key(block_size);
+    uint64_t now = ++_clock;
+    Node *node = &_root;
+    for (size_t pos = 0, i = 0; pos + block_size <= ntoken; pos += block_size, i++) {
+        key.assign(tokens + pos, tokens + pos + block_size);
+        auto &child = node->children[key];
+        if (child == nullptr) {
+            child = std::make_unique<Node>();
+            child->key = key;
+            child->block = blocks[i];
+            child->parent = node;
+            _kv_cache.retain(blocks[i]);
+            _nblocks++;
+        }
+        node = child.get();
+        node->last_used = now;
+    }
+}
+
+size_t PrefixCache::numBlocks() const {
+    return _nblocks;
+}
+
+// Only whole subtrees of blocks that just the tree references can be evicted,
+// leaves first. A sequence may hold a block whose parent it does not hold,
+// when its prefill raced another one over the same prefix, so an unused
+// block above a used one does not count.
+size_t PrefixCache::numEvictable() const {
+    size_t count = 0;
+    _countEvictable(&_root, count);
+    return count;
+}
+
+bool PrefixCache::_countEvictable(const Node *node, size_t &count) const {
+    bool whole = node == &_root || _kv_cache.refCount(node->block) == 1;
+    for (const auto &[key, child] : node->children) {
+        whole = _countEvictable(child.get(), count) && whole;
+    }
+    if (whole && node != &_root) {
+        count++;
+    }
+    return whole;
+}
+
+size_t PrefixCache::evict(size_t nblocks) {
+    auto older = [](const Node *a, const Node *b) { return a->last_used > b->last_used; };
+    std::priority_queue<Node *, std::vector<Node *>, decltype(older)> leaves(older);
+    std::vector<Node *> stack{&_root};
+    while (!stack.empty()) {
+        Node *node = stack.back();
+        stack.pop_back();
+        for (auto &[key, child] : node->children) {
+            if (child->children.empty()) {
+                if (_kv_cache.refCount(child->block) == 1) {
+                    leaves.push(child.get());
+                }
+            } else {
+                stack.push_back(child.get());
+            }
+        }
+    }
+
+    size_t freed = 0;
+    while (freed < nblocks && !leaves.empty()) {
+        Node *leaf = leaves.top();
+        leaves.pop();
+        Node *parent = leaf->parent;
+        _remove(leaf);
+        freed++;
+        if (parent != &_root && parent->children.empty() && _kv_cache.refCount(parent->block) == 1) {
+            leaves.push(parent);
+        }
+    }
+    return freed;
+}
+
+void PrefixCache::clear() {
+    while (!_root.children.empty()) {
+        Node *node = _root.children.begin()->second.get();
+        while (!node->children.empty()) {
+            node = node->children.begin()->second.get();
+        }
+        _remove(node);
+    }
+}
+
+void PrefixCache::_remove(Node *node) {
+    _kv_cache.release(node->block);
+    _nblocks--;
+    // Erase by iterator: the key lives in the node being destroyed.
+    auto &siblings = node->parent->children;
+    siblings.erase(siblings.find(node->key));
+}
+} // namespace llaisys::models
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "paged_kv_cache.hpp"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace llaisys::models {
+// Radix tree over the full blocks of a PagedKVCache, keyed by the token ids
+// they hold. Every edge is one block of tokens, so a path from the root spells
+// a prompt prefix and lists the blocks that already hold its K/V rows. The
+// tree keeps a reference on each of its blocks; sequences sharing them add
+// their own.
+//
+// Blocks that only the tree still references are evictable. Eviction takes
+// least recently used leaves first, so a prefix stays cached as long as any
+// of its extensions does.
+class PrefixCache {
+public:
+    explicit PrefixCache(PagedKVCache &kv_cache);
+    ~PrefixCache();
+
+    PrefixCache(const PrefixCache &) = delete;
+    PrefixCache &operator=(const PrefixCache &) = delete;
+
+    // Blocks holding the longest cached prefix of the first ntoken tokens.
+    // Marks the prefix as used.
+    std::vector<int64_t> match(const int64_t *tokens, size_t ntoken);
+    // Adds the full blocks among the first ntoken tokens, held by `blocks`
+    // in order. Prefixes already cached keep their blocks.
+    void insert(const int64_t *tokens, size_t ntoken, const std::vector<int64_t> &blocks);
+
+    // Blocks held by the tree, and those among them no sequence uses.
+    size_t numBlocks() const;
+    size_t numEvictable() const;
+    // Frees up to nblocks evictable blocks; returns how many were freed.
+    size_t evict(size_t nblocks);
+    void clear();
+
+private:
+    struct Node {
+        std::vector<int64_t> key;
+        int64_t block = -1;
+        uint64_t last_used = 0;
+        Node *parent = nullptr;
+        std::map<std::vector<int64_t>, std::unique_ptr<Node>> children;
+    };
+
+    // Adds the blocks of node's subtree that can be evicted to count;
+    // returns whether the whole subtree can.
+    bool _countEvictable(const Node *node, size_t &count) const;
+    void _remove(Node *node);
+
+    PagedKVCache &_kv_cache;
+    Node _root;
+    size_t _nblocks = 0;
+    uint64_t _clock = 0;
+};
+} // namespace llaisys::models
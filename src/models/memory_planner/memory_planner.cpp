@@ -0,0 +1,82 @@
+#include "memory_planner.hpp"
+
+#include "../../utils.hpp"
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+
+namespace llaisys::models {
+MemoryPlanner::MemoryPlanner(size_t alignment) : _alignment(alignment) {
+    CHECK_ARGUMENT(alignment > 0, "MemoryPlanner: alignment must be positive.");
+}
+
+MemoryPlanner::buffer_t MemoryPlanner::add(size_t bytes, size_t first, size_t last) {
+    CHECK_ARGUMENT(first <= last, "MemoryPlanner: a buffer must be live for at least one step.");
+    _buffers.push_back(Buffer{bytes, first, last, 0});
+    _planned = false;
+    return _buffers.size() - 1;
+}
+
+void MemoryPlanner::plan() {
+    std::vector<size_t> order(_buffers.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return _buffers[a].bytes > _buffers[b].bytes;
+    });
+
+    std::vector<size_t> placed;
+    _arena_bytes = 0;
+    for (size_t id : order) {
+        Buffer &buffer = _buffers[id];
+        // Occupied ranges of the placed buffers live together with this one,
+        // by start offset.
+        std::multimap<size_t, size_t> occupied;
+        for (size_t other : placed) {
+            const Buffer &o = _buffers[other];
+            if (o.first <= buffer.last && buffer.first <= o.last) {
+                occupied.emplace(o.offset, o.offset + o.bytes);
+            }
+        }
+        size_t offset = 0;
+        for (auto [begin, end] : occupied) {
+            if (offset + buffer.bytes <= begin) {
+                break;
+            }
+            offset = std::max(offset, (end + _alignment - 1) / _alignment * _alignment);
+        }
+        buffer.offset = offset;
+        _arena_bytes = std::max(_arena_bytes, offset + buffer.bytes);
+        placed.push_back(id);
+    }
+    _planned = true;
+}
+
+size_t MemoryPlanner::offset(buffer_t buffer) const {
+    ASSERT(_planned, "MemoryPlanner: plan() has not been run.");
+    return _buffers.at(buffer).offset;
+}
+
+size_t MemoryPlanner::size(buffer_t buffer) const {
+    return _buffers.at(buffer).bytes;
+}
+
+size_t MemoryPlanner::arenaBytes() const {
+    ASSERT(_planned, "MemoryPlanner: plan() has not been run.");
+    return _arena_bytes;
+}
+
+size_t MemoryPlanner::peakLiveBytes() const {
+    size_t steps = 0;
+    for (const Buffer &buffer : _buffers) {
+        steps = std::max(steps, buffer.last + 1);
+    }
+    std::vector<size_t> live(steps, 0);
+    for (const Buffer &buffer : _buffers) {
+        for (size_t step = buffer.first; step <= buffer.last; step++) {
+            live[step] += buffer.bytes;
+        }
+    }
+    return live.empty() ? 0 : *std::max_element(live.begin(), live.end());
+}
+} // namespace llaisys::models
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace llaisys::models {
+// Lays out buffers with known lifetimes in one arena. Each buffer is live over
+// an inclusive range of steps of a fixed schedule; buffers whose lifetimes
+// overlap get disjoint bytes, the others may share them.
+//
+// Placement is greedy by size: largest buffers first, each at the lowest
+// aligned offset that does not collide with an already placed buffer it is
+// live together with.
+class MemoryPlanner {
+public:
+    using buffer_t = size_t;
+
+    explicit MemoryPlanner(size_t alignment = 64);
+
+    // Registers `bytes` live from step `first` through step `last`.
+    buffer_t add(size_t bytes, size_t first, size_t last);
+    // Assigns offsets to every registered buffer.
+    void plan();
+
+    size_t offset(buffer_t buffer) const;
+    size_t size(buffer_t buffer) const;
+    // Arena size needed by the plan.
+    size_t arenaBytes() const;
+    // Largest sum of buffer sizes live at one step: a lower bound on arenaBytes().
+    size_t peakLiveBytes() const;
+
+private:
+    struct Buffer {
+        size_t bytes;
+        size_t first;
+        size_t last;
+        size_t offset;
+    };
+
+    size_t _alignment;
+    std::vector<Buffer> _buffers;
+    size_t _arena_bytes = 0;
+    bool _planned = false;
+};
+} // namespace llaisys::models
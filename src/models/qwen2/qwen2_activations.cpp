@@ -0,0 +1,108 @@
+#include "qwen2_activations.hpp"
+
+#include "../memory_planner/memory_planner.hpp"
+
+#include "../../utils.hpp"
+
+namespace llaisys::models {
+namespace {
+struct ActivationSpec {
+    bool per_seq; // one row per sequence instead of per token
+    size_t cols;  // 0 for 1-D activations
+    llaisysDataType_t dtype;
+    // Inclusive live range in the step schedule (see specs()).
+    size_t first;
+    size_t last;
+};
+
+// Steps: 0 embedding, 1 attention norm, 2 q/k/v projection fused with rope
+// and the KV cache append, 3 attention, 4 o projection, 5 residual add fused
+// with the mlp norm, 6 gate/up projection fused with swiglu, 7 down
+// projection, 8 residual add fused with the next layer's attention norm,
+// 9 gather of the last rows, 10 final norm, 11 lm head, 12 argmax, or else
+// the fused norm, lm head and top-k. Steps 1-8 repeat for every layer, but
+// only the first layer runs step 1 itself, so ATTN_NORMED stays live across
+// layers.
+std::array<ActivationSpec, static_cast<size_t>(Qwen2Activation::COUNT)> specs(const LlaisysQwen2Meta &meta) {
+    llaisysDataType_t dt = meta.dtype;
+    return {{
+        {false, 0, LLAISYS_DTYPE_I64, 0, 0},          // TOKEN_IDS
+        {false, 0, LLAISYS_DTYPE_I64, 0, 8},          // POS_IDS
+        {false, 0, LLAISYS_DTYPE_I64, 0, 8},          // SLOT_IDS
+        {false, meta.hs, dt, 0, 9},                   // HIDDEN
+        {false, meta.hs, dt, 1, 8},                   // ATTN_NORMED
+        {false, meta.nh * meta.dh, dt, 2, 3},         // Q
+        {false, meta.nh * meta.dh, dt, 3, 4},         // ATTN
+        {false, meta.hs, dt, 4, 5},                   // ATTN_OUT
+        {false, meta.hs, dt, 5, 6},                   // MLP_NORMED
+        {false, meta.di, dt, 6, 7},                   // MLP_ACT
+        {false, meta.hs, dt, 7, 8},                   // MLP_OUT
+        {true, meta.hs, dt, 9, 12},                   // LAST_HIDDEN
+        {true, meta.hs, dt, 10, 11},                  // LAST_NORMED
+        {true, meta.voc, dt, 11, 12},                 // LOGITS
+        {true, 0, LLAISYS_DTYPE_I64, 12, 12},         // NEXT_TOKEN
+        {true, 0, dt, 12, 12},                        // NEXT_LOGIT
+    }};
+}
+
+std::vector<size_t> shape_of(const ActivationSpec &spec, size_t max_tokens, size_t max_seqs) {
+    size_t rows = spec.per_seq ? max_seqs : max_tokens;
+    if (spec.cols == 0) {
+        return {rows};
+    }
+    return {rows, spec.cols};
+}
+
+MemoryPlanner plan(const LlaisysQwen2Meta &meta, size_t max_tokens, size_t max_seqs, std::vector<MemoryPlanner::buffer_t> &buffers) {
+    CHECK_ARGUMENT(max_tokens > 0 && max_seqs > 0 && max_seqs <= max_tokens,
+                   "Qwen2Activations: need 0 < max_seqs <= max_tokens.");
+    MemoryPlanner planner;
+    for (const ActivationSpec &spec : specs(meta)) {
+        size_t numel = 1;
+        for (size_t dim : shape_of(spec, max_tokens, max_seqs)) {
+            numel *= dim;
+        }
+        buffers.push_back(planner.add(numel * utils::dsize(spec.dtype), spec.first, spec.last));
+    }
+    planner.plan();
+    return planner;
+}
+} // namespace
+
+Qwen2Activations::Qwen2Activations(const LlaisysQwen2Meta &meta, size_t max_tokens, size_t max_seqs,
+                                   llaisysDeviceType_t device_type, int device_id)
+    : _max_tokens(max_tokens), _max_seqs(max_seqs) {
+    std::vector<MemoryPlanner::buffer_t> buffers;
+    MemoryPlanner planner = plan(meta, max_tokens, max_seqs, buffers);
+
+    core::context().setDevice(device_type, device_id);
+    _arena = core::context().runtime().allocateDeviceStorage(planner.arenaBytes());
+    auto all = specs(meta);
+    for (size_t i = 0; i < all.size(); i++) {
+        _tensors[i] = Tensor::create(shape_of(all[i], max_tokens, max_seqs), all[i].dtype, _arena, planner.offset(buffers[i]));
+    }
+}
+
+size_t Qwen2Activations::arenaBytes(const LlaisysQwen2Meta &meta, size_t max_tokens, size_t max_seqs) {
+    std::vector<MemoryPlanner::buffer_t> buffers;
+    return plan(meta, max_tokens, max_seqs, buffers).arenaBytes();
+}
+
+size_t Qwen2Activations::maxTokens() const {
+    return _max_tokens;
+}
+
+size_t Qwen2Activations::maxSeqs() const {
+    return _max_seqs;
+}
+
+size_t Qwen2Activations::bytes() const {
+    return _arena->size();
+}
+
+tensor_t Qwen2Activations::get(Qwen2Activation activation, size_t rows) const {
+    const tensor_t &full = _tensors.at(static_cast<size_t>(activation));
+    CHECK_ARGUMENT(rows <= full->shape()[0], "Qwen2Activations: more rows than planned for.");
+    return full->slice(0, 0, rows);
+}
+} // namespace llaisys::models
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "llaisys/models/qwen2.h"
+
+#include "../../tensor/tensor.hpp"
+
+#include <array>
+
+namespace llaisys::models {
+// Intermediates of one Qwen2 forward step, in schedule order. Rows are tokens
+// of the step, except for the LAST_* / LOGITS / NEXT_* rows, which hold one
+// row per sequence.
+enum class Qwen2Activation : size_t {
+    TOKEN_IDS,   // [tokens] i64
+    POS_IDS,     // [tokens] i64
+    SLOT_IDS,    // [tokens] i64, KV cache row of every token
+    HIDDEN,      // [tokens, hs], the residual stream
+    ATTN_NORMED, // [tokens, hs]
+    Q,           // [tokens, nh * dh], rotated; K and V go to the KV cache
+    ATTN,        // [tokens, nh * dh]
+    ATTN_OUT,    // [tokens, hs]
+    MLP_NORMED,  // [tokens, hs]
+    MLP_ACT,     // [tokens, di]
+    MLP_OUT,     // [tokens, hs]
+    LAST_HIDDEN, // [seqs, hs], last row of every sequence
+    LAST_NORMED, // [seqs, hs]
+    LOGITS,      // [seqs, voc]
+    NEXT_TOKEN,  // [seqs] i64
+    NEXT_LOGIT,  // [seqs]
+    COUNT,
+};
+
+// Every activation of a forward step, planned once for up to `max_tokens`
+// tokens across up to `max_seqs` sequences and carved out of one arena, so a
+// step allocates no device memory. All decoder layers run the same schedule
+// one after another and reuse the same buffers; only HIDDEN, POS_IDS, SLOT_IDS
+// and the next layer's ATTN_NORMED stay live across layers.
+class Qwen2Activations {
+public:
+    Qwen2Activations(const LlaisysQwen2Meta &meta, size_t max_tokens, size_t max_seqs,
+                     llaisysDeviceType_t device_type, int device_id);
+
+    // Arena size a Qwen2Activations with these limits allocates.
+    static size_t arenaBytes(const LlaisysQwen2Meta &meta, size_t max_tokens, size_t max_seqs);
+
+    size_t maxTokens() const;
+    size_t maxSeqs() const;
+    size_t bytes() const;
+
+    // The first `rows` rows of an activation; views into the arena.
+    tensor_t get(Qwen2Activation activation, size_t rows) const;
+
+private:
+    size_t _max_tokens;
+    size_t _max_seqs;
+    core::storage_t _arena;
+    std::array<tensor_t, static_cast<size_t>(Qwen2Activation::COUNT)> _tensors;
+};
+} // namespace llaisys::models
@@ -0,0 +1,887 @@
+#include "qwen2_model.hpp"
+
+#include "qwen2_speculative.hpp"
+
+#include "../../ops/argmax/op.hpp"
+#include "../../ops/embedding/op.hpp"
+#include "../../ops/linear/op.hpp"
+#include "../../ops/lm_head_topk/op.hpp"
+#include "../../ops/paged_attention/op.hpp"
+#include "../../ops/qkv_rope/op.hpp"
+#include "../../ops/quantize/op.hpp"
+#include "../../ops/rms_norm/op.hpp"
+#include "../../ops/sample/op.hpp"
+#include "../../utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace llaisys::models {
+namespace {
+bool greedy(const LlaisysQwen2SamplingParams &sampling) {
+    return sampling.temperature <= 0.0f || sampling.top_k == 1;
+}
+
+// A repetition penalty of 0 reads as unset, i.e. 1.
+float repetition(const LlaisysQwen2SamplingParams &sampling) {
+    return sampling.repetition_penalty > 0.0f ? sampling.repetition_penalty : 1.0f;
+}
+
+// Penalties depend on each sequence's history, so they need the full logits.
+bool penalized(const LlaisysQwen2SamplingParams &sampling) {
+    return repetition(sampling) != 1.0f || sampling.presence_penalty != 0.0f;
+}
+
+size_t blocks_for(size_t tokens) {
+    return (tokens + Qwen2Model::KV_BLOCK_SIZE - 1) / Qwen2Model::KV_BLOCK_SIZE;
+}
+} // namespace
+
+Qwen2Model::Qwen2Model(const LlaisysQwen2Meta &meta, llaisysDeviceType_t device_type, int device_id, size_t kv_tokens)
+    : _meta(meta), _device_type(device_type), _device_id(device_id),
+      _kv_cache(meta.nlayer, meta.nkvh, meta.dh, KV_BLOCK_SIZE, blocks_for(kv_tokens != 0 ? kv_tokens : meta.maxseq), meta.dtype,
+                device_type, device_id),
+      _prefix_cache(_kv_cache),
+      _activations(meta, std::min(MAX_STEP_TOKENS, meta.maxseq), std::min({MAX_STEP_SEQS, MAX_STEP_TOKENS, meta.maxseq}),
+                   device_type, device_id) {
+    CHECK_ARGUMENT(meta.nlayer > 0 && meta.nh > 0 && meta.nkvh > 0 && meta.nh % meta.nkvh == 0,
+                   "Qwen2Model: the number of heads must be a multiple of the number of KV heads.");
+
+    auto create = [&](const std::vector<size_t> &shape) {
+        return Tensor::create(shape, meta.dtype, device_type, device_id);
+    };
+    _weights.in_embed = create({meta.voc, meta.hs});
+    _weights.out_embed = create({meta.voc, meta.hs});
+    _weights.out_norm_w = create({meta.hs});
+    for (size_t layer = 0; layer < meta.nlayer; layer++) {
+        _weights.attn_norm_w.push_back(create({meta.hs}));
+        // Likewise q, k and v for the fused projection.
+        size_t q_rows = meta.nh * meta.dh, kv_rows = meta.nkvh * meta.dh;
+        tensor_t qkv_w = create({q_rows + 2 * kv_rows, meta.hs});
+        tensor_t qkv_b = create({q_rows + 2 * kv_rows});
+        _weights.attn_qkv_w.push_back(qkv_w);
+        _weights.attn_qkv_b.push_back(qkv_b);
+        _weights.attn_q_w.push_back(qkv_w->slice(0, 0, q_rows));
+        _weights.attn_q_b.push_back(qkv_b->slice(0, 0, q_rows));
+        _weights.attn_k_w.push_back(qkv_w->slice(0, q_rows, q_rows + kv_rows));
+        _weights.attn_k_b.push_back(qkv_b->slice(0, q_rows, q_rows + kv_rows));
+        _weights.attn_v_w.push_back(qkv_w->slice(0, q_rows + kv_rows, q_rows + 2 * kv_rows));
+        _weights.attn_v_b.push_back(qkv_b->slice(0, q_rows + kv_rows, q_rows + 2 * kv_rows));
+        _weights.attn_o_w.push_back(create({meta.hs, meta.nh * meta.dh}));
+        _weights.mlp_norm_w.push_back(create({meta.hs}));
+        // Gate and up share one buffer so that one projection reads both.
+        _weights.mlp_gate_up_w.push_back(create({2 * meta.di, meta.hs}));
+        _weights.mlp_gate_w.push_back(_weights.mlp_gate_up_w.back()->slice(0, 0, meta.di));
+        _weights.mlp_up_w.push_back(_weights.mlp_gate_up_w.back()->slice(0, meta.di, 2 * meta.di));
+        _weights.mlp_down_w.push_back(create({meta.hs, meta.di}));
+    }
+    _weights.attn_qkv_s.resize(meta.nlayer);
+    _weights.attn_o_s.resize(meta.nlayer);
+    _weights.mlp_gate_up_s.resize(meta.nlayer);
+    _weights.mlp_down_s.resize(meta.nlayer);
+
+    size_t max_seqs = _activations.maxSeqs();
+    // A row maps one sequence, which never exceeds maxseq tokens.
+    _block_tables = Tensor::create({max_seqs, blocks_for(meta.maxseq)}, LLAISYS_DTYPE_I64, device_type, device_id);
+    _cu_seqlens = Tensor::create({max_seqs + 1}, LLAISYS_DTYPE_I64, device_type, device_id);
+    _kv_lens = Tensor::create({max_seqs}, LLAISYS_DTYPE_I64, device_type, device_id);
+    _table_rows.resize(max_seqs);
+    _host_cu_seqlens.resize(max_seqs + 1);
+    _host_kv_lens.resize(max_seqs);
+
+    _default_seq = createSequence();
+    _decode_tensors = _stepTensors(1);
+    _single_head = _headTensors(1);
+    _pos_ids.resize(_activations.maxTokens());
+    _slot_ids.resize(_activations.maxTokens());
+    _segments.reserve(_activations.maxSeqs());
+    _top_idx = Tensor::create({max_seqs * MAX_FUSED_TOP_K}, LLAISYS_DTYPE_I64, device_type, device_id);
+    _top_val = Tensor::create({max_seqs * MAX_FUSED_TOP_K}, meta.dtype, device_type, device_id);
+    _host_top_idx.resize(max_seqs * MAX_FUSED_TOP_K);
+    _history = Tensor::create({meta.maxseq}, LLAISYS_DTYPE_I64, device_type, device_id);
+    _host_values.resize(meta.voc * utils::dsize(meta.dtype));
+    _probs.resize(meta.voc);
+    _candidates.resize(meta.voc);
+    _drafts.resize(_activations.maxSeqs());
+}
+
+const LlaisysQwen2Meta &Qwen2Model::meta() const {
+    return _meta;
+}
+
+Qwen2Weights &Qwen2Model::weights() {
+    return _weights;
+}
+
+void Qwen2Model::quantizeInt8(size_t group) {
+    CHECK_ARGUMENT(_weights.out_embed_s == nullptr, "Qwen2Model: weights are already quantized.");
+    auto quantize = [&](tensor_t &weight, tensor_t &scales) {
+        size_t n = weight->shape()[0], k = weight->shape()[1];
+        CHECK_ARGUMENT(group == 0 || k % group == 0, "Qwen2Model: the quantization group must divide every weight width.");
+        tensor_t q = Tensor::create({n, k}, LLAISYS_DTYPE_I8, _device_type, _device_id);
+        scales = Tensor::create({n, group == 0 ? 1 : k / group}, LLAISYS_DTYPE_F32, _device_type, _device_id);
+        ops::quantize(q, scales, weight);
+        weight = q;
+    };
+    quantize(_weights.out_embed, _weights.out_embed_s);
+    size_t q_rows = _meta.nh * _meta.dh, kv_rows = _meta.nkvh * _meta.dh;
+    for (size_t layer = 0; layer < _meta.nlayer; layer++) {
+        tensor_t &qkv_w = _weights.attn_qkv_w[layer];
+        quantize(qkv_w, _weights.attn_qkv_s[layer]);
+        _weights.attn_q_w[layer] = qkv_w->slice(0, 0, q_rows);
+        _weights.attn_k_w[layer] = qkv_w->slice(0, q_rows, q_rows + kv_rows);
+        _weights.attn_v_w[layer] = qkv_w->slice(0, q_rows + kv_rows, q_rows + 2 * kv_rows);
+        quantize(_weights.attn_o_w[layer], _weights.attn_o_s[layer]);
+        tensor_t &gate_up_w = _weights.mlp_gate_up_w[layer];
+        quantize(gate_up_w, _weights.mlp_gate_up_s[layer]);
+        _weights.mlp_gate_w[layer] = gate_up_w->slice(0, 0, _meta.di);
+        _weights.mlp_up_w[layer] = gate_up_w->slice(0, _meta.di, 2 * _meta.di);
+        quantize(_weights.mlp_down_w[layer], _weights.mlp_down_s[layer]);
+    }
+}
+
+size_t Qwen2Model::length() const {
+    return length(_default_seq);
+}
+
+void Qwen2Model::reset() {
+    releaseSequence(_default_seq);
+    _default_seq = createSequence();
+}
+
+Qwen2Model::seq_t Qwen2Model::createSequence() {
+    seq_t seq = _kv_cache.createSequence();
+    _sequences.try_emplace(seq);
+    return seq;
+}
+
+Qwen2Model::seq_t Qwen2Model::forkSequence(seq_t seq) {
+    const Sequence &parent = _sequence(seq);
+    seq_t child = _kv_cache.fork(seq);
+    _sequences.try_emplace(child).first->second.tokens = parent.tokens;
+    return child;
+}
+
+void Qwen2Model::releaseSequence(seq_t seq) {
+    _kv_cache.releaseSequence(seq);
+    _sequences.erase(seq);
+}
+
+size_t Qwen2Model::length(seq_t seq) const {
+    return _kv_cache.length(seq);
+}
+
+void Qwen2Model::truncateSequence(seq_t seq, size_t ntoken) {
+    Sequence &state = _sequence(seq);
+    _kv_cache.truncate(seq, ntoken);
+    state.tokens.resize(ntoken);
+    // Blocks added from now on take the places of the released ones.
+    size_t nblocks = _kv_cache.blocks(seq).size();
+    for (TableRow &row : _table_rows) {
+        if (row.seq == seq) {
+            row.synced = std::min(row.synced, nblocks);
+        }
+    }
+}
+
+std::optional<utils::Rng> Qwen2Model::sequenceRng(seq_t seq) const {
+    auto it = _sequences.find(seq);
+    CHECK_ARGUMENT(it != _sequences.end(), "Qwen2Model: unknown sequence.");
+    if (!it->second.seeded) {
+        return std::nullopt;
+    }
+    return it->second.rng;
+}
+
+void Qwen2Model::setSequenceRng(seq_t seq, const utils::Rng &rng) {
+    Sequence &state = _sequence(seq);
+    state.rng = rng;
+    state.seeded = true;
+}
+
+size_t Qwen2Model::freeKVTokens() const {
+    return (_kv_cache.numFreeBlocks() + _prefix_cache.numEvictable()) * KV_BLOCK_SIZE;
+}
+
+void Qwen2Model::setPrefixCaching(bool enabled) {
+    _prefix_caching = enabled;
+    if (!enabled) {
+        _prefix_cache.clear();
+    }
+}
+
+size_t Qwen2Model::attachPrefix(seq_t seq, const int64_t *tokens, size_t ntoken) {
+    Sequence &state = _sequence(seq);
+    CHECK_ARGUMENT(length(seq) == 0, "Qwen2Model: can only attach a prefix to an empty sequence.");
+    if (!_prefix_caching || ntoken < 2) {
+        return 0;
+    }
+    // The last token is always computed, as its logits pick the next one.
+    std::vector<int64_t> blocks = _prefix_cache.match(tokens, ntoken - 1);
+    _kv_cache.share(seq, blocks);
+    size_t matched = blocks.size() * KV_BLOCK_SIZE;
+    state.tokens.assign(tokens, tokens + matched);
+    return matched;
+}
+
+void Qwen2Model::cachePrefix(seq_t seq) {
+    if (_prefix_caching) {
+        const Sequence &state = _sequence(seq);
+        _prefix_cache.insert(state.tokens.data(), length(seq), _kv_cache.blocks(seq));
+    }
+}
+
+int64_t Qwen2Model::infer(const int64_t *token_ids, size_t ntoken) {
+    if (!_run(_default_seq, token_ids, ntoken)) {
+        return -1;
+    }
+    return _argmax(0);
+}
+
+size_t Qwen2Model::generate(const int64_t *token_ids, size_t ntoken, size_t max_new_tokens,
+                            const LlaisysQwen2SamplingParams &sampling, const std::function<bool(int64_t)> &on_token) {
+    if (max_new_tokens == 0) {
+        return 0;
+    }
+    Sequence &state = _sequence(_default_seq);
+    state.rng.seed(sampling.seed);
+    state.seeded = true;
+    if (!_run(_default_seq, token_ids, ntoken)) {
+        return 0;
+    }
+    for (size_t generated = 1;; generated++) {
+        int64_t token = _sample(0, sampling, state);
+        bool proceed = on_token(token);
+        if (!proceed || token == _meta.end_token || generated == max_new_tokens || length() == _meta.maxseq) {
+            return generated;
+        }
+        if (!_run(_default_seq, &token, 1)) {
+            return generated;
+        }
+    }
+}
+
+size_t Qwen2Model::generateSpeculative(const int64_t *token_ids, size_t ntoken, size_t max_new_tokens,
+                                       const LlaisysQwen2SamplingParams &sampling, Drafter &drafter, size_t num_draft,
+                                       const std::function<bool(int64_t)> &on_token, SpeculativeStats &stats) {
+    stats = SpeculativeStats{};
+    if (max_new_tokens == 0) {
+        return 0;
+    }
+    // One logits row per guess plus one for the token after them.
+    num_draft = std::min(num_draft, _drafts.size() - 1);
+    Sequence &state = _sequence(_default_seq);
+    state.rng.seed(sampling.seed);
+    state.seeded = true;
+    if (!_run(_default_seq, token_ids, ntoken)) {
+        return 0;
+    }
+    int64_t token = _sample(0, sampling, state);
+    size_t generated = 1;
+    if (!on_token(token) || token == _meta.end_token || generated == max_new_tokens || length() == _meta.maxseq) {
+        return generated;
+    }
+
+    for (;;) {
+        size_t past = length();
+        size_t n = std::min({num_draft, max_new_tokens - generated - 1, _meta.maxseq - past - 1});
+        _context.assign(state.tokens.begin(), state.tokens.end());
+        _context.push_back(token);
+        size_t ndraft = n == 0 ? 0 : drafter.draft(_context, n, _drafts.data() + 1);
+        CHECK_ARGUMENT(ndraft <= n, "Qwen2Model: the drafter returned too many tokens.");
+        for (size_t i = 1; i <= ndraft; i++) {
+            CHECK_ARGUMENT(_drafts[i] >= 0 && static_cast<size_t>(_drafts[i]) < _meta.voc, "Qwen2Model: drafted token out of the vocabulary.");
+        }
+        _drafts[0] = token;
+
+        if (!_makeRoom(_kv_cache.blocksNeeded(_default_seq, ndraft + 1))) {
+            // Without room for the guesses, go on one token at a time.
+            ndraft = 0;
+            if (!_makeRoom(_kv_cache.blocksNeeded(_default_seq, 1))) {
+                return generated;
+            }
+        }
+        _segments.clear();
+        _segments.push_back(Segment{_default_seq, &state, 0, ndraft + 1, past, ndraft + 1});
+        _forward(_drafts.data(), ndraft + 1, true);
+        stats.steps++;
+        stats.drafted += ndraft;
+
+        // Row i picks the token after input i; past the first rejected guess
+        // the rows saw the wrong context.
+        for (size_t i = 0;; i++) {
+            int64_t next = _sample(i, sampling, state, i < ndraft ? _drafts[i + 1] : -1, past + i + 1);
+            bool accepted = i < ndraft && next == _drafts[i + 1];
+            stats.accepted += accepted ? 1 : 0;
+            generated++;
+            bool stop = !on_token(next) || next == _meta.end_token || generated == max_new_tokens || past + i + 1 == _meta.maxseq;
+            if (stop || !accepted) {
+                // As in generate(), the KV cache ends just before `next`.
+                truncateSequence(_default_seq, past + i + 1);
+                if (stop) {
+                    return generated;
+                }
+                token = next;
+                break;
+            }
+        }
+    }
+}
+
+bool Qwen2Model::step(const seq_t *seqs, size_t nseq, const int64_t *token_ids, const size_t *ntokens,
+                      const LlaisysQwen2SamplingParams *sampling, int64_t *out_tokens, const uint8_t *emit) {
+    if (!_batch(seqs, nseq, token_ids, ntokens)) {
+        return false;
+    }
+    _prepareHead(sampling, emit);
+    for (size_t i = 0; i < nseq; i++) {
+        if (emit != nullptr && !emit[i]) {
+            continue;
+        }
+        if (sampling == nullptr) {
+            out_tokens[i] = _argmax(i);
+            continue;
+        }
+        Sequence &state = *_segments[i].state;
+        if (!state.seeded) {
+            state.rng.seed(sampling[i].seed);
+            state.seeded = true;
+        }
+        out_tokens[i] = _sample(i, sampling[i], state);
+    }
+    return true;
+}
+
+void Qwen2Model::generateN(const int64_t *token_ids, size_t ntoken, size_t n, size_t max_new_tokens,
+                           const LlaisysQwen2SamplingParams &sampling, int64_t *out_tokens, size_t *out_lengths) {
+    CHECK_ARGUMENT(n > 0 && n <= _activations.maxSeqs(), "Qwen2Model: n must be between 1 and the sequences of a step.");
+    std::fill(out_lengths, out_lengths + n, 0);
+    if (max_new_tokens == 0) {
+        return;
+    }
+    seq_t root = createSequence();
+    if (!_run(root, token_ids, ntoken)) {
+        releaseSequence(root);
+        return;
+    }
+
+    std::vector<seq_t> seqs(n);
+    std::vector<int64_t> last(n);
+    std::vector<size_t> active;
+    // Stores a sample's token; false once the sample is complete.
+    auto record = [&](size_t i, int64_t token) {
+        last[i] = token;
+        out_tokens[i * max_new_tokens + out_lengths[i]++] = token;
+        bool done = token == _meta.end_token || out_lengths[i] == max_new_tokens || length(seqs[i]) == _meta.maxseq;
+        if (done) {
+            releaseSequence(seqs[i]);
+        }
+        return !done;
+    };
+    // Every sample draws its first token from the prompt's logits in row 0.
+    for (size_t i = 0; i < n; i++) {
+        seqs[i] = i == 0 ? root : forkSequence(root);
+        Sequence &state = _sequence(seqs[i]);
+        state.rng.seed(sampling.seed + i);
+        state.seeded = true;
+        last[i] = _sample(0, sampling, state);
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (record(i, last[i])) {
+            active.push_back(i);
+        }
+    }
+
+    std::vector<seq_t> step_seqs;
+    std::vector<int64_t> step_tokens, out(n);
+    std::vector<size_t> ones(n, 1);
+    std::vector<LlaisysQwen2SamplingParams> params(n, sampling);
+    while (!active.empty()) {
+        step_seqs.clear();
+        step_tokens.clear();
+        for (size_t i : active) {
+            step_seqs.push_back(seqs[i]);
+            step_tokens.push_back(last[i]);
+        }
+        if (!step(step_seqs.data(), active.size(), step_tokens.data(), ones.data(), params.data(), out.data())) {
+            break;
+        }
+        size_t kept = 0;
+        for (size_t j = 0; j < active.size(); j++) {
+            if (record(active[j], out[j])) {
+                active[kept++] = active[j];
+            }
+        }
+        active.resize(kept);
+    }
+    for (size_t i : active) {
+        releaseSequence(seqs[i]);
+    }
+}
+
+size_t Qwen2Model::beamSearch(const int64_t *token_ids, size_t ntoken, size_t beam_width, size_t max_new_tokens, int64_t *out_tokens) {
+    CHECK_ARGUMENT(beam_width > 0 && beam_width <= _activations.maxSeqs(), "Qwen2Model: beam_width must be between 1 and the sequences of a step.");
+    if (max_new_tokens == 0) {
+        return 0;
+    }
+    struct Beam {
+        seq_t seq;
+        std::vector<int64_t> tokens;
+        float score; // summed log-probability
+    };
+    struct Candidate {
+        size_t beam;
+        int64_t token;
+        float score;
+    };
+    auto per_token = [](float score, size_t ntoken) { return score / static_cast<float>(ntoken); };
+
+    seq_t root = createSequence();
+    if (!_run(root, token_ids, ntoken)) {
+        releaseSequence(root);
+        return 0;
+    }
+    std::vector<Beam> beams{Beam{root, {}, 0.0f}};
+    std::vector<int64_t> best;
+    float best_score = -std::numeric_limits<float>::infinity();
+    std::vector<Candidate> candidates;
+    std::vector<seq_t> step_seqs;
+    std::vector<int64_t> step_tokens;
+    std::vector<size_t> ones(beam_width, 1);
+
+    while (!beams.empty()) {
+        // Row b holds the logits of beam b; each beam proposes its own top
+        // beam_width tokens.
+        candidates.clear();
+        for (size_t b = 0; b < beams.size(); b++) {
+            float *logits = _hostLogits(b);
+            float max_logit = *std::max_element(logits, logits + _meta.voc);
+            float sum = 0.0f;
+            for (size_t i = 0; i < _meta.voc; i++) {
+                sum += std::exp(logits[i] - max_logit);
+            }
+            float log_norm = max_logit + std::log(sum);
+            std::iota(_candidates.begin(), _candidates.end(), int64_t(0));
+            size_t k = std::min(beam_width, _meta.voc);
+            std::partial_sort(_candidates.begin(), _candidates.begin() + k, _candidates.end(),
+                              [&](int64_t a, int64_t c) { return logits[a] > logits[c]; });
+            for (size_t i = 0; i < k; i++) {
+                candidates.push_back(Candidate{b, _candidates[i], beams[b].score + logits[_candidates[i]] - log_norm});
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &c) { return a.score > c.score; });
+
+        // The best beam_width candidates survive. A parent's first child takes
+        // over its sequence, later ones fork it; ended hypotheses leave the beam.
+        std::vector<Beam> next;
+        std::vector<bool> taken(beams.size(), false);
+        for (const Candidate &c : candidates) {
+            if (next.size() == beam_width) {
+                break;
+            }
+            const Beam &parent = beams[c.beam];
+            std::vector<int64_t> tokens = parent.tokens;
+            tokens.push_back(c.token);
+            if (c.token == _meta.end_token || tokens.size() == max_new_tokens || length(parent.seq) == _meta.maxseq) {
+                if (per_token(c.score, tokens.size()) > best_score) {
+                    best_score = per_token(c.score, tokens.size());
+                    best = std::move(tokens);
+                }
+                continue;
+            }
+            seq_t seq = taken[c.beam] ? forkSequence(parent.seq) : parent.seq;
+            taken[c.beam] = true;
+            next.push_back(Beam{seq, std::move(tokens), c.score});
+        }
+        for (size_t b = 0; b < beams.size(); b++) {
+            if (!taken[b]) {
+                releaseSequence(beams[b].seq);
+            }
+        }
+        beams = std::move(next);
+        if (beams.empty()) {
+            break;
+        }
+
+        step_seqs.clear();
+        step_tokens.clear();
+        for (const Beam &beam : beams) {
+            step_seqs.push_back(beam.seq);
+            step_tokens.push_back(beam.tokens.back());
+        }
+        if (!_batch(step_seqs.data(), beams.size(), step_tokens.data(), ones.data())) {
+            // Out of KV cache: the open beams compete as they are.
+            for (Beam &beam : beams) {
+                if (per_token(beam.score, beam.tokens.size()) > best_score) {
+                    best_score = per_token(beam.score, beam.tokens.size());
+                    best = beam.tokens;
+                }
+                releaseSequence(beam.seq);
+            }
+            break;
+        }
+    }
+    std::copy(best.begin(), best.end(), out_tokens);
+    return best.size();
+}
+
+bool Qwen2Model::_batch(const seq_t *seqs, size_t nseq, const int64_t *token_ids, const size_t *ntokens) {
+    CHECK_ARGUMENT(nseq > 0 && nseq <= _activations.maxSeqs(), "Qwen2Model: too many sequences in one step.");
+    size_t total = 0;
+    size_t new_blocks = 0;
+    for (size_t i = 0; i < nseq; i++) {
+        CHECK_ARGUMENT(ntokens[i] > 0, "Qwen2Model: every sequence of a step needs a token.");
+        CHECK_ARGUMENT(std::find(seqs, seqs + i, seqs[i]) == seqs + i, "Qwen2Model: a sequence appears twice in one step.");
+        CHECK_ARGUMENT(length(seqs[i]) + ntokens[i] <= _meta.maxseq, "Qwen2Model: sequence exceeds maxseq.");
+        new_blocks += _kv_cache.blocksNeeded(seqs[i], ntokens[i]);
+        total += ntokens[i];
+    }
+    CHECK_ARGUMENT(total <= _activations.maxTokens(), "Qwen2Model: too many tokens in one step.");
+    if (!_makeRoom(new_blocks)) {
+        return false;
+    }
+
+    _segments.clear();
+    for (size_t i = 0, offset = 0; i < nseq; offset += ntokens[i], i++) {
+        _segments.push_back(Segment{seqs[i], &_sequence(seqs[i]), offset, ntokens[i], length(seqs[i])});
+    }
+    _forward(token_ids, total, true);
+    return true;
+}
+
+size_t Qwen2Model::maxStepTokens() const {
+    return _activations.maxTokens();
+}
+
+size_t Qwen2Model::maxStepSeqs() const {
+    return _activations.maxSeqs();
+}
+
+Qwen2Model::Sequence &Qwen2Model::_sequence(seq_t seq) {
+    auto it = _sequences.find(seq);
+    CHECK_ARGUMENT(it != _sequences.end(), "Qwen2Model: unknown sequence.");
+    return it->second;
+}
+
+bool Qwen2Model::_makeRoom(size_t nblocks) {
+    size_t free_blocks = _kv_cache.numFreeBlocks();
+    if (nblocks > free_blocks) {
+        _prefix_cache.evict(nblocks - free_blocks);
+    }
+    return nblocks <= _kv_cache.numFreeBlocks();
+}
+
+bool Qwen2Model::_run(seq_t seq, const int64_t *token_ids, size_t ntoken) {
+    CHECK_ARGUMENT(ntoken > 0, "Qwen2Model: no input tokens.");
+    CHECK_ARGUMENT(length(seq) + ntoken <= _meta.maxseq, "Qwen2Model: sequence exceeds maxseq.");
+
+    Sequence *state = &_sequence(seq);
+    size_t start = length(seq);
+    size_t done = start == 0 ? attachPrefix(seq, token_ids, ntoken) : 0;
+    while (done < ntoken) {
+        size_t n = std::min(_activations.maxTokens(), ntoken - done);
+        if (!_makeRoom(_kv_cache.blocksNeeded(seq, n))) {
+            truncateSequence(seq, start);
+            return false;
+        }
+        _segments.clear();
+        _segments.push_back(Segment{seq, state, 0, n, length(seq)});
+        _forward(token_ids + done, n, done + n == ntoken);
+        done += n;
+    }
+    if (ntoken > 1) {
+        cachePrefix(seq);
+    }
+    return true;
+}
+
+Qwen2Model::StepTensors Qwen2Model::_stepTensors(size_t ntoken) const {
+    auto get = [&](Qwen2Activation activation) {
+        return _activations.get(activation, ntoken);
+    };
+    StepTensors t;
+    t.token_ids = get(Qwen2Activation::TOKEN_IDS);
+    t.pos_ids = get(Qwen2Activation::POS_IDS);
+    t.slot_ids = get(Qwen2Activation::SLOT_IDS);
+    t.hidden = get(Qwen2Activation::HIDDEN);
+    t.attn_normed = get(Qwen2Activation::ATTN_NORMED);
+    t.q = get(Qwen2Activation::Q);
+    t.attn = get(Qwen2Activation::ATTN);
+    t.attn_out = get(Qwen2Activation::ATTN_OUT);
+    t.mlp_normed = get(Qwen2Activation::MLP_NORMED);
+    t.mlp_act = get(Qwen2Activation::MLP_ACT);
+    t.mlp_out = get(Qwen2Activation::MLP_OUT);
+    t.q3 = t.q->view({ntoken, _meta.nh, _meta.dh});
+    t.attn3 = t.attn->view({ntoken, _meta.nh, _meta.dh});
+    return t;
+}
+
+Qwen2Model::HeadTensors Qwen2Model::_headTensors(size_t nseq) const {
+    HeadTensors h;
+    h.last_hidden = _activations.get(Qwen2Activation::LAST_HIDDEN, nseq);
+    h.last_normed = _activations.get(Qwen2Activation::LAST_NORMED, nseq);
+    h.logits = _activations.get(Qwen2Activation::LOGITS, nseq);
+    h.next_token = _activations.get(Qwen2Activation::NEXT_TOKEN, nseq);
+    h.next_logit = _activations.get(Qwen2Activation::NEXT_LOGIT, nseq);
+    h.top1_idx = h.next_token->view({nseq, 1});
+    h.top1_val = h.next_logit->view({nseq, 1});
+    h.block_tables = _block_tables->slice(0, 0, nseq);
+    h.cu_seqlens = _cu_seqlens->slice(0, 0, nseq + 1);
+    h.kv_lens = _kv_lens->slice(0, 0, nseq);
+    return h;
+}
+
+const Qwen2Model::StepTensors &Qwen2Model::_tensors(size_t ntoken) {
+    if (ntoken == 1) {
+        return _decode_tensors;
+    }
+    if (ntoken != _step_tensors_len) {
+        _step_tensors = _stepTensors(ntoken);
+        _step_tensors_len = ntoken;
+    }
+    return _step_tensors;
+}
+
+const Qwen2Model::HeadTensors &Qwen2Model::_heads(size_t nseq) {
+    if (nseq == 1) {
+        return _single_head;
+    }
+    if (nseq != _batch_heads_len) {
+        _batch_heads = _headTensors(nseq);
+        _batch_heads_len = nseq;
+    }
+    return _batch_heads;
+}
+
+void Qwen2Model::_forward(const int64_t *token_ids, size_t ntoken, bool logits) {
+    const StepTensors &t = _tensors(ntoken);
+    core::context().setDevice(_device_type, _device_id);
+    auto api = core::context().runtime().api();
+
+    size_t nseq = _segments.size();
+    size_t row_bytes = _block_tables->shape()[1] * sizeof(int64_t);
+    for (size_t i = 0; i < nseq; i++) {
+        const Segment &seg = _segments[i];
+        bool copies_last = _kv_cache.sharesLastBlock(seg.seq);
+        bool reserved = _kv_cache.reserve(seg.seq, seg.ntoken);
+        ASSERT(reserved, "Qwen2Model: KV cache is full.");
+        // A row keeps the blocks of the sequence it served last step, so
+        // decoding only copies blocks added since then, and the private copy
+        // of a forked sequence's shared last block.
+        TableRow &row = _table_rows[i];
+        if (row.seq != seg.seq) {
+            row = TableRow{seg.seq, 0};
+        } else if (copies_last) {
+            row.synced = std::min(row.synced, seg.past / KV_BLOCK_SIZE);
+        }
+        const auto &blocks = _kv_cache.blocks(seg.seq);
+        if (blocks.size() > row.synced) {
+            api->memcpy_sync(_block_tables->data() + i * row_bytes + row.synced * sizeof(int64_t), blocks.data() + row.synced,
+                             (blocks.size() - row.synced) * sizeof(int64_t), LLAISYS_MEMCPY_H2D);
+            row.synced = blocks.size();
+        }
+        _host_cu_seqlens[i + 1] = static_cast<int64_t>(seg.offset + seg.ntoken);
+        _host_kv_lens[i] = static_cast<int64_t>(seg.past + seg.ntoken);
+        for (size_t j = 0; j < seg.ntoken; j++) {
+            size_t pos = seg.past + j;
+            _pos_ids[seg.offset + j] = static_cast<int64_t>(pos);
+            _slot_ids[seg.offset + j] = blocks[pos / KV_BLOCK_SIZE] * static_cast<int64_t>(KV_BLOCK_SIZE) + static_cast<int64_t>(pos % KV_BLOCK_SIZE);
+        }
+    }
+    api->memcpy_sync(_cu_seqlens->data(), _host_cu_seqlens.data(), (nseq + 1) * sizeof(int64_t), LLAISYS_MEMCPY_H2D);
+    api->memcpy_sync(_kv_lens->data(), _host_kv_lens.data(), nseq * sizeof(int64_t), LLAISYS_MEMCPY_H2D);
+    api->memcpy_sync(t.token_ids->data(), token_ids, ntoken * sizeof(int64_t), LLAISYS_MEMCPY_H2D);
+    api->memcpy_sync(t.pos_ids->data(), _pos_ids.data(), ntoken * sizeof(int64_t), LLAISYS_MEMCPY_H2D);
+    api->memcpy_sync(t.slot_ids->data(), _slot_ids.data(), ntoken * sizeof(int64_t), LLAISYS_MEMCPY_H2D);
+
+    ops::embedding(t.hidden, t.token_ids, _weights.in_embed);
+    const HeadTensors &h = _heads(nseq);
+    for (size_t layer = 0; layer < _meta.nlayer; layer++) {
+        _layer(layer, t, h);
+    }
+    // Only now do the sequences hold the K/V rows of their new tokens.
+    for (const Segment &seg : _segments) {
+        _kv_cache.advance(seg.seq, seg.ntoken);
+        seg.state->tokens.insert(seg.state->tokens.end(), token_ids + seg.offset, token_ids + seg.offset + seg.ntoken);
+    }
+    if (logits) {
+        _lastHidden(t);
+    }
+}
+
+void Qwen2Model::_layer(size_t layer, const StepTensors &t, const HeadTensors &h) {
+    const Qwen2Weights &w = _weights;
+    float scale = 1.0f / std::sqrt(static_cast<float>(_meta.dh));
+    // Later layers get attn_normed from the previous layer's last add.
+    if (layer == 0) {
+        ops::rms_norm(t.attn_normed, t.hidden, w.attn_norm_w[layer], _meta.epsilon);
+    }
+    // K and V of the step go straight to their cache rows.
+    ops::qkv_rope(t.q3, _kv_cache.keys(layer), _kv_cache.values(layer), t.attn_normed, w.attn_qkv_w[layer], w.attn_qkv_b[layer], t.pos_ids,
+                  t.slot_ids, _meta.theta, w.attn_qkv_s[layer]);
+    ops::paged_varlen_attention(t.attn3, t.q3, _kv_cache.keys(layer), _kv_cache.values(layer), h.block_tables, h.cu_seqlens, h.kv_lens, scale);
+    ops::linear(t.attn_out, t.attn, w.attn_o_w[layer], nullptr, nullptr, w.attn_o_s[layer]);
+    ops::add_rms_norm(t.mlp_normed, t.hidden, t.attn_out, w.mlp_norm_w[layer], _meta.epsilon);
+
+    ops::linear_swiglu(t.mlp_act, t.mlp_normed, w.mlp_gate_up_w[layer], nullptr, w.mlp_gate_up_s[layer]);
+    if (layer + 1 < _meta.nlayer) {
+        ops::linear(t.mlp_out, t.mlp_act, w.mlp_down_w[layer], nullptr, nullptr, w.mlp_down_s[layer]);
+        ops::add_rms_norm(t.attn_normed, t.hidden, t.mlp_out, w.attn_norm_w[layer + 1], _meta.epsilon);
+    } else {
+        // The final norm only runs on the rows that get logits, so the down
+        // projection adds straight into the residual stream.
+        ops::linear(t.hidden, t.mlp_act, w.mlp_down_w[layer], nullptr, t.hidden, w.mlp_down_s[layer]);
+    }
+}
+
+void Qwen2Model::_lastHidden(const StepTensors &t) {
+    _logit_rows = 0;
+    _head_k = 0;
+    _head_logits = false;
+    for (const Segment &seg : _segments) {
+        ASSERT(seg.nlogits > 0 && seg.nlogits <= seg.ntoken, "Qwen2Model: bad number of logits rows.");
+        _logit_rows += seg.nlogits;
+    }
+    ASSERT(_logit_rows <= _activations.maxSeqs(), "Qwen2Model: more logits rows than planned for.");
+    const HeadTensors &h = _heads(_logit_rows);
+    auto api = core::context().runtime().api();
+    size_t row_bytes = _meta.hs * utils::dsize(_meta.dtype);
+    size_t row = 0;
+    for (const Segment &seg : _segments) {
+        size_t first = seg.offset + seg.ntoken - seg.nlogits;
+        api->memcpy_sync(h.last_hidden->data() + row * row_bytes, t.hidden->data() + first * row_bytes, seg.nlogits * row_bytes,
+                         LLAISYS_MEMCPY_D2D);
+        row += seg.nlogits;
+    }
+}
+
+void Qwen2Model::_logits() {
+    if (_head_logits) {
+        return;
+    }
+    const HeadTensors &h = _heads(_logit_rows);
+    ops::rms_norm(h.last_normed, h.last_hidden, _weights.out_norm_w, _meta.epsilon);
+    ops::linear(h.logits, h.last_normed, _weights.out_embed, nullptr, nullptr, _weights.out_embed_s);
+    _head_logits = true;
+}
+
+void Qwen2Model::_topk(size_t k) {
+    if (_head_k >= k) {
+        return;
+    }
+    const HeadTensors &h = _heads(_logit_rows);
+    size_t rows = _logit_rows;
+    tensor_t idx = h.top1_idx, val = h.top1_val;
+    if (k > 1) {
+        idx = _top_idx->slice(0, 0, rows * k)->view({rows, k});
+        val = _top_val->slice(0, 0, rows * k)->view({rows, k});
+    }
+    ops::lm_head_topk(idx, val, h.last_hidden, _weights.out_norm_w, _weights.out_embed, _meta.epsilon, _weights.out_embed_s);
+    core::context().runtime().api()->memcpy_sync(_host_top_idx.data(), idx->data(), rows * k * sizeof(int64_t), LLAISYS_MEMCPY_D2H);
+    _head_k = k;
+}
+
+void Qwen2Model::_prepareHead(const LlaisysQwen2SamplingParams *sampling, const uint8_t *emit) {
+    bool any = false;
+    size_t k = 1;
+    for (size_t i = 0; i < _logit_rows; i++) {
+        if (emit != nullptr && !emit[i]) {
+            continue;
+        }
+        any = true;
+        if (sampling != nullptr && penalized(sampling[i])) {
+            _logits();
+            return;
+        }
+        if (sampling == nullptr || greedy(sampling[i])) {
+            continue;
+        }
+        if (sampling[i].top_k == 0 || sampling[i].top_k > std::min(MAX_FUSED_TOP_K, _meta.voc)) {
+            _logits();
+            return;
+        }
+        k = std::max(k, sampling[i].top_k);
+    }
+    if (any) {
+        _topk(k);
+    }
+}
+
+int64_t Qwen2Model::_argmax(size_t row) {
+    if (!_head_logits) {
+        _topk(1);
+        return _host_top_idx[row * _head_k];
+    }
+    const HeadTensors &h = _heads(_logit_rows);
+    if (_logit_rows == 1) {
+        ops::argmax(h.next_token, h.next_logit, h.logits);
+    } else {
+        ops::argmax(h.next_token->slice(0, row, row + 1), h.next_logit->slice(0, row, row + 1), h.logits->slice(0, row, row + 1));
+    }
+    int64_t next_token = 0;
+    core::context().runtime().api()->memcpy_sync(&next_token, h.next_token->data() + row * sizeof(int64_t), sizeof(int64_t),
+                                                 LLAISYS_MEMCPY_D2H);
+    return next_token;
+}
+
+int64_t Qwen2Model::_sample(size_t row, const LlaisysQwen2SamplingParams &sampling, Sequence &state, int64_t draft, size_t history) {
+    bool penalize = penalized(sampling);
+    if (greedy(sampling) && !penalize) {
+        return _argmax(row);
+    }
+    const HeadTensors &h = _heads(_logit_rows);
+    tensor_t logits, ids, prev_tokens;
+    if (!penalize && !_head_logits && sampling.top_k > 0 && sampling.top_k <= std::min(MAX_FUSED_TOP_K, _meta.voc)) {
+        // The fused head already ranked the top_k candidates.
+        _topk(sampling.top_k);
+        size_t first = row * _head_k;
+        logits = _top_val->slice(0, first, first + sampling.top_k);
+        ids = _top_idx->slice(0, first, first + sampling.top_k);
+    } else {
+        _logits();
+        logits = h.logits->slice(0, row, row + 1)->view({_meta.voc});
+    }
+    history = std::min(history, state.tokens.size());
+    if (penalize && history > 0) {
+        core::context().runtime().api()->memcpy_sync(_history->data(), state.tokens.data(), history * sizeof(int64_t), LLAISYS_MEMCPY_H2D);
+        prev_tokens = _history->slice(0, 0, history);
+    }
+
+    ops::SampleParams params{sampling.temperature, sampling.top_k, sampling.top_p, repetition(sampling), sampling.presence_penalty};
+    tensor_t out = h.next_token->slice(0, row, row + 1);
+    ops::sample(out, logits, ids, prev_tokens, params, state.rng, draft);
+    int64_t token = 0;
+    core::context().runtime().api()->memcpy_sync(&token, out->data(), sizeof(int64_t), LLAISYS_MEMCPY_D2H);
+    return token;
+}
+
+float *Qwen2Model::_hostLogits(size_t row) {
+    _logits();
+    size_t row_bytes = _meta.voc * utils::dsize(_meta.dtype);
+    _toHost(_probs.data(), _heads(_logit_rows).logits->data() + row * row_bytes, _meta.voc);
+    return _probs.data();
+}
+
+void Qwen2Model::_toHost(float *out, const std::byte *src, size_t n) {
+    if (_device_type != LLAISYS_DEVICE_CPU) {
+        core::context().runtime().api()->memcpy_sync(_host_values.data(), src, n * utils::dsize(_meta.dtype), LLAISYS_MEMCPY_D2H);
+        src = _host_values.data();
+    }
+    switch (_meta.dtype) {
+    case LLAISYS_DTYPE_F32:
+        std::memcpy(out, src, n * sizeof(float));
+        break;
+    case LLAISYS_DTYPE_BF16:
+        utils::cast(out, reinterpret_cast<const bf16_t *>(src), n);
+        break;
+    case LLAISYS_DTYPE_F16:
+        utils::cast(out, reinterpret_cast<const fp16_t *>(src), n);
+        break;
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(_meta.dtype);
+    }
+}
+} // namespace llaisys::models
@@ -0,0 +1,309 @@
+#pragma once
+
+#include "qwen2_activations.hpp"
+
+#include "../kv_cache/paged_kv_cache.hpp"
+#include "../kv_cache/prefix_cache.hpp"
+
+#include "../../utils/random.hpp"
+
+#include <functional>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace llaisys::models {
+class Drafter;
+
+struct Qwen2Weights {
+    tensor_t in_embed;   // [voc, hs]
+    tensor_t out_embed;  // [voc, hs]
+    tensor_t out_norm_w; // [hs]
+    // One entry per layer.
+    std::vector<tensor_t> attn_norm_w; // [hs]
+    std::vector<tensor_t> attn_qkv_w;  // [(nh + 2 * nkvh) * dh, hs], q rows then k rows then v rows
+    std::vector<tensor_t> attn_qkv_b;  // [(nh + 2 * nkvh) * dh]
+    // Views into attn_qkv_w and attn_qkv_b.
+    std::vector<tensor_t> attn_q_w;    // [nh * dh, hs]
+    std::vector<tensor_t> attn_q_b;    // [nh * dh]
+    std::vector<tensor_t> attn_k_w;    // [nkvh * dh, hs]
+    std::vector<tensor_t> attn_k_b;    // [nkvh * dh]
+    std::vector<tensor_t> attn_v_w;    // [nkvh * dh, hs]
+    std::vector<tensor_t> attn_v_b;    // [nkvh * dh]
+    std::vector<tensor_t> attn_o_w;    // [hs, nh * dh]
+    std::vector<tensor_t> mlp_norm_w;  // [hs]
+    std::vector<tensor_t> mlp_gate_up_w; // [2 * di, hs], gate rows then up rows
+    std::vector<tensor_t> mlp_gate_w;    // [di, hs], view into mlp_gate_up_w
+    std::vector<tensor_t> mlp_up_w;      // [di, hs], view into mlp_gate_up_w
+    std::vector<tensor_t> mlp_down_w;  // [hs, di]
+    // f32 scales of the matrices above once Qwen2Model::quantizeInt8() has
+    // made them int8, null until then.
+    tensor_t out_embed_s;
+    std::vector<tensor_t> attn_qkv_s;
+    std::vector<tensor_t> attn_o_s;
+    std::vector<tensor_t> mlp_gate_up_s;
+    std::vector<tensor_t> mlp_down_s;
+};
+
+// Outcome of one speculative generation: `drafted` tokens were proposed over
+// `steps` verifying forward steps and `accepted` of them were kept.
+struct SpeculativeStats {
+    size_t drafted = 0;
+    size_t accepted = 0;
+    size_t steps = 0;
+};
+
+// Qwen2 decoder serving any number of sequences from one paged KV cache.
+//
+// Weights, the KV cache (kv_tokens shared by all sequences, each of which
+// holds at most maxseq of them) and the
+// activation arena are allocated by the constructor. step() runs one forward
+// pass over a ragged batch: the tokens of every participating sequence,
+// prefilling or decoding, are packed into the same rows, so each weight is
+// read once per step, and one varlen attention call serves all of them. Sequences join and leave between steps. Only the last
+// token of each sequence goes through the final norm and the LM head.
+//
+// The LM head runs on demand after a step. When every row is greedy or
+// samples from a small top-k, one fused pass over the output embedding yields
+// just the best tokens and never writes the [rows, voc] logits; the full
+// logits are only computed for rows that need them.
+//
+// infer() and generate() drive a default sequence, prefilling long prompts in
+// several steps of at most MAX_STEP_TOKENS tokens. Their decode steps reuse
+// tensor views built up front and allocate no tensors.
+//
+// With prefix caching on, the full KV blocks of every prefilled prompt are
+// kept in a radix tree keyed by token ids. A new sequence whose prompt starts
+// with a cached prefix shares those blocks and only computes the rest. Cached
+// blocks no sequence uses count as free and are evicted, least recently used
+// first, when the KV cache runs short.
+class Qwen2Model {
+public:
+    using seq_t = PagedKVCache::seq_t;
+
+    static constexpr size_t MAX_STEP_TOKENS = 1024;
+    static constexpr size_t MAX_STEP_SEQS = 64;
+    static constexpr size_t KV_BLOCK_SIZE = 16;
+    // Largest top_k served by the fused LM head.
+    static constexpr size_t MAX_FUSED_TOP_K = 64;
+
+    // kv_tokens sizes the KV cache shared by all sequences; 0 means maxseq.
+    Qwen2Model(const LlaisysQwen2Meta &meta, llaisysDeviceType_t device_type, int device_id, size_t kv_tokens = 0);
+
+    Qwen2Model(const Qwen2Model &) = delete;
+    Qwen2Model &operator=(const Qwen2Model &) = delete;
+
+    const LlaisysQwen2Meta &meta() const;
+    Qwen2Weights &weights();
+    // Replaces the projection matrices and the LM head, once loaded, with
+    // int8 copies scaled per output channel, or per `group` input columns if
+    // group is not 0 (see ops::quantize). Decoding streams half the bytes of
+    // bf16 weights; the input embedding, norms and biases are kept.
+    void quantizeInt8(size_t group);
+
+    // Appends the tokens to the default sequence and returns the most likely
+    // next token, or -1, appending nothing, if the KV cache cannot hold them.
+    int64_t infer(const int64_t *token_ids, size_t ntoken);
+    // Appends the prompt to the default sequence, then samples up to
+    // max_new_tokens tokens. on_token sees each of them and returns false to
+    // stop early; generation also ends after end_token, once the sequence
+    // reaches maxseq, or when the KV cache cannot hold the next token. The
+    // last generated token is not fed back, so a follow-up call starts with
+    // it. Returns the number of generated tokens.
+    size_t generate(const int64_t *token_ids, size_t ntoken, size_t max_new_tokens,
+                    const LlaisysQwen2SamplingParams &sampling, const std::function<bool(int64_t)> &on_token);
+    // generate() with speculative decoding: each step feeds the last token
+    // together with up to num_draft tokens guessed by the drafter, and the
+    // logits of every row check one guess. Guesses are kept up to the first
+    // one the sampler does not confirm, and the KV cache of the rest is rolled
+    // back. A guess is confirmed with its probability under `sampling` and a
+    // rejection samples from the remaining tokens, so the output follows the
+    // same distribution as generate(); greedy output is identical.
+    size_t generateSpeculative(const int64_t *token_ids, size_t ntoken, size_t max_new_tokens,
+                               const LlaisysQwen2SamplingParams &sampling, Drafter &drafter, size_t num_draft,
+                               const std::function<bool(int64_t)> &on_token, SpeculativeStats &stats);
+    // Forgets the default sequence; the next infer() starts at position 0.
+    void reset();
+    // Tokens of the default sequence held in the KV cache.
+    size_t length() const;
+
+    seq_t createSequence();
+    // A new sequence continuing from the state of `seq`. It shares the KV
+    // blocks of seq until one of them appends to the partially filled last
+    // block, which is then copied. The fork's RNG is seeded by its own first
+    // sampled step.
+    seq_t forkSequence(seq_t seq);
+    void releaseSequence(seq_t seq);
+    size_t length(seq_t seq) const;
+    // Keeps the first ntoken tokens of a sequence and forgets the rest.
+    void truncateSequence(seq_t seq, size_t ntoken);
+    // The sampling RNG of a sequence, once its first sampled step has seeded
+    // it, and a way to hand it to another sequence, which then keeps drawing
+    // where the first one stopped instead of seeding its own.
+    std::optional<utils::Rng> sequenceRng(seq_t seq) const;
+    void setSequenceRng(seq_t seq, const utils::Rng &rng);
+    // Tokens the KV cache can still take across all sequences, counting
+    // evictable cached prefixes.
+    size_t freeKVTokens() const;
+
+    // On by default; turning it off drops the cached prefixes.
+    void setPrefixCaching(bool enabled);
+    // Makes the longest cached prefix of tokens, short of the last token, the
+    // start of an empty sequence. Returns the number of tokens it covers;
+    // only the remaining ones need to go through step().
+    size_t attachPrefix(seq_t seq, const int64_t *tokens, size_t ntoken);
+    // Publishes the full KV blocks of a sequence to the prefix cache.
+    void cachePrefix(seq_t seq);
+    // One forward step over a ragged batch of distinct sequences: sequence i
+    // appends ntokens[i] tokens, taken in order from token_ids, and
+    // out_tokens[i] receives its next token, picked with sampling[i] (greedy
+    // when sampling is null). Where emit is given and emit[i] is 0, sequence i
+    // only extends its KV cache, e.g. with a prompt chunk that is not the
+    // last, and out_tokens[i] is left alone. A sequence's RNG is seeded by its
+    // first sampled step. Returns false, changing nothing, if the KV cache
+    // cannot hold the new tokens.
+    bool step(const seq_t *seqs, size_t nseq, const int64_t *token_ids, const size_t *ntokens,
+              const LlaisysQwen2SamplingParams *sampling, int64_t *out_tokens, const uint8_t *emit = nullptr);
+    // Samples n continuations of one prompt, prefilled once and forked n
+    // ways; sample i draws with seed sampling.seed + i. Sample i's tokens go to
+    // out_tokens[i * max_new_tokens...] and its count to out_lengths[i]. Every
+    // sample stops like generate(), or early if the KV cache fills up.
+    void generateN(const int64_t *token_ids, size_t ntoken, size_t n, size_t max_new_tokens,
+                   const LlaisysQwen2SamplingParams &sampling, int64_t *out_tokens, size_t *out_lengths);
+    // Beam search with beam_width beams, each a fork of its parent. Beams end
+    // at end_token, max_new_tokens or maxseq; the hypothesis with the best
+    // log-probability per token is stored to out_tokens and its length is
+    // returned.
+    size_t beamSearch(const int64_t *token_ids, size_t ntoken, size_t beam_width, size_t max_new_tokens, int64_t *out_tokens);
+
+    // Limits of one step.
+    size_t maxStepTokens() const;
+    size_t maxStepSeqs() const;
+
+private:
+    // Arena views of one step with `ntoken` tokens.
+    struct StepTensors {
+        tensor_t token_ids, pos_ids, slot_ids, hidden;
+        tensor_t attn_normed, q, attn, attn_out;
+        tensor_t mlp_normed, mlp_act, mlp_out;
+        // [ntoken, heads, dh] views of q and attn.
+        tensor_t q3, attn3;
+    };
+    // Views of the per-sequence rows of a step with `nseq` sequences.
+    struct HeadTensors {
+        tensor_t last_hidden, last_normed, logits, next_token, next_logit;
+        // [nseq, 1] views of next_token and next_logit for the fused head.
+        tensor_t top1_idx, top1_val;
+        // Attention metadata: [nseq, nblocks] block tables, nseq + 1 query
+        // offsets and nseq KV lengths.
+        tensor_t block_tables, cu_seqlens, kv_lens;
+    };
+    struct Sequence {
+        // Every token appended so far, the keys of the prefix cache.
+        std::vector<int64_t> tokens;
+        utils::Rng rng;
+        bool seeded = false;
+    };
+    // The sequence whose blocks fill a row of _block_tables, and how many of
+    // them have been copied to the device.
+    struct TableRow {
+        seq_t seq = -1;
+        size_t synced = 0;
+    };
+    // Rows [offset, offset + ntoken) of a step belong to `seq`.
+    struct Segment {
+        seq_t seq;
+        Sequence *state;
+        size_t offset;
+        size_t ntoken;
+        size_t past;
+        // Trailing rows that get logits.
+        size_t nlogits = 1;
+    };
+
+    StepTensors _stepTensors(size_t ntoken) const;
+    HeadTensors _headTensors(size_t nseq) const;
+    const StepTensors &_tensors(size_t ntoken);
+    const HeadTensors &_heads(size_t nseq);
+
+    Sequence &_sequence(seq_t seq);
+    // Evicts cached prefixes until nblocks blocks are free; false if they
+    // cannot be.
+    bool _makeRoom(size_t nblocks);
+    // Runs the tokens of one sequence through the model, in several steps if
+    // needed, leaving the logits of the last one in row 0. Returns false,
+    // leaving the sequence as it was, if the KV cache cannot hold them.
+    bool _run(seq_t seq, const int64_t *token_ids, size_t ntoken);
+    // Validates a ragged batch and runs it, leaving one logits row per
+    // sequence; false if the KV cache cannot hold it.
+    bool _batch(const seq_t *seqs, size_t nseq, const int64_t *token_ids, const size_t *ntokens);
+    // Forward pass over _segments; with `logits`, ends with one logits row
+    // per segment.
+    void _forward(const int64_t *token_ids, size_t ntoken, bool logits);
+    void _layer(size_t layer, const StepTensors &t, const HeadTensors &h);
+    // Gathers the rows that get logits into LAST_HIDDEN.
+    void _lastHidden(const StepTensors &t);
+    // Runs the LM head over every gathered row, if not done yet: _logits()
+    // stores full logits, _topk(k) the k best tokens of each row on the host.
+    void _logits();
+    void _topk(size_t k);
+    // Picks the cheapest head serving the emitted rows of a step at once.
+    void _prepareHead(const LlaisysQwen2SamplingParams *sampling, const uint8_t *emit);
+    int64_t _argmax(size_t row);
+    // Picks a token from logits row `row` with the sequence's RNG. The
+    // penalties see the first `history` tokens of the sequence, all of them
+    // by default. With a draft, returns it with its probability under
+    // sampling and otherwise a token sampled from the others.
+    int64_t _sample(size_t row, const LlaisysQwen2SamplingParams &sampling, Sequence &state, int64_t draft = -1,
+                    size_t history = std::numeric_limits<size_t>::max());
+    // Logits row as f32 on the host, in _probs.
+    float *_hostLogits(size_t row);
+    // Copies n values of the model dtype from the device to f32 on the host.
+    void _toHost(float *out, const std::byte *src, size_t n);
+
+    LlaisysQwen2Meta _meta;
+    llaisysDeviceType_t _device_type;
+    int _device_id;
+    Qwen2Weights _weights;
+
+    PagedKVCache _kv_cache;
+    PrefixCache _prefix_cache;
+    bool _prefix_caching = true;
+    std::unordered_map<seq_t, Sequence> _sequences;
+    seq_t _default_seq;
+    std::vector<Segment> _segments;
+    // Logits rows left by the last forward step, and the head run on them
+    // so far: top-k width and whether the full logits are there.
+    size_t _logit_rows = 0;
+    size_t _head_k = 0;
+    bool _head_logits = false;
+
+    Qwen2Activations _activations;
+    // Views for single-token steps and for the most recent other step size.
+    StepTensors _decode_tensors, _step_tensors;
+    size_t _step_tensors_len = 0;
+    HeadTensors _single_head, _batch_heads;
+    size_t _batch_heads_len = 0;
+    // Position of every token of a step, and the KV cache row it writes.
+    std::vector<int64_t> _pos_ids, _slot_ids;
+    // Device-side attention metadata, one row per sequence slot of a step.
+    tensor_t _block_tables, _cu_seqlens, _kv_lens;
+    std::vector<TableRow> _table_rows;
+    std::vector<int64_t> _host_cu_seqlens, _host_kv_lens;
+
+    // Fused head outputs, [rows, k] once viewed.
+    tensor_t _top_idx, _top_val;
+
+    // Token history the sampling penalties apply to.
+    tensor_t _history;
+
+    // Host-side buffers of the greedy head and beam search.
+    std::vector<int64_t> _host_top_idx;
+    std::vector<std::byte> _host_values;
+    std::vector<float> _probs;
+    std::vector<int64_t> _candidates;
+    // Speculative decoding buffers.
+    std::vector<int64_t> _context, _drafts;
+};
+} // namespace llaisys::models
@@ -0,0 +1,177 @@
+#include "qwen2_scheduler.hpp"
+
+#include "../../utils.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace llaisys::models {
+Qwen2Scheduler::Qwen2Scheduler(Qwen2Model &model)
+    : _model(model), _chunk_tokens(std::min(DEFAULT_CHUNK_TOKENS, model.maxStepTokens())) {
+    size_t max_seqs = model.maxStepSeqs();
+    _seqs.reserve(max_seqs);
+    _ntokens.reserve(max_seqs);
+    _sampling.reserve(max_seqs);
+    _emit.reserve(max_seqs);
+    _out.resize(max_seqs);
+    _batch.reserve(max_seqs);
+    _events.reserve(max_seqs);
+    _tokens.reserve(model.maxStepTokens());
+}
+
+size_t Qwen2Scheduler::chunkTokens() const {
+    return _chunk_tokens;
+}
+
+void Qwen2Scheduler::setChunkTokens(size_t ntoken) {
+    CHECK_ARGUMENT(ntoken > 0, "Qwen2Scheduler: the chunk size must be positive.");
+    _chunk_tokens = std::min(ntoken, _model.maxStepTokens());
+}
+
+Qwen2Scheduler::request_t Qwen2Scheduler::submit(const int64_t *prompt, size_t ntoken, size_t max_new_tokens,
+                                                 const LlaisysQwen2SamplingParams &sampling) {
+    size_t maxseq = _model.meta().maxseq;
+    CHECK_ARGUMENT(ntoken > 0 && ntoken <= maxseq, "Qwen2Scheduler: the prompt must hold 1 to maxseq tokens.");
+    CHECK_ARGUMENT(max_new_tokens > 0, "Qwen2Scheduler: max_new_tokens must be positive.");
+    // The last generated token is never fed back.
+    size_t reserved = std::min(ntoken + max_new_tokens - 1, maxseq);
+    request_t id = _next_request++;
+    _waiting.push_back(Request{id, -1, std::vector<int64_t>(prompt, prompt + ntoken), 0, max_new_tokens, 0, sampling, 0, reserved, std::nullopt});
+    return id;
+}
+
+void Qwen2Scheduler::cancel(request_t request) {
+    auto matches = [&](const Request &r) { return r.id == request; };
+    auto it = std::find_if(_running.begin(), _running.end(), matches);
+    if (it != _running.end()) {
+        return _finish(it);
+    }
+    _waiting.remove_if(matches);
+}
+
+size_t Qwen2Scheduler::numPending() const {
+    return _waiting.size() + _running.size();
+}
+
+size_t Qwen2Scheduler::_blocks(size_t ntoken) {
+    return (ntoken + Qwen2Model::KV_BLOCK_SIZE - 1) / Qwen2Model::KV_BLOCK_SIZE;
+}
+
+void Qwen2Scheduler::_admit() {
+    // Blocks running requests were promised but do not hold yet.
+    size_t promised = 0;
+    for (const Request &r : _running) {
+        promised += _blocks(r.reserved) - std::min(_blocks(r.reserved), _blocks(_model.length(r.seq)));
+    }
+    // First come, first served: a request that does not fit holds back the
+    // ones behind it.
+    while (!_waiting.empty() && _running.size() < _model.maxStepSeqs()) {
+        Request &r = _waiting.front();
+        // A cached prefix of the prompt needs neither compute nor new blocks.
+        Qwen2Model::seq_t seq = _model.createSequence();
+        size_t cached = _model.attachPrefix(seq, r.prompt.data(), r.prompt.size());
+        size_t need = _blocks(r.reserved) - _blocks(cached);
+        if (promised + need > _model.freeKVTokens() / Qwen2Model::KV_BLOCK_SIZE) {
+            _model.releaseSequence(seq);
+            break;
+        }
+        if (r.rng) {
+            _model.setSequenceRng(seq, *r.rng);
+        }
+        r.seq = seq;
+        r.prefilled = cached;
+        promised += need;
+        _running.splice(_running.end(), _waiting, _waiting.begin());
+    }
+}
+
+void Qwen2Scheduler::_finish(std::list<Request>::iterator it) {
+    _model.releaseSequence(it->seq);
+    _running.erase(it);
+}
+
+// The newest running request gives its blocks back and goes first in the
+// queue. Its prompt already ends with its generated tokens but the last one,
+// and it keeps its sampling RNG, so prefilling it again goes on where it
+// stopped.
+void Qwen2Scheduler::_preempt() {
+    Request &r = _running.back();
+    if (r.prefilled == r.prompt.size()) {
+        r.prompt.push_back(r.last_token);
+    }
+    r.rng = _model.sequenceRng(r.seq);
+    _model.releaseSequence(r.seq);
+    r.seq = -1;
+    r.prefilled = 0;
+    _waiting.splice(_waiting.begin(), _running, std::prev(_running.end()));
+}
+
+const std::vector<Qwen2Scheduler::Event> &Qwen2Scheduler::step() {
+    _events.clear();
+    _admit();
+    if (_running.empty()) {
+        return _events;
+    }
+
+    _seqs.clear();
+    _tokens.clear();
+    _ntokens.clear();
+    _sampling.clear();
+    _emit.clear();
+    _batch.clear();
+    auto add = [&](std::list<Request>::iterator it, const int64_t *tokens, size_t ntoken, bool emit) {
+        _seqs.push_back(it->seq);
+        _tokens.insert(_tokens.end(), tokens, tokens + ntoken);
+        _ntokens.push_back(ntoken);
+        _sampling.push_back(it->sampling);
+        _emit.push_back(emit);
+        _batch.push_back(it);
+    };
+    // Decodes go first, so a long prompt never delays the next token of a
+    // running stream; prompt chunks take what is left of the budget.
+    for (auto it = _running.begin(); it != _running.end(); ++it) {
+        if (it->prefilled == it->prompt.size()) {
+            add(it, &it->last_token, 1, true);
+        }
+    }
+    for (auto it = _running.begin(); it != _running.end() && _tokens.size() < _chunk_tokens; ++it) {
+        size_t left = it->prompt.size() - it->prefilled;
+        if (left > 0) {
+            size_t n = std::min(left, _chunk_tokens - _tokens.size());
+            add(it, it->prompt.data() + it->prefilled, n, n == left);
+        }
+    }
+    if (_seqs.empty()) {
+        return _events;
+    }
+
+    if (!_model.step(_seqs.data(), _seqs.size(), _tokens.data(), _ntokens.data(), _sampling.data(), _out.data(), _emit.data())) {
+        _preempt();
+        return _events;
+    }
+    for (size_t i = 0; i < _batch.size(); i++) {
+        auto it = _batch[i];
+        if (it->prefilled < it->prompt.size()) {
+            it->prefilled += _ntokens[i];
+            if (it->prefilled == it->prompt.size()) {
+                _model.cachePrefix(it->seq);
+            }
+        } else {
+            it->prompt.push_back(it->last_token);
+            it->prefilled++;
+        }
+        if (!_emit[i]) {
+            continue;
+        }
+        it->generated++;
+        it->last_token = _out[i];
+        bool finished = _out[i] == _model.meta().end_token || it->generated == it->max_new_tokens
+                     || _model.length(it->seq) == _model.meta().maxseq;
+        _events.push_back(Event{it->id, _out[i], finished});
+        if (finished) {
+            _finish(it);
+        }
+    }
+    return _events;
+}
+} // namespace llaisys::models
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "qwen2_model.hpp"
+
+#include <list>
+#include <optional>
+#include <vector>
+
+namespace llaisys::models {
+// Serving loop over a Qwen2Model: requests are submitted with their prompt
+// and run together through continuous batching.
+//
+// Every step first gives each decoding request its next token, then fills the
+// rest of the step's token budget with prompt chunks of prefilling requests,
+// oldest first. A long prompt is thus ingested over several steps that also
+// advance every other stream, which bounds their inter-token latency by the
+// cost of one budget-sized step instead of a whole prefill.
+//
+// A request is admitted only once the KV cache can hold its prompt and all of
+// its new tokens next to the reservations of the requests already running,
+// so a step does not run out of cache midway. Should it still, because
+// sequences outside the scheduler took blocks, the newest running request is
+// preempted: it frees its KV cache and waits at the head of the queue to
+// prefill its tokens again. Admission attaches the longest
+// cached prefix of the prompt, and a finished prefill publishes the prompt's
+// blocks for later requests.
+class Qwen2Scheduler {
+public:
+    using request_t = int64_t;
+
+    static constexpr size_t DEFAULT_CHUNK_TOKENS = 512;
+
+    struct Event {
+        request_t request;
+        int64_t token;
+        bool finished;
+    };
+
+    explicit Qwen2Scheduler(Qwen2Model &model);
+
+    Qwen2Scheduler(const Qwen2Scheduler &) = delete;
+    Qwen2Scheduler &operator=(const Qwen2Scheduler &) = delete;
+
+    // Tokens per step shared by decodes and prompt chunks; at most the
+    // model's MAX_STEP_TOKENS.
+    size_t chunkTokens() const;
+    void setChunkTokens(size_t ntoken);
+
+    request_t submit(const int64_t *prompt, size_t ntoken, size_t max_new_tokens, const LlaisysQwen2SamplingParams &sampling);
+    // Drops a waiting or running request and frees its KV cache.
+    void cancel(request_t request);
+    // Requests submitted and not yet finished or cancelled.
+    size_t numPending() const;
+
+    // Runs one batched step. Returns one event per request that produced a
+    // token; a request is finished after end_token, max_new_tokens or maxseq.
+    // Returns nothing if no request is pending, or if the KV cache could not
+    // hold the step and a request was preempted instead.
+    const std::vector<Event> &step();
+
+private:
+    struct Request {
+        request_t id;
+        Qwen2Model::seq_t seq;
+        // The prompt, followed by every generated token fed back so far.
+        std::vector<int64_t> prompt;
+        size_t prefilled;
+        size_t max_new_tokens;
+        size_t generated;
+        LlaisysQwen2SamplingParams sampling;
+        int64_t last_token;
+        // Tokens of KV cache promised at admission.
+        size_t reserved;
+        // Sampling state carried over a preemption.
+        std::optional<utils::Rng> rng;
+    };
+
+    static size_t _blocks(size_t ntoken);
+    void _admit();
+    void _finish(std::list<Request>::iterator it);
+    void _preempt();
+
+    Qwen2Model &_model;
+    size_t _chunk_tokens;
+    request_t _next_request = 0;
+    std::list<Request> _waiting;
+    std::list<Request> _running;
+
+    // Step buffers.
+    std::vector<Qwen2Model::seq_t> _seqs;
+    std::vector<int64_t> _tokens;
+    std::vector<size_t> _ntokens;
+    std::vector<LlaisysQwen2SamplingParams> _sampling;
+    std::vector<uint8_t> _emit;
+    std::vector<int64_t> _out;
+    std::vector<std::list<Request>::iterator> _batch;
+    std::vector<Event> _events;
+};
+} // namespace llaisys::models
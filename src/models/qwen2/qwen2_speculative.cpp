@@ -0,0 +1,75 @@
+#include "qwen2_speculative.hpp"
+
+#include "../../utils.hpp"
+
+#include <algorithm>
+
+namespace llaisys::models {
+PromptLookupDrafter::PromptLookupDrafter(size_t max_ngram) : _max_ngram(max_ngram) {
+    CHECK_ARGUMENT(max_ngram > 0, "PromptLookupDrafter: max_ngram must be positive.");
+}
+
+size_t PromptLookupDrafter::draft(const std::vector<int64_t> &context, size_t n, int64_t *out) {
+    size_t len = context.size();
+    if (len < 2 || n == 0) {
+        return 0;
+    }
+    // Longer n-grams first: they make fewer but better matches.
+    for (size_t ngram = std::min(_max_ngram, len - 1); ngram > 0; ngram--) {
+        auto tail = context.end() - static_cast<std::ptrdiff_t>(ngram);
+        for (size_t start = len - ngram; start-- > 0;) {
+            auto match = context.begin() + static_cast<std::ptrdiff_t>(start);
+            if (std::equal(tail, context.end(), match)) {
+                size_t follow = start + ngram;
+                size_t count = std::min(n, len - follow);
+                std::copy_n(context.begin() + static_cast<std::ptrdiff_t>(follow), count, out);
+                return count;
+            }
+        }
+    }
+    return 0;
+}
+
+ModelDrafter::ModelDrafter(Qwen2Model &model) : _model(model), _seq(model.createSequence()) {}
+
+ModelDrafter::~ModelDrafter() {
+    _model.releaseSequence(_seq);
+}
+
+size_t ModelDrafter::draft(const std::vector<int64_t> &context, size_t n, int64_t *out) {
+    size_t maxseq = _model.meta().maxseq;
+    if (context.empty() || context.size() > maxseq || n == 0) {
+        return 0;
+    }
+    n = std::min(n, maxseq - context.size() + 1);
+
+    // Keep the tokens the context still agrees with, except its last one,
+    // whose logits give the first guess.
+    auto diverged = std::mismatch(_tokens.begin(), _tokens.end(), context.begin(), context.end()).first;
+    size_t keep = std::min(static_cast<size_t>(diverged - _tokens.begin()), context.size() - 1);
+    _model.truncateSequence(_seq, keep);
+    _tokens.resize(keep);
+
+    int64_t next = 0;
+    for (size_t done = keep; done < context.size();) {
+        size_t ntoken = std::min(_model.maxStepTokens(), context.size() - done);
+        uint8_t emit = done + ntoken == context.size();
+        if (!_model.step(&_seq, 1, context.data() + done, &ntoken, nullptr, &next, &emit)) {
+            return 0;
+        }
+        _tokens.insert(_tokens.end(), context.begin() + static_cast<std::ptrdiff_t>(done),
+                       context.begin() + static_cast<std::ptrdiff_t>(done + ntoken));
+        done += ntoken;
+    }
+
+    size_t drafted = 0;
+    for (;;) {
+        out[drafted++] = next;
+        size_t one = 1;
+        if (drafted == n || !_model.step(&_seq, 1, &out[drafted - 1], &one, nullptr, &next)) {
+            return drafted;
+        }
+        _tokens.push_back(out[drafted - 1]);
+    }
+}
+} // namespace llaisys::models
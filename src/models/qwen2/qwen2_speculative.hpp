@@ -0,0 +1,54 @@
+#pragma once
+
+#include "qwen2_model.hpp"
+
+#include <vector>
+
+namespace llaisys::models {
+// Proposes tokens for speculative decoding. The target model checks all of
+// them in one forward step and keeps the longest prefix it agrees with, so a
+// drafter only has to be cheap and often right.
+class Drafter {
+public:
+    virtual ~Drafter() = default;
+    // Guesses up to n tokens following context and stores them to out.
+    // Returns how many were guessed; 0 makes the caller decode normally.
+    virtual size_t draft(const std::vector<int64_t> &context, size_t n, int64_t *out) = 0;
+};
+
+// Prompt lookup: finds the latest earlier occurrence of the last few tokens
+// in the context and proposes what followed it. Needs no second model and
+// does well wherever the output repeats its input, as in summaries, code
+// edits or retrieval answers.
+class PromptLookupDrafter : public Drafter {
+public:
+    static constexpr size_t DEFAULT_MAX_NGRAM = 3;
+
+    explicit PromptLookupDrafter(size_t max_ngram = DEFAULT_MAX_NGRAM);
+
+    size_t draft(const std::vector<int64_t> &context, size_t n, int64_t *out) override;
+
+private:
+    size_t _max_ngram;
+};
+
+// Greedy decoding with a smaller model sharing the target's vocabulary. The
+// draft model keeps its own sequence across calls and only recomputes the
+// tokens where the context left its previous guesses.
+class ModelDrafter : public Drafter {
+public:
+    explicit ModelDrafter(Qwen2Model &model);
+    ~ModelDrafter() override;
+
+    ModelDrafter(const ModelDrafter &) = delete;
+    ModelDrafter &operator=(const ModelDrafter &) = delete;
+
+    size_t draft(const std::vector<int64_t> &context, size_t n, int64_t *out) override;
+
+private:
+    Qwen2Model &_model;
+    Qwen2Model::seq_t _seq;
+    // Tokens in the draft sequence's KV cache.
+    std::vector<int64_t> _tokens;
+};
+} // namespace llaisys::models
@@ -1,16 +1,19 @@
 #include "embedding_cpu.hpp"
 
+#include "../../../core/thread_pool/thread_pool.hpp"
 #include "../../../utils.hpp"
 
 #include <cmath>
 
 template <typename T>
 void embedding_(T *out, const int64_t *index, const T *weight, size_t shape_index, size_t width){
-    for (size_t i = 0; i < shape_index; i++) {
-        for (size_t j = 0; j < width; j++) {
-            out[i*width+j] = weight[index[i]*width+j];
+    llaisys::core::parallel_for(shape_index, 1, [&](size_t row_begin, size_t row_end) {
+        for (size_t i = row_begin; i < row_end; i++) {
+            for (size_t j = 0; j < width; j++) {
+                out[i*width+j] = weight[index[i]*width+j];
+            }
         }
-    }
+    });
 }
 
 namespace llaisys::ops::cpu {
@@ -0,0 +1,51 @@
+#pragma once
+#include "llaisys.h"
+
+#include "../../../utils.hpp"
+#include "../../../utils/math.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace llaisys::ops::cpu {
+// What the GEMM and GEMV kernels do with in * weight^T + bias before storing
+// it, so that the output is written once instead of being re-read by the
+// next op.
+struct Epilogue {
+    // Added to the output, rounded as linear followed by add would round it.
+    // Laid out like the output, which it may be.
+    const std::byte *residual = nullptr;
+    // weight (and bias) hold n gate rows followed by n up rows, and the
+    // output is swiglu(gate, up) as the swiglu op computes it.
+    bool swiglu = false;
+};
+
+// Stores n results of one output row from f32 accumulators. up holds the
+// matching up results in SwiGLU mode and is nullptr otherwise; residual may
+// be nullptr.
+template <typename T>
+void store_row(T *out, const float *acc, const float *up, const T *residual, size_t n) {
+    if (up == nullptr && residual == nullptr) {
+        return utils::cast(out, acc, n);
+    }
+    constexpr size_t CHUNK = 64;
+    // Staged so that residual is read before out, which it may be, is written.
+    T v[CHUNK], u[CHUNK];
+    for (size_t j0 = 0; j0 < n; j0 += CHUNK) {
+        size_t len = std::min(CHUNK, n - j0);
+        // Round where the unfused ops store their outputs.
+        utils::cast(v, acc + j0, len);
+        if (up != nullptr) {
+            utils::cast(u, up + j0, len);
+            utils::silu_mul(v, v, u, len);
+        }
+        if (residual != nullptr) {
+            for (size_t j = 0; j < len; j++) {
+                out[j0 + j] = utils::cast<T>(utils::cast<float>(residual[j0 + j]) + utils::cast<float>(v[j]));
+            }
+        } else {
+            std::copy(v, v + len, out + j0);
+        }
+    }
+}
+} // namespace llaisys::ops::cpu
@@ -0,0 +1,266 @@
+#include "gemm_cpu.hpp"
+
+#include "../../../core/thread_pool/thread_pool.hpp"
+#include "../../../utils.hpp"
+#include "../../../utils/simd.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+using llaisys::ops::cpu::Epilogue;
+using llaisys::ops::cpu::WeightScales;
+
+// Register tile of the micro-kernel: MR rows of `in` times NR rows of `weight`.
+// Cache blocking: the KC x NC block of `weight` is packed once and shared by
+// all threads from L2/L3; a task runs one KC-deep NR panel of it, held in L1,
+// against an MC x KC block of packed `in` streaming from L2.
+#if defined(LLAISYS_AVX512)
+constexpr size_t MR = 8;
+constexpr size_t NR = 32;
+#elif defined(LLAISYS_AVX2)
+constexpr size_t MR = 6;
+constexpr size_t NR = 16;
+#else
+constexpr size_t MR = 4;
+constexpr size_t NR = 8;
+#endif
+constexpr size_t KC = 256;
+constexpr size_t MC = MR * 16;
+constexpr size_t NC = NR * 32;
+
+// c[MR][NR] (+)= a[kc][MR] * b[kc][NR], both operands packed.
+void micro_kernel(size_t kc, const float *a, const float *b, float *c, size_t ldc, bool accumulate) {
+#if defined(LLAISYS_AVX512)
+    __m512 acc[MR][2];
+#pragma GCC unroll 8
+    for (size_t r = 0; r < MR; r++) {
+        acc[r][0] = accumulate ? _mm512_loadu_ps(c + r * ldc) : _mm512_setzero_ps();
+        acc[r][1] = accumulate ? _mm512_loadu_ps(c + r * ldc + 16) : _mm512_setzero_ps();
+    }
+    for (size_t p = 0; p < kc; p++, a += MR, b += NR) {
+        __m512 b0 = _mm512_loadu_ps(b);
+        __m512 b1 = _mm512_loadu_ps(b + 16);
+#pragma GCC unroll 8
+        for (size_t r = 0; r < MR; r++) {
+            __m512 ar = _mm512_set1_ps(a[r]);
+            acc[r][0] = _mm512_fmadd_ps(ar, b0, acc[r][0]);
+            acc[r][1] = _mm512_fmadd_ps(ar, b1, acc[r][1]);
+        }
+    }
+#pragma GCC unroll 8
+    for (size_t r = 0; r < MR; r++) {
+        _mm512_storeu_ps(c + r * ldc, acc[r][0]);
+        _mm512_storeu_ps(c + r * ldc + 16, acc[r][1]);
+    }
+#elif defined(LLAISYS_AVX2)
+    __m256 acc[MR][2];
+#pragma GCC unroll 8
+    for (size_t r = 0; r < MR; r++) {
+        acc[r][0] = accumulate ? _mm256_loadu_ps(c + r * ldc) : _mm256_setzero_ps();
+        acc[r][1] = accumulate ? _mm256_loadu_ps(c + r * ldc + 8) : _mm256_setzero_ps();
+    }
+    for (size_t p = 0; p < kc; p++, a += MR, b += NR) {
+        __m256 b0 = _mm256_loadu_ps(b);
+        __m256 b1 = _mm256_loadu_ps(b + 8);
+#pragma GCC unroll 8
+        for (size_t r = 0; r < MR; r++) {
+            __m256 ar = _mm256_broadcast_ss(a + r);
+            acc[r][0] = _mm256_fmadd_ps(ar, b0, acc[r][0]);
+            acc[r][1] = _mm256_fmadd_ps(ar, b1, acc[r][1]);
+        }
+    }
+#pragma GCC unroll 8
+    for (size_t r = 0; r < MR; r++) {
+        _mm256_storeu_ps(c + r * ldc, acc[r][0]);
+        _mm256_storeu_ps(c + r * ldc + 8, acc[r][1]);
+    }
+#else
+    float acc[MR][NR];
+    for (size_t r = 0; r < MR; r++) {
+        for (size_t j = 0; j < NR; j++) {
+            acc[r][j] = accumulate ? c[r * ldc + j] : 0.0f;
+        }
+    }
+    for (size_t p = 0; p < kc; p++, a += MR, b += NR) {
+        for (size_t r = 0; r < MR; r++) {
+            for (size_t j = 0; j < NR; j++) {
+                acc[r][j] += a[r] * b[j];
+            }
+        }
+    }
+    for (size_t r = 0; r < MR; r++) {
+        for (size_t j = 0; j < NR; j++) {
+            c[r * ldc + j] = acc[r][j];
+        }
+    }
+#endif
+}
+
+// Widens n values of a row of src to f32. An int8 row is dequantized with
+// its group scales; src then points at column k0 of the row.
+template <typename T>
+void widen(float *dst, const T *src, size_t n, const float *, size_t, size_t) {
+    llaisys::utils::cast(dst, src, n);
+}
+
+void widen(float *dst, const int8_t *src, size_t n, const float *row_scales, size_t group, size_t k0) {
+    for (size_t i = 0; i < n;) {
+        size_t len = std::min(n - i, group - (k0 + i) % group);
+        float s = row_scales[(k0 + i) / group];
+        size_t r = 0;
+#if defined(LLAISYS_AVX512) || defined(LLAISYS_AVX2)
+        namespace simd = llaisys::utils::simd;
+        simd::vec_t sv = simd::set1(s);
+        for (; r + simd::VLEN <= len; r += simd::VLEN) {
+            simd::store(dst + i + r, simd::mul(simd::load(src + i + r), sv));
+        }
+#endif
+        for (; r < len; r++) {
+            dst[i + r] = static_cast<float>(src[i + r]) * s;
+        }
+        i += len;
+    }
+}
+
+// Packs `rows` rows of src (leading dimension ld) over a kc-deep slice into a
+// k-major f32 panel of the given width: dst[p][r] = src[r][p]. Rows past
+// `rows` are zero so the micro-kernel never needs edge handling. A quantized
+// src starts at column k0 of weight row r0.
+template <typename T>
+void pack_panel(float *dst, const T *src, size_t ld, size_t rows, size_t kc, size_t width, const WeightScales &scales = {}, size_t r0 = 0,
+                size_t k0 = 0) {
+    thread_local std::vector<float> row;
+    row.resize(kc);
+    for (size_t r = 0; r < rows; r++) {
+        const float *row_scales = scales.data != nullptr ? scales.data + (r0 + r) * (ld / scales.group) : nullptr;
+        widen(row.data(), src + r * ld, kc, row_scales, scales.group, k0);
+        for (size_t p = 0; p < kc; p++) {
+            dst[p * width + r] = row[p];
+        }
+    }
+    for (size_t r = rows; r < width; r++) {
+        for (size_t p = 0; p < kc; p++) {
+            dst[p * width + r] = 0.0f;
+        }
+    }
+}
+
+template <typename W, typename T>
+void gemm_(T *out, const T *in, const W *weight, const T *bias, const WeightScales &scales, size_t m, size_t k, size_t n, const T *residual,
+           bool swiglu) {
+    // In SwiGLU mode a block covers NB gate columns and the matching NB up
+    // columns, which sit NB to the right in the packed block and in c, so
+    // both stay NC wide either way.
+    size_t halves = swiglu ? 2 : 1;
+    size_t nb = NC / halves;
+    size_t mpad = (m + MR - 1) / MR * MR;
+    size_t apanels = mpad / MR;
+    size_t mtiles = (m + MC - 1) / MC;
+
+    // f32 accumulators of the current column block, and both packed
+    // operands of the current (column block, KC slice). They belong to the
+    // calling thread; the workers reach them through these references.
+    thread_local std::vector<float> a_buffer, b_buffer, c_buffer;
+    std::vector<float> &a_pack = a_buffer;
+    std::vector<float> &b_pack = b_buffer;
+    std::vector<float> &c = c_buffer;
+    a_pack.resize(mpad * KC);
+    b_pack.resize(NC * KC);
+    c.resize(mpad * NC);
+
+    for (size_t n0 = 0; n0 < n; n0 += nb) {
+        size_t nc = std::min(nb, n - n0);
+        size_t npanels = (nc + NR - 1) / NR;
+        size_t bpanels = halves * npanels;
+        // With k == 0 one round still runs, and zeroes c.
+        for (size_t k0 = 0; k0 == 0 || k0 < k; k0 += KC) {
+            size_t kc = std::min(KC, k - k0);
+            bool last = k0 + KC >= k;
+
+            // Every panel of both operands is packed once per round.
+            llaisys::core::parallel_for(bpanels + apanels, 1, [&](size_t begin, size_t end) {
+                for (size_t p = begin; p < end; p++) {
+                    if (p < bpanels) {
+                        size_t h = p / npanels, j = (p % npanels) * NR;
+                        pack_panel(b_pack.data() + (h * nb + j) * kc, weight + (h * n + n0 + j) * k + k0, k, std::min(NR, nc - j), kc, NR, scales,
+                                   h * n + n0 + j, k0);
+                    } else {
+                        size_t i = (p - bpanels) * MR;
+                        pack_panel(a_pack.data() + i * kc, in + i * k + k0, k, std::min(MR, m - i), kc, MR);
+                    }
+                }
+            });
+
+            // One task per (MC row tile, NR column panel), so that even a few
+            // rows give every thread work. The last round also runs the
+            // epilogue on the tile while it is in cache.
+            llaisys::core::parallel_for(mtiles * npanels, 1, [&](size_t begin, size_t end) {
+                for (size_t t = begin; t < end; t++) {
+                    size_t m0 = (t / npanels) * MC;
+                    size_t j = (t % npanels) * NR;
+                    size_t m1 = std::min(m, m0 + MC);
+                    for (size_t h = 0; h < halves; h++) {
+                        for (size_t i = m0; i < m1; i += MR) {
+                            micro_kernel(kc, a_pack.data() + i * kc, b_pack.data() + (h * nb + j) * kc, c.data() + i * NC + h * nb + j, NC, k0 > 0);
+                        }
+                    }
+                    if (!last) {
+                        continue;
+                    }
+
+                    size_t ncols = std::min(NR, nc - j);
+                    float bias_cols[2 * NR];
+                    if (bias != nullptr) {
+                        for (size_t h = 0; h < halves; h++) {
+                            llaisys::utils::cast(bias_cols + h * NR, bias + h * n + n0 + j, ncols);
+                        }
+                    }
+                    for (size_t i = m0; i < m1; i++) {
+                        float *row = c.data() + i * NC + j;
+                        if (bias != nullptr) {
+                            for (size_t h = 0; h < halves; h++) {
+                                for (size_t jj = 0; jj < ncols; jj++) {
+                                    row[h * nb + jj] += bias_cols[h * NR + jj];
+                                }
+                            }
+                        }
+                        size_t offset = i * n + n0 + j;
+                        llaisys::ops::cpu::store_row(out + offset, row, swiglu ? row + nb : nullptr, residual != nullptr ? residual + offset : nullptr,
+                                                     ncols);
+                    }
+                }
+            });
+        }
+    }
+}
+
+// The weight is int8 when it has scales, and of the activation dtype T
+// otherwise.
+template <typename T>
+void gemm_t(std::byte *out, const std::byte *in, const std::byte *weight, const std::byte *bias, const WeightScales &scales, size_t m, size_t k,
+            size_t n, const Epilogue &epilogue) {
+    if (scales.data != nullptr) {
+        return gemm_(reinterpret_cast<T *>(out), reinterpret_cast<const T *>(in), reinterpret_cast<const int8_t *>(weight),
+                     reinterpret_cast<const T *>(bias), scales, m, k, n, reinterpret_cast<const T *>(epilogue.residual), epilogue.swiglu);
+    }
+    gemm_(reinterpret_cast<T *>(out), reinterpret_cast<const T *>(in), reinterpret_cast<const T *>(weight), reinterpret_cast<const T *>(bias),
+          scales, m, k, n, reinterpret_cast<const T *>(epilogue.residual), epilogue.swiglu);
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void gemm(std::byte *out, const std::byte *in, const std::byte *weight, const std::byte *bias, size_t m, size_t k, size_t n, llaisysDataType_t type,
+          const Epilogue &epilogue, const WeightScales &scales) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return gemm_t<float>(out, in, weight, bias, scales, m, k, n, epilogue);
+    case LLAISYS_DTYPE_BF16:
+        return gemm_t<llaisys::bf16_t>(out, in, weight, bias, scales, m, k, n, epilogue);
+    case LLAISYS_DTYPE_F16:
+        return gemm_t<llaisys::fp16_t>(out, in, weight, bias, scales, m, k, n, epilogue);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
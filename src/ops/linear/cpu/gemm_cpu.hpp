@@ -0,0 +1,16 @@
+#pragma once
+#include "llaisys.h"
+
+#include "epilogue.hpp"
+#include "weight_scales.hpp"
+
+#include <cstddef>
+
+namespace llaisys::ops::cpu {
+// out[m][n] = sum_k in[m][k] * weight[n][k] + bias[n], computed with packed
+// f32 panels and register-tiled micro-kernels, then passed through the
+// epilogue as each output tile is stored. `bias` may be nullptr. With scales,
+// weight is int8 and is dequantized as its panels are packed.
+void gemm(std::byte *out, const std::byte *in, const std::byte *weight, const std::byte *bias, size_t m, size_t k, size_t n, llaisysDataType_t type,
+          const Epilogue &epilogue = {}, const WeightScales &scales = {});
+} // namespace llaisys::ops::cpu
@@ -0,0 +1,283 @@
+#include "gemv_cpu.hpp"
+
+#include "../../../core/thread_pool/thread_pool.hpp"
+#include "../../../utils.hpp"
+#include "../../../utils/simd.hpp"
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+namespace {
+namespace simd = llaisys::utils::simd;
+using llaisys::ops::cpu::Epilogue;
+using llaisys::ops::cpu::WeightScales;
+
+// How far ahead of the current position each weight row stream is prefetched.
+constexpr size_t PREFETCH_BYTES = 512;
+
+// Output columns are computed in runs of this many before the epilogue
+// stores them.
+constexpr size_t RUN = 64;
+
+#if defined(LLAISYS_AVX512) || defined(LLAISYS_AVX2)
+// acc[i][r] += x[i] * w[r] over the VLEN columns from p.
+template <size_t M, size_t R, typename W>
+inline void fma_step(simd::vec_t (&acc)[M][R], const float *x, const W *const (&w)[R], size_t k, size_t p) {
+    simd::vec_t wv[R];
+#pragma GCC unroll 4
+    for (size_t r = 0; r < R; r++) {
+        _mm_prefetch(reinterpret_cast<const char *>(w[r] + p) + PREFETCH_BYTES, _MM_HINT_T0);
+        wv[r] = simd::load(w[r] + p);
+    }
+#pragma GCC unroll 8
+    for (size_t i = 0; i < M; i++) {
+        simd::vec_t xv = simd::load(x + i * k + p);
+#pragma GCC unroll 4
+        for (size_t r = 0; r < R; r++) {
+            acc[i][r] = simd::fma(xv, wv[r], acc[i][r]);
+        }
+    }
+}
+#endif
+
+// acc[i * RUN + r] = x[i] . weight[j + r] + bias[j + r] for i < M, r < R: R
+// weight rows are streamed together so that every loaded input vector feeds
+// M * R independent accumulators. int8 weights are widened as they are
+// loaded, and every group's partial sums are scaled once at its end.
+template <size_t M, size_t R, typename W, typename T>
+void dot_block(float *acc_out, const float *x, const W *weight, const T *bias, const float *scales, size_t group, size_t k, size_t j) {
+    constexpr bool QUANTIZED = std::is_same_v<W, int8_t>;
+    const W *w[R];
+    [[maybe_unused]] const float *s[R];
+    for (size_t r = 0; r < R; r++) {
+        w[r] = weight + (j + r) * k;
+        if constexpr (QUANTIZED) {
+            s[r] = scales + (j + r) * (k / group);
+        }
+    }
+
+    float sums[M][R];
+    size_t p = 0;
+#if defined(LLAISYS_AVX512) || defined(LLAISYS_AVX2)
+    simd::vec_t acc[M][R];
+    for (size_t i = 0; i < M; i++) {
+        for (size_t r = 0; r < R; r++) {
+            acc[i][r] = simd::zero();
+        }
+    }
+    if constexpr (QUANTIZED) {
+        // Groups are whole vectors, except for a per-channel tail.
+        for (size_t g0 = 0; g0 < k; g0 += group) {
+            size_t g1 = std::min(k, g0 + group);
+            simd::vec_t part[M][R];
+            for (size_t i = 0; i < M; i++) {
+                for (size_t r = 0; r < R; r++) {
+                    part[i][r] = simd::zero();
+                }
+            }
+            for (; p + simd::VLEN <= g1; p += simd::VLEN) {
+                fma_step<M, R>(part, x, w, k, p);
+            }
+            for (size_t r = 0; r < R; r++) {
+                simd::vec_t sv = simd::set1(s[r][g0 / group]);
+                for (size_t i = 0; i < M; i++) {
+                    acc[i][r] = simd::fma(part[i][r], sv, acc[i][r]);
+                }
+            }
+        }
+    } else {
+        for (; p + simd::VLEN <= k; p += simd::VLEN) {
+            fma_step<M, R>(acc, x, w, k, p);
+        }
+    }
+    for (size_t i = 0; i < M; i++) {
+        for (size_t r = 0; r < R; r++) {
+            sums[i][r] = simd::hsum(acc[i][r]);
+        }
+    }
+#else
+    for (size_t i = 0; i < M; i++) {
+        for (size_t r = 0; r < R; r++) {
+            sums[i][r] = 0.0f;
+        }
+    }
+#endif
+    for (; p < k; p++) {
+        for (size_t r = 0; r < R; r++) {
+            float wv = llaisys::utils::cast<float>(w[r][p]);
+            if constexpr (QUANTIZED) {
+                wv *= s[r][p / group];
+            }
+            for (size_t i = 0; i < M; i++) {
+                sums[i][r] += x[i * k + p] * wv;
+            }
+        }
+    }
+
+    for (size_t r = 0; r < R; r++) {
+        float b = bias != nullptr ? llaisys::utils::cast<float>(bias[j + r]) : 0.0f;
+        for (size_t i = 0; i < M; i++) {
+            acc_out[i * RUN + r] = sums[i][r] + b;
+        }
+    }
+}
+
+// Columns [j, j + len) of every row into acc, len <= RUN.
+template <size_t M, typename W, typename T>
+void dot_run(float *acc, const float *x, const W *weight, const T *bias, const float *scales, size_t group, size_t k, size_t j, size_t len) {
+    // Keep the M * R accumulators, twice that for int8 weights, plus R weight
+    // vectors within the register file.
+    constexpr bool QUANTIZED = std::is_same_v<W, int8_t>;
+#if defined(LLAISYS_AVX512)
+    constexpr size_t R = QUANTIZED ? (M <= 2 ? 4 : (M <= 4 ? 2 : 1)) : (M <= 4 ? 4 : 2);
+#else
+    constexpr size_t R = QUANTIZED ? (M <= 1 ? 4 : (M <= 2 ? 2 : 1)) : (M <= 2 ? 4 : (M <= 4 ? 2 : 1));
+#endif
+    size_t r = 0;
+    for (; r + R <= len; r += R) {
+        dot_block<M, R>(acc + r, x, weight, bias, scales, group, k, j + r);
+    }
+    for (; r < len; r++) {
+        dot_block<M, 1>(acc + r, x, weight, bias, scales, group, k, j + r);
+    }
+}
+
+// Output columns [n0, n1), stored from out[i * ldo]; residual, if any, is
+// laid out the same way. In SwiGLU mode weight, bias and scales hold n gate
+// rows, then n up rows.
+template <size_t M, typename W, typename T>
+void gemv_rows(T *out, size_t ldo, const float *x, const W *weight, const T *bias, const WeightScales &scales, size_t k, size_t n0, size_t n1,
+               const T *residual, bool swiglu, size_t n) {
+    const float *up_scales = scales.data != nullptr ? scales.data + n * (k / scales.group) : nullptr;
+    float acc[M * RUN], up[M * RUN];
+    for (size_t j = n0; j < n1; j += RUN) {
+        size_t len = std::min(RUN, n1 - j);
+        dot_run<M>(acc, x, weight, bias, scales.data, scales.group, k, j, len);
+        if (swiglu) {
+            dot_run<M>(up, x, weight + n * k, bias != nullptr ? bias + n : nullptr, up_scales, scales.group, k, j, len);
+        }
+        for (size_t i = 0; i < M; i++) {
+            size_t at = i * ldo + (j - n0);
+            llaisys::ops::cpu::store_row(out + at, acc + i * RUN, swiglu ? up + i * RUN : nullptr, residual != nullptr ? residual + at : nullptr, len);
+        }
+    }
+}
+
+template <size_t M, typename W, typename T>
+void gemv_m(T *out, const float *x, const W *weight, const T *bias, const WeightScales &scales, size_t k, size_t n, const T *residual, bool swiglu) {
+    // Small chunks would spend more time on dispatch than on streaming rows.
+    llaisys::core::parallel_for(n, 64, [&](size_t begin, size_t end) {
+        gemv_rows<M>(out + begin, n, x, weight, bias, scales, k, begin, end, residual != nullptr ? residual + begin : nullptr, swiglu, n);
+    });
+}
+
+template <typename W, typename T>
+void gemv_block_(T *out, size_t ldo, const float *x, const W *weight, const T *bias, const WeightScales &scales, size_t m, size_t k, size_t n0,
+                 size_t n1) {
+    // No epilogue: callers consume the plain outputs.
+    const T *none = nullptr;
+    switch (m) {
+    case 1:
+        return gemv_rows<1>(out, ldo, x, weight, bias, scales, k, n0, n1, none, false, 0);
+    case 2:
+        return gemv_rows<2>(out, ldo, x, weight, bias, scales, k, n0, n1, none, false, 0);
+    case 3:
+        return gemv_rows<3>(out, ldo, x, weight, bias, scales, k, n0, n1, none, false, 0);
+    case 4:
+        return gemv_rows<4>(out, ldo, x, weight, bias, scales, k, n0, n1, none, false, 0);
+    case 5:
+        return gemv_rows<5>(out, ldo, x, weight, bias, scales, k, n0, n1, none, false, 0);
+    case 6:
+        return gemv_rows<6>(out, ldo, x, weight, bias, scales, k, n0, n1, none, false, 0);
+    case 7:
+        return gemv_rows<7>(out, ldo, x, weight, bias, scales, k, n0, n1, none, false, 0);
+    case 8:
+        return gemv_rows<8>(out, ldo, x, weight, bias, scales, k, n0, n1, none, false, 0);
+    default:
+        ASSERT(m <= llaisys::ops::cpu::GEMV_MAX_M, "GEMV: too many input rows.");
+    }
+}
+
+template <typename W, typename T>
+void gemv_(T *out, const T *in, const W *weight, const T *bias, const WeightScales &scales, size_t m, size_t k, size_t n, const T *residual,
+           bool swiglu) {
+    thread_local std::vector<float> x;
+    x.resize(m * k);
+    llaisys::utils::cast(x.data(), in, m * k);
+
+    switch (m) {
+    case 1:
+        return gemv_m<1>(out, x.data(), weight, bias, scales, k, n, residual, swiglu);
+    case 2:
+        return gemv_m<2>(out, x.data(), weight, bias, scales, k, n, residual, swiglu);
+    case 3:
+        return gemv_m<3>(out, x.data(), weight, bias, scales, k, n, residual, swiglu);
+    case 4:
+        return gemv_m<4>(out, x.data(), weight, bias, scales, k, n, residual, swiglu);
+    case 5:
+        return gemv_m<5>(out, x.data(), weight, bias, scales, k, n, residual, swiglu);
+    case 6:
+        return gemv_m<6>(out, x.data(), weight, bias, scales, k, n, residual, swiglu);
+    case 7:
+        return gemv_m<7>(out, x.data(), weight, bias, scales, k, n, residual, swiglu);
+    case 8:
+        return gemv_m<8>(out, x.data(), weight, bias, scales, k, n, residual, swiglu);
+    default:
+        ASSERT(m <= llaisys::ops::cpu::GEMV_MAX_M, "GEMV: too many input rows.");
+    }
+}
+
+// The weight is int8 when it has scales, and of the activation dtype T
+// otherwise.
+template <typename T>
+void gemv_t(std::byte *out, const std::byte *in, const std::byte *weight, const std::byte *bias, const WeightScales &scales, size_t m, size_t k,
+            size_t n, const Epilogue &epilogue) {
+    if (scales.data != nullptr) {
+        return gemv_(reinterpret_cast<T *>(out), reinterpret_cast<const T *>(in), reinterpret_cast<const int8_t *>(weight),
+                     reinterpret_cast<const T *>(bias), scales, m, k, n, reinterpret_cast<const T *>(epilogue.residual), epilogue.swiglu);
+    }
+    gemv_(reinterpret_cast<T *>(out), reinterpret_cast<const T *>(in), reinterpret_cast<const T *>(weight), reinterpret_cast<const T *>(bias),
+          scales, m, k, n, reinterpret_cast<const T *>(epilogue.residual), epilogue.swiglu);
+}
+
+template <typename T>
+void gemv_block_t(std::byte *out, size_t ldo, const float *x, const std::byte *weight, const std::byte *bias, const WeightScales &scales, size_t m,
+                  size_t k, size_t n0, size_t n1) {
+    if (scales.data != nullptr) {
+        return gemv_block_(reinterpret_cast<T *>(out), ldo, x, reinterpret_cast<const int8_t *>(weight), reinterpret_cast<const T *>(bias), scales,
+                           m, k, n0, n1);
+    }
+    gemv_block_(reinterpret_cast<T *>(out), ldo, x, reinterpret_cast<const T *>(weight), reinterpret_cast<const T *>(bias), scales, m, k, n0, n1);
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void gemv(std::byte *out, const std::byte *in, const std::byte *weight, const std::byte *bias, size_t m, size_t k, size_t n, llaisysDataType_t type,
+          const Epilogue &epilogue, const WeightScales &scales) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return gemv_t<float>(out, in, weight, bias, scales, m, k, n, epilogue);
+    case LLAISYS_DTYPE_BF16:
+        return gemv_t<llaisys::bf16_t>(out, in, weight, bias, scales, m, k, n, epilogue);
+    case LLAISYS_DTYPE_F16:
+        return gemv_t<llaisys::fp16_t>(out, in, weight, bias, scales, m, k, n, epilogue);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+
+void gemv_block(std::byte *out, size_t ldo, const float *x, const std::byte *weight, const std::byte *bias, size_t m, size_t k, size_t n0, size_t n1,
+                llaisysDataType_t type, const WeightScales &scales) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return gemv_block_t<float>(out, ldo, x, weight, bias, scales, m, k, n0, n1);
+    case LLAISYS_DTYPE_BF16:
+        return gemv_block_t<llaisys::bf16_t>(out, ldo, x, weight, bias, scales, m, k, n0, n1);
+    case LLAISYS_DTYPE_F16:
+        return gemv_block_t<llaisys::fp16_t>(out, ldo, x, weight, bias, scales, m, k, n0, n1);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
\ No newline at end of file
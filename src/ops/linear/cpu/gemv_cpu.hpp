@@ -0,0 +1,24 @@
+#pragma once
+#include "llaisys.h"
+
+#include "epilogue.hpp"
+#include "weight_scales.hpp"
+
+#include <cstddef>
+
+namespace llaisys::ops::cpu {
+// Largest number of input rows handled by the GEMV path; bigger batches go
+// through the packed GEMM.
+constexpr size_t GEMV_MAX_M = 8;
+
+// Same contract as gemm() for m <= GEMV_MAX_M. Weight rows are streamed once
+// straight from memory without packing, with output rows split across threads.
+void gemv(std::byte *out, const std::byte *in, const std::byte *weight, const std::byte *bias, size_t m, size_t k, size_t n, llaisysDataType_t type,
+          const Epilogue &epilogue = {}, const WeightScales &scales = {});
+
+// Output columns [n0, n1) of gemv() on the calling thread, for kernels that
+// consume the result block by block instead of storing all of it. The input
+// is already widened to f32; column j of row i goes to out[i * ldo + j - n0].
+void gemv_block(std::byte *out, size_t ldo, const float *x, const std::byte *weight, const std::byte *bias, size_t m, size_t k, size_t n0, size_t n1,
+                llaisysDataType_t type, const WeightScales &scales = {});
+} // namespace llaisys::ops::cpu
@@ -1,8 +1,12 @@
 #pragma once
 #include "llaisys.h"
 
+#include "epilogue.hpp"
+#include "weight_scales.hpp"
+
 #include <cstddef>
 
 namespace llaisys::ops::cpu {
-void linear(std::byte *out, std::byte *in, std::byte *weight, std::byte *bias, size_t height_in, size_t width_in, size_t height_weight, llaisysDataType_t type);
+void linear(std::byte *out, std::byte *in, std::byte *weight, std::byte *bias, size_t height_in, size_t width_in, size_t height_weight, llaisysDataType_t type,
+            const Epilogue &epilogue = {}, const WeightScales &scales = {});
 }
\ No newline at end of file
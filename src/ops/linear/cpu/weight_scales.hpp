@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+namespace llaisys::ops::cpu {
+// Dequantization of an int8 weight [n, k]: element (j, p) stands for
+// weight[j][p] * data[j * (k / group) + p / group]. group is k for one scale
+// per output channel, and otherwise a multiple of GROUP_ALIGN, so that no
+// SIMD vector straddles two groups. data is nullptr when the weight has the
+// activation dtype.
+struct WeightScales {
+    const float *data = nullptr;
+    size_t group = 0;
+};
+
+constexpr size_t GROUP_ALIGN = 32;
+} // namespace llaisys::ops::cpu
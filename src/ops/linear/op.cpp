@@ -6,27 +6,30 @@
 #include "cpu/linear_cpu.hpp"
 
 namespace llaisys::ops {
-void linear(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias) {
+namespace {
+cpu::WeightScales check(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias, tensor_t scales, size_t n) {
+    CHECK_SAME_DEVICE(out, in, weight);
+    CHECK_SAME_DTYPE(out->dtype(), in->dtype());
+    ASSERT(out->isContiguous() && in->isContiguous() && weight->isContiguous(), "Linear: all tensors must be contiguous.");
+    ASSERT(out->ndim() == 2 && in->ndim() == 2 && weight->ndim() == 2, "Linear: out, in and weight must be 2-D.");
+    CHECK_ARGUMENT(in->shape()[1] == weight->shape()[1], "Linear: in and weight widths differ.");
+    CHECK_ARGUMENT(out->shape()[0] == in->shape()[0] && out->shape()[1] == n, "Linear: out has the wrong shape.");
     if (bias != nullptr) {
-        CHECK_SAME_DEVICE(out, in, weight, bias);
-        CHECK_SAME_DTYPE(out->dtype(), in->dtype(), weight->dtype(), bias->dtype());
-        ASSERT(out->isContiguous() && in->isContiguous() &&  weight->isContiguous() && bias->isContiguous(), "Linear: all tensors must be contiguous.");
-    } else {
-        CHECK_SAME_DEVICE(out, in, weight);
-        CHECK_SAME_DTYPE(out->dtype(), in->dtype(), weight->dtype());
-        ASSERT(out->isContiguous() && in->isContiguous() &&  weight->isContiguous(), "Linear: all tensors must be contiguous.");
+        CHECK_SAME_DEVICE(out, bias);
+        CHECK_SAME_DTYPE(out->dtype(), bias->dtype());
+        ASSERT(bias->isContiguous(), "Linear: all tensors must be contiguous.");
+        CHECK_ARGUMENT(bias->numel() == weight->shape()[0], "Linear: bias does not match weight.");
     }
+    return weight_scales(weight, scales, out->dtype());
+}
 
+void run(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias, size_t n, const cpu::Epilogue &epilogue, const cpu::WeightScales &scales) {
     llaisys::core::context().setDevice(weight->deviceType(), weight->deviceId());
 
-    switch (weight->deviceType())
-    {
+    switch (weight->deviceType()) {
     case LLAISYS_DEVICE_CPU:
-        if (bias != nullptr) {
-            return cpu::linear(out->data(), in->data(), weight->data(), bias->data(), in->shape()[0], in->shape()[1], weight->shape()[0], weight->dtype());
-        } else {
-            return cpu::linear(out->data(), in->data(), weight->data(), nullptr, in->shape()[0], in->shape()[1], weight->shape()[0], weight->dtype());
-        }
+        return cpu::linear(out->data(), in->data(), weight->data(), bias != nullptr ? bias->data() : nullptr, in->shape()[0], in->shape()[1], n,
+                           out->dtype(), epilogue, scales);
 #ifdef ENABLE_NVIDIA_API
     case LLAISYS_DEVICE_NVIDIA:
         TO_BE_IMPLEMENTED();
@@ -36,4 +39,44 @@ void linear(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias) {
         EXCEPTION_UNSUPPORTED_DEVICE;
     }
 }
+} // namespace
+
+void linear(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias, tensor_t residual, tensor_t scales) {
+    cpu::WeightScales weight_scale = check(out, in, weight, bias, scales, weight->shape()[0]);
+    cpu::Epilogue epilogue;
+    if (residual != nullptr) {
+        CHECK_SAME_DEVICE(out, residual);
+        CHECK_SAME_DTYPE(out->dtype(), residual->dtype());
+        ASSERT(residual->isContiguous(), "Linear: all tensors must be contiguous.");
+        CHECK_SAME_SHAPE(out->shape(), residual->shape());
+        epilogue.residual = residual->data();
+    }
+    run(out, in, weight, bias, weight->shape()[0], epilogue, weight_scale);
+}
+
+void linear_swiglu(tensor_t out, tensor_t in, tensor_t gate_up_weight, tensor_t gate_up_bias, tensor_t gate_up_scales) {
+    CHECK_ARGUMENT(gate_up_weight->ndim() == 2 && gate_up_weight->shape()[0] % 2 == 0, "LinearSwiGLU: gate_up_weight must have an even number of rows.");
+    size_t n = gate_up_weight->shape()[0] / 2;
+    cpu::WeightScales weight_scale = check(out, in, gate_up_weight, gate_up_bias, gate_up_scales, n);
+    cpu::Epilogue epilogue;
+    epilogue.swiglu = true;
+    run(out, in, gate_up_weight, gate_up_bias, n, epilogue, weight_scale);
+}
+
+cpu::WeightScales weight_scales(tensor_t weight, tensor_t scales, llaisysDataType_t type) {
+    if (weight->dtype() != LLAISYS_DTYPE_I8) {
+        CHECK_SAME_DTYPE(type, weight->dtype());
+        ASSERT(scales == nullptr, "Linear: only int8 weights have scales.");
+        return {};
+    }
+    ASSERT(scales != nullptr, "Linear: int8 weights need scales.");
+    CHECK_SAME_DEVICE(weight, scales);
+    ASSERT(scales->dtype() == LLAISYS_DTYPE_F32 && scales->isContiguous() && scales->ndim() == 2, "Linear: scales must be a contiguous 2-D f32 tensor.");
+    ASSERT(weight->ndim() == 2, "Linear: weight must be 2-D.");
+    size_t k = weight->shape()[1], groups = scales->shape()[1];
+    CHECK_ARGUMENT(scales->shape()[0] == weight->shape()[0] && groups > 0 && groups <= k && k % groups == 0, "Linear: scales do not match weight.");
+    size_t group = k / groups;
+    CHECK_ARGUMENT(groups == 1 || group % cpu::GROUP_ALIGN == 0, "Linear: quantization groups must be a multiple of 32 columns.");
+    return {reinterpret_cast<const float *>(scales->data()), group};
+}
 } // namespace llaisys::ops
@@ -2,6 +2,22 @@
 
 #include "../../tensor/tensor.hpp"
 
+#include "cpu/weight_scales.hpp"
+
 namespace llaisys::ops {
-void linear(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias);
+// out = in * weight^T + bias (+ residual). bias and residual may be nullptr;
+// residual is laid out like out and may be out itself. weight may also be an
+// int8 matrix with scales, see weight_scales().
+void linear(tensor_t out, tensor_t in, tensor_t weight, tensor_t bias, tensor_t residual = nullptr, tensor_t scales = nullptr);
+// out = swiglu(in * gate^T, in * up^T), where gate_up_weight [2 * n, k] holds
+// the n gate rows followed by the n up rows, and gate_up_bias and
+// gate_up_scales, if any, are laid out the same way. Both halves come from
+// one pass over the input.
+void linear_swiglu(tensor_t out, tensor_t in, tensor_t gate_up_weight, tensor_t gate_up_bias = nullptr, tensor_t gate_up_scales = nullptr);
+
+// Checks a weight [n, k] against the activation dtype and returns how the
+// kernels dequantize it. A weight of the activation dtype has no scales; an
+// int8 weight has f32 scales [n, groups], one per output channel and group of
+// k / groups columns, which is k itself or a multiple of 32 (see ops::quantize).
+cpu::WeightScales weight_scales(tensor_t weight, tensor_t scales, llaisysDataType_t type);
 }
@@ -0,0 +1,185 @@
+#include "lm_head_topk_cpu.hpp"
+
+#include "../../linear/cpu/gemm_cpu.hpp"
+#include "../../linear/cpu/gemv_cpu.hpp"
+#include "../../rms_norm/cpu/rsm_norm_cpu.hpp"
+
+#include "../../../core/thread_pool/thread_pool.hpp"
+#include "../../../utils.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace {
+using llaisys::ops::cpu::GEMV_MAX_M;
+using llaisys::ops::cpu::WeightScales;
+
+// Vocabulary rows scored per gemv block; the block's logits stay in L1.
+constexpr size_t BLOCK = 64;
+// Vocabulary rows per GEMM call when there are too many rows for the GEMV path.
+constexpr size_t GEMM_CHUNK = 4096;
+
+struct Hit {
+    float val;
+    int64_t idx;
+};
+
+// Ranks a before b: higher logit first, lower token id among equals.
+bool better(const Hit &a, const Hit &b) {
+    return a.val > b.val || (a.val == b.val && a.idx < b.idx);
+}
+
+// The k best hits seen so far, as a heap whose front is the worst of them.
+// Instances are kept as thread_local scratch: reset() reuses the heap's
+// storage, so a warm TopK does not allocate.
+class TopK {
+public:
+    void reset(size_t k) {
+        _k = k;
+        _hits.clear();
+        _hits.reserve(k);
+    }
+
+    void push(float val, int64_t idx) {
+        if (_hits.size() < _k) {
+            _hits.push_back(Hit{val, idx});
+            std::push_heap(_hits.begin(), _hits.end(), better);
+        } else if (val >= _hits.front().val && better(Hit{val, idx}, _hits.front())) {
+            std::pop_heap(_hits.begin(), _hits.end(), better);
+            _hits.back() = Hit{val, idx};
+            std::push_heap(_hits.begin(), _hits.end(), better);
+        }
+    }
+
+    void merge(const TopK &other) {
+        for (const Hit &hit : other._hits) {
+            push(hit.val, hit.idx);
+        }
+    }
+
+    // Best first.
+    const std::vector<Hit> &sorted() {
+        std::sort_heap(_hits.begin(), _hits.end(), better);
+        return _hits;
+    }
+
+private:
+    size_t _k = 0;
+    std::vector<Hit> _hits;
+};
+
+// Logits are rounded to T before they are compared, so the result matches
+// rms_norm + linear + argmax on the same inputs.
+template <typename T>
+void push_block(TopK *best, const T *logits, size_t ldo, size_t m, size_t j0, size_t j1) {
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = j0; j < j1; j++) {
+            best[i].push(llaisys::utils::cast<float>(logits[i * ldo + j - j0]), static_cast<int64_t>(j));
+        }
+    }
+}
+
+// Up to GEMV_MAX_M rows: one parallel sweep over the vocabulary, every task
+// keeping its own top-k per row and merging it at the end.
+template <typename T>
+void topk_gemv(std::vector<TopK> &best, const T *normed, const std::byte *embed, const WeightScales &scales, llaisysDataType_t type, size_t m,
+               size_t hs, size_t voc, size_t k) {
+    thread_local std::vector<float> x;
+    x.resize(m * hs);
+    llaisys::utils::cast(x.data(), normed, m * hs);
+    // Workers see their own thread_local, so pass the caller's by pointer.
+    const float *xs = x.data();
+
+    std::mutex mutex;
+    llaisys::core::parallel_for(voc, BLOCK, [&](size_t begin, size_t end) {
+        thread_local TopK local[GEMV_MAX_M];
+        for (size_t i = 0; i < m; i++) {
+            local[i].reset(k);
+        }
+        T logits[GEMV_MAX_M * BLOCK];
+        for (size_t j0 = begin; j0 < end; j0 += BLOCK) {
+            size_t j1 = std::min(end, j0 + BLOCK);
+            llaisys::ops::cpu::gemv_block(reinterpret_cast<std::byte *>(logits), BLOCK, xs, embed, nullptr, m, hs, j0, j1, type, scales);
+            push_block(local, logits, BLOCK, m, j0, j1);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < m; i++) {
+            best[i].merge(local[i]);
+        }
+    });
+}
+
+// More rows: the packed GEMM scores one vocabulary chunk at a time, and the
+// rows of a chunk are reduced in parallel.
+template <typename T>
+void topk_gemm(std::vector<TopK> &best, const T *normed, const std::byte *embed, const WeightScales &scales, llaisysDataType_t type, size_t m,
+               size_t hs, size_t voc) {
+    size_t row_bytes = hs * (scales.data != nullptr ? sizeof(int8_t) : sizeof(T));
+    thread_local std::vector<T> chunk;
+    chunk.resize(m * GEMM_CHUNK);
+    T *logits = chunk.data();
+    for (size_t j0 = 0; j0 < voc; j0 += GEMM_CHUNK) {
+        size_t n = std::min(GEMM_CHUNK, voc - j0);
+        WeightScales chunk_scales = scales;
+        if (scales.data != nullptr) {
+            chunk_scales.data += j0 * (hs / scales.group);
+        }
+        llaisys::ops::cpu::gemm(reinterpret_cast<std::byte *>(logits), reinterpret_cast<const std::byte *>(normed), embed + j0 * row_bytes, nullptr,
+                                m, hs, n, type, {}, chunk_scales);
+        llaisys::core::parallel_for(m, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                push_block(&best[i], logits + i * n, n, 1, j0, j0 + n);
+            }
+        });
+    }
+}
+
+template <typename T>
+void lm_head_topk_(int64_t *top_idx, T *top_val, const T *hidden, const T *norm_w, const std::byte *embed, const WeightScales &scales,
+                   llaisysDataType_t type, float eps, size_t m, size_t hs, size_t voc, size_t k) {
+    thread_local std::vector<T> normed;
+    normed.resize(m * hs);
+    llaisys::ops::cpu::rsm_norm(reinterpret_cast<std::byte *>(normed.data()), reinterpret_cast<const std::byte *>(hidden),
+                                reinterpret_cast<const std::byte *>(norm_w), eps, type, m, hs);
+
+    // Workers reach the caller's copy through the reference passed below.
+    thread_local std::vector<TopK> best;
+    best.resize(m);
+    for (TopK &row : best) {
+        row.reset(k);
+    }
+    if (m <= GEMV_MAX_M) {
+        topk_gemv(best, normed.data(), embed, scales, type, m, hs, voc, k);
+    } else {
+        topk_gemm(best, normed.data(), embed, scales, type, m, hs, voc);
+    }
+
+    for (size_t i = 0; i < m; i++) {
+        const std::vector<Hit> &hits = best[i].sorted();
+        for (size_t r = 0; r < k; r++) {
+            top_idx[i * k + r] = hits[r].idx;
+            top_val[i * k + r] = llaisys::utils::cast<T>(hits[r].val);
+        }
+    }
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void lm_head_topk(int64_t *top_idx, std::byte *top_val, const std::byte *hidden, const std::byte *norm_w, const std::byte *out_embed,
+                  llaisysDataType_t type, float eps, size_t m, size_t hs, size_t voc, size_t k, const WeightScales &scales) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return lm_head_topk_(top_idx, reinterpret_cast<float *>(top_val), reinterpret_cast<const float *>(hidden),
+                             reinterpret_cast<const float *>(norm_w), out_embed, scales, type, eps, m, hs, voc, k);
+    case LLAISYS_DTYPE_BF16:
+        return lm_head_topk_(top_idx, reinterpret_cast<llaisys::bf16_t *>(top_val), reinterpret_cast<const llaisys::bf16_t *>(hidden),
+                             reinterpret_cast<const llaisys::bf16_t *>(norm_w), out_embed, scales, type, eps, m, hs, voc, k);
+    case LLAISYS_DTYPE_F16:
+        return lm_head_topk_(top_idx, reinterpret_cast<llaisys::fp16_t *>(top_val), reinterpret_cast<const llaisys::fp16_t *>(hidden),
+                             reinterpret_cast<const llaisys::fp16_t *>(norm_w), out_embed, scales, type, eps, m, hs, voc, k);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
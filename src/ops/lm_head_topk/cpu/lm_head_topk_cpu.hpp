@@ -0,0 +1,12 @@
+#pragma once
+#include "llaisys.h"
+
+#include "../../linear/cpu/weight_scales.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace llaisys::ops::cpu {
+void lm_head_topk(int64_t *top_idx, std::byte *top_val, const std::byte *hidden, const std::byte *norm_w, const std::byte *out_embed,
+                  llaisysDataType_t type, float eps, size_t m, size_t hs, size_t voc, size_t k, const WeightScales &scales = {});
+}
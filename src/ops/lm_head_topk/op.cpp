@@ -0,0 +1,42 @@
+#include "op.hpp"
+
+#include "../../core/llaisys_core.hpp"
+#include "../../utils.hpp"
+
+#include "../linear/op.hpp"
+#include "cpu/lm_head_topk_cpu.hpp"
+
+namespace llaisys::ops {
+void lm_head_topk(tensor_t top_idx, tensor_t top_val, tensor_t hidden, tensor_t norm_w, tensor_t out_embed, float eps,
+                  tensor_t out_embed_scales) {
+    CHECK_SAME_DEVICE(top_idx, top_val, hidden, norm_w, out_embed);
+    CHECK_SAME_DTYPE(top_val->dtype(), hidden->dtype(), norm_w->dtype());
+    ASSERT(top_idx->dtype() == LLAISYS_DTYPE_I64, "LM Head Top-k: top_idx must be int64.");
+    ASSERT(top_idx->isContiguous() && top_val->isContiguous() && hidden->isContiguous() && norm_w->isContiguous() && out_embed->isContiguous(),
+           "LM Head Top-k: all tensors must be contiguous.");
+    ASSERT(hidden->ndim() == 2 && norm_w->ndim() == 1 && out_embed->ndim() == 2 && top_idx->ndim() == 2,
+           "LM Head Top-k: expected hidden [m, hs], norm_w [hs], out_embed [voc, hs] and top_idx/top_val [m, k].");
+
+    size_t m = hidden->shape()[0], hs = hidden->shape()[1];
+    size_t voc = out_embed->shape()[0], k = top_idx->shape()[1];
+    CHECK_ARGUMENT(norm_w->shape()[0] == hs && out_embed->shape()[1] == hs, "LM Head Top-k: hidden size mismatch.");
+    CHECK_SAME_SHAPE(top_idx->shape(), top_val->shape());
+    CHECK_ARGUMENT(top_idx->shape()[0] == m && k > 0 && k <= voc, "LM Head Top-k: need one output row per hidden row and 0 < k <= voc.");
+    cpu::WeightScales scales = weight_scales(out_embed, out_embed_scales, hidden->dtype());
+
+    llaisys::core::context().setDevice(hidden->deviceType(), hidden->deviceId());
+
+    switch (hidden->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        return cpu::lm_head_topk(reinterpret_cast<int64_t *>(top_idx->data()), top_val->data(), hidden->data(), norm_w->data(), out_embed->data(),
+                                 hidden->dtype(), eps, m, hs, voc, k, scales);
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+} // namespace llaisys::ops
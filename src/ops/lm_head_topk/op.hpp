@@ -0,0 +1,14 @@
+#pragma once
+
+#include "../../tensor/tensor.hpp"
+
+namespace llaisys::ops {
+// Final RMSNorm, LM head and top-k in one pass. For every row of hidden
+// [m, hs], the k largest logits of rms_norm(hidden, norm_w) * out_embed^T go
+// to top_val [m, k] and their token ids to top_idx [m, k], best first and the
+// lower id first among equal logits. The [m, voc] logits are never stored:
+// vocabulary blocks are scored and reduced while still in cache. An int8
+// out_embed comes with out_embed_scales, as for ops::linear.
+void lm_head_topk(tensor_t top_idx, tensor_t top_val, tensor_t hidden, tensor_t norm_w, tensor_t out_embed, float eps,
+                  tensor_t out_embed_scales = nullptr);
+}
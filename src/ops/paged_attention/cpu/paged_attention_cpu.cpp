@@ -0,0 +1,62 @@
+#include "paged_attention_cpu.hpp"
+
+#include "../../self_attention/cpu/flash_attention.hpp"
+
+namespace {
+template <typename T>
+void paged_attention_(T *attn_val, const T *q, const T *k_cache, const T *v_cache, const int64_t *block_table, float scale,
+                      size_t seqlen, size_t nhead, size_t d, size_t total_len, size_t nkvhead, size_t dv, size_t block_size) {
+    llaisys::ops::cpu::flash::PagedKV<T> kv{k_cache, v_cache, block_table, block_size, nkvhead, d, dv};
+    llaisys::ops::cpu::flash::attention(attn_val, q, kv, scale, seqlen, nhead, d, total_len, nkvhead, dv);
+}
+
+template <typename T>
+void paged_varlen_attention_(T *attn_val, const T *q, const T *k_cache, const T *v_cache, const int64_t *block_tables, const int64_t *cu_seqlens_q,
+                             const int64_t *kv_lens, float scale, size_t nseq, size_t max_blocks, size_t nhead, size_t d, size_t nkvhead, size_t dv,
+                             size_t block_size) {
+    llaisys::ops::cpu::flash::PagedBatch<T> batch{k_cache, v_cache, block_tables, kv_lens, max_blocks, block_size, nkvhead, d, dv};
+    llaisys::ops::cpu::flash::varlen_attention(attn_val, q, batch, cu_seqlens_q, nseq, scale, nhead, d, nkvhead, dv);
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void paged_attention(std::byte *attn_val, const std::byte *q, const std::byte *k_cache, const std::byte *v_cache, const int64_t *block_table,
+                     llaisysDataType_t type, float scale, size_t seqlen, size_t nhead, size_t d, size_t total_len, size_t nkvhead, size_t dv, size_t block_size) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return paged_attention_(reinterpret_cast<float *>(attn_val), reinterpret_cast<const float *>(q), reinterpret_cast<const float *>(k_cache),
+                                reinterpret_cast<const float *>(v_cache), block_table, scale, seqlen, nhead, d, total_len, nkvhead, dv, block_size);
+    case LLAISYS_DTYPE_BF16:
+        return paged_attention_(reinterpret_cast<llaisys::bf16_t *>(attn_val), reinterpret_cast<const llaisys::bf16_t *>(q),
+                                reinterpret_cast<const llaisys::bf16_t *>(k_cache), reinterpret_cast<const llaisys::bf16_t *>(v_cache), block_table,
+                                scale, seqlen, nhead, d, total_len, nkvhead, dv, block_size);
+    case LLAISYS_DTYPE_F16:
+        return paged_attention_(reinterpret_cast<llaisys::fp16_t *>(attn_val), reinterpret_cast<const llaisys::fp16_t *>(q),
+                                reinterpret_cast<const llaisys::fp16_t *>(k_cache), reinterpret_cast<const llaisys::fp16_t *>(v_cache), block_table,
+                                scale, seqlen, nhead, d, total_len, nkvhead, dv, block_size);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+
+void paged_varlen_attention(std::byte *attn_val, const std::byte *q, const std::byte *k_cache, const std::byte *v_cache, const int64_t *block_tables,
+                            const int64_t *cu_seqlens_q, const int64_t *kv_lens, llaisysDataType_t type, float scale, size_t nseq, size_t max_blocks,
+                            size_t nhead, size_t d, size_t nkvhead, size_t dv, size_t block_size) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return paged_varlen_attention_(reinterpret_cast<float *>(attn_val), reinterpret_cast<const float *>(q), reinterpret_cast<const float *>(k_cache),
+                                       reinterpret_cast<const float *>(v_cache), block_tables, cu_seqlens_q, kv_lens, scale, nseq, max_blocks, nhead, d,
+                                       nkvhead, dv, block_size);
+    case LLAISYS_DTYPE_BF16:
+        return paged_varlen_attention_(reinterpret_cast<llaisys::bf16_t *>(attn_val), reinterpret_cast<const llaisys::bf16_t *>(q),
+                                       reinterpret_cast<const llaisys::bf16_t *>(k_cache), reinterpret_cast<const llaisys::bf16_t *>(v_cache),
+                                       block_tables, cu_seqlens_q, kv_lens, scale, nseq, max_blocks, nhead, d, nkvhead, dv, block_size);
+    case LLAISYS_DTYPE_F16:
+        return paged_varlen_attention_(reinterpret_cast<llaisys::fp16_t *>(attn_val), reinterpret_cast<const llaisys::fp16_t *>(q),
+                                       reinterpret_cast<const llaisys::fp16_t *>(k_cache), reinterpret_cast<const llaisys::fp16_t *>(v_cache),
+                                       block_tables, cu_seqlens_q, kv_lens, scale, nseq, max_blocks, nhead, d, nkvhead, dv, block_size);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
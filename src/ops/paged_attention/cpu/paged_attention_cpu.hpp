@@ -0,0 +1,13 @@
+#pragma once
+#include "llaisys.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace llaisys::ops::cpu {
+void paged_attention(std::byte *attn_val, const std::byte *q, const std::byte *k_cache, const std::byte *v_cache, const int64_t *block_table,
+                     llaisysDataType_t type, float scale, size_t seqlen, size_t nhead, size_t d, size_t total_len, size_t nkvhead, size_t dv, size_t block_size);
+void paged_varlen_attention(std::byte *attn_val, const std::byte *q, const std::byte *k_cache, const std::byte *v_cache, const int64_t *block_tables,
+                            const int64_t *cu_seqlens_q, const int64_t *kv_lens, llaisysDataType_t type, float scale, size_t nseq, size_t max_blocks,
+                            size_t nhead, size_t d, size_t nkvhead, size_t dv, size_t block_size);
+}
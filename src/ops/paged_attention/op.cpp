@@ -0,0 +1,105 @@
+#include "op.hpp"
+
+#include "../../core/llaisys_core.hpp"
+#include "../../utils.hpp"
+
+#include "cpu/paged_attention_cpu.hpp"
+
+namespace {
+// The blocks holding the first kv_len tokens of a sequence must be in the cache.
+void check_blocks(const int64_t *block_table, size_t kv_len, size_t block_size, size_t nblocks) {
+    for (size_t b = 0; b < (kv_len + block_size - 1) / block_size; b++) {
+        CHECK_ARGUMENT(block_table[b] >= 0 && static_cast<size_t>(block_table[b]) < nblocks, "Paged Attention: block id out of range.");
+    }
+}
+} // namespace
+
+namespace llaisys::ops {
+void paged_attention(tensor_t attn_val, tensor_t q, tensor_t k_cache, tensor_t v_cache, tensor_t block_table, size_t total_len, float scale) {
+    CHECK_SAME_DEVICE(attn_val, q, k_cache, v_cache, block_table);
+    CHECK_SAME_DTYPE(attn_val->dtype(), q->dtype(), k_cache->dtype(), v_cache->dtype());
+    ASSERT(block_table->dtype() == LLAISYS_DTYPE_I64, "Paged Attention: block table must be int64.");
+    ASSERT(attn_val->isContiguous() && q->isContiguous() && k_cache->isContiguous() && v_cache->isContiguous() && block_table->isContiguous(),
+           "Paged Attention: all tensors must be contiguous.");
+    ASSERT(q->ndim() == 3 && attn_val->ndim() == 3 && k_cache->ndim() == 4 && v_cache->ndim() == 4 && block_table->ndim() == 1,
+           "Paged Attention: expected q [seqlen, nhead, d] and caches [nblocks, block_size, nkvhead, d].");
+
+    size_t seqlen = q->shape()[0], nhead = q->shape()[1], d = q->shape()[2];
+    size_t block_size = k_cache->shape()[1], nkvhead = k_cache->shape()[2], dv = v_cache->shape()[3];
+    CHECK_ARGUMENT(k_cache->shape()[3] == d && v_cache->shape()[0] == k_cache->shape()[0] && v_cache->shape()[1] == block_size
+                       && v_cache->shape()[2] == nkvhead && nhead % nkvhead == 0,
+                   "Paged Attention: cache shapes do not match q.");
+    CHECK_ARGUMENT(attn_val->shape()[0] == seqlen && attn_val->shape()[1] == nhead && attn_val->shape()[2] == dv,
+                   "Paged Attention: output shape does not match q and v.");
+    CHECK_ARGUMENT(total_len >= seqlen && block_table->shape()[0] * block_size >= total_len,
+                   "Paged Attention: block table does not cover the sequence.");
+
+    llaisys::core::context().setDevice(q->deviceType(), q->deviceId());
+
+    switch (q->deviceType()) {
+    case LLAISYS_DEVICE_CPU: {
+        auto table = reinterpret_cast<const int64_t *>(block_table->data());
+        check_blocks(table, total_len, block_size, k_cache->shape()[0]);
+        return cpu::paged_attention(attn_val->data(), q->data(), k_cache->data(), v_cache->data(), table, q->dtype(), scale, seqlen, nhead, d,
+                                    total_len, nkvhead, dv, block_size);
+    }
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+
+void paged_varlen_attention(tensor_t attn_val, tensor_t q, tensor_t k_cache, tensor_t v_cache, tensor_t block_tables, tensor_t cu_seqlens_q,
+                            tensor_t kv_lens, float scale) {
+    CHECK_SAME_DEVICE(attn_val, q, k_cache, v_cache, block_tables, cu_seqlens_q, kv_lens);
+    CHECK_SAME_DTYPE(attn_val->dtype(), q->dtype(), k_cache->dtype(), v_cache->dtype());
+    ASSERT(block_tables->dtype() == LLAISYS_DTYPE_I64 && cu_seqlens_q->dtype() == LLAISYS_DTYPE_I64 && kv_lens->dtype() == LLAISYS_DTYPE_I64,
+           "Paged Attention: block tables and lengths must be int64.");
+    ASSERT(attn_val->isContiguous() && q->isContiguous() && k_cache->isContiguous() && v_cache->isContiguous() && block_tables->isContiguous()
+               && cu_seqlens_q->isContiguous() && kv_lens->isContiguous(),
+           "Paged Attention: all tensors must be contiguous.");
+    ASSERT(q->ndim() == 3 && attn_val->ndim() == 3 && k_cache->ndim() == 4 && v_cache->ndim() == 4 && block_tables->ndim() == 2
+               && cu_seqlens_q->ndim() == 1 && kv_lens->ndim() == 1,
+           "Paged Attention: expected q [total_q, nhead, d], caches [nblocks, block_size, nkvhead, d] and block tables [nseq, max_blocks].");
+
+    size_t total_q = q->shape()[0], nhead = q->shape()[1], d = q->shape()[2];
+    size_t block_size = k_cache->shape()[1], nkvhead = k_cache->shape()[2], dv = v_cache->shape()[3];
+    size_t nseq = kv_lens->numel(), max_blocks = block_tables->shape()[1];
+    CHECK_ARGUMENT(k_cache->shape()[3] == d && v_cache->shape()[0] == k_cache->shape()[0] && v_cache->shape()[1] == block_size
+                       && v_cache->shape()[2] == nkvhead && nhead % nkvhead == 0,
+                   "Paged Attention: cache shapes do not match q.");
+    CHECK_ARGUMENT(attn_val->shape()[0] == total_q && attn_val->shape()[1] == nhead && attn_val->shape()[2] == dv,
+                   "Paged Attention: output shape does not match q and v.");
+    CHECK_ARGUMENT(nseq > 0 && cu_seqlens_q->numel() == nseq + 1 && block_tables->shape()[0] >= nseq,
+                   "Paged Attention: need nseq block tables and kv lengths, and nseq + 1 query offsets.");
+
+    llaisys::core::context().setDevice(q->deviceType(), q->deviceId());
+
+    switch (q->deviceType()) {
+    case LLAISYS_DEVICE_CPU: {
+        auto cu_q = reinterpret_cast<const int64_t *>(cu_seqlens_q->data());
+        auto lens = reinterpret_cast<const int64_t *>(kv_lens->data());
+        auto tables = reinterpret_cast<const int64_t *>(block_tables->data());
+        CHECK_ARGUMENT(cu_q[0] == 0 && static_cast<size_t>(cu_q[nseq]) == total_q, "Paged Attention: query offsets must run from 0 to the number of rows.");
+        for (size_t s = 0; s < nseq; s++) {
+            CHECK_ARGUMENT(cu_q[s + 1] >= cu_q[s] && lens[s] >= cu_q[s + 1] - cu_q[s] && static_cast<size_t>(lens[s]) <= max_blocks * block_size,
+                           "Paged Attention: block table does not cover the sequence.");
+            check_blocks(tables + s * max_blocks, static_cast<size_t>(lens[s]), block_size, k_cache->shape()[0]);
+        }
+        return cpu::paged_varlen_attention(attn_val->data(), q->data(), k_cache->data(), v_cache->data(), tables, cu_q, lens, q->dtype(), scale,
+                                           nseq, max_blocks, nhead, d, nkvhead, dv, block_size);
+    }
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+} // namespace llaisys::ops
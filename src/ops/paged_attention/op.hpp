@@ -0,0 +1,15 @@
+#pragma once
+
+#include "../../tensor/tensor.hpp"
+
+namespace llaisys::ops {
+// Causal attention of q against the first total_len tokens of a sequence whose
+// K/V rows live in a paged cache of shape [nblocks, block_size, nkvhead, d],
+// addressed through the sequence's i64 block table.
+void paged_attention(tensor_t attn_val, tensor_t q, tensor_t k_cache, tensor_t v_cache, tensor_t block_table, size_t total_len, float scale);
+// Paged attention over a packed batch: sequence s owns query rows
+// [cu_seqlens_q[s], cu_seqlens_q[s + 1]) and attends causally to its first
+// kv_lens[s] tokens, mapped by row s of block_tables [nseq, max_blocks].
+void paged_varlen_attention(tensor_t attn_val, tensor_t q, tensor_t k_cache, tensor_t v_cache, tensor_t block_tables, tensor_t cu_seqlens_q,
+                            tensor_t kv_lens, float scale);
+}
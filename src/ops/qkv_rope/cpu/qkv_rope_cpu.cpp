@@ -0,0 +1,62 @@
+#include "qkv_rope_cpu.hpp"
+
+#include "../../../core/thread_pool/thread_pool.hpp"
+#include "../../../utils.hpp"
+#include "../../linear/cpu/linear_cpu.hpp"
+#include "../../rope/cpu/rotary.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+// Rotates and scatters the projected rows qkv [m, (nh + 2 * nkvh) * dh]: the
+// q heads to q, the k and v heads to their cache slots.
+template <typename T>
+void scatter_(T *q, T *k_cache, T *v_cache, const T *qkv, const llaisys::ops::cpu::RopeAngles &rope, const int64_t *slots, size_t m, size_t nh,
+              size_t nkvh, size_t dh) {
+    size_t width = (nh + 2 * nkvh) * dh;
+    llaisys::core::parallel_for(m, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const T *row = qkv + i * width;
+            const float *angles = rope.row(i);
+            T *k = k_cache + static_cast<size_t>(slots[i]) * nkvh * dh;
+            T *v = v_cache + static_cast<size_t>(slots[i]) * nkvh * dh;
+            llaisys::ops::cpu::rotate_heads(q + i * nh * dh, row, nh, angles, dh);
+            llaisys::ops::cpu::rotate_heads(k, row + nh * dh, nkvh, angles, dh);
+            std::copy(row + (nh + nkvh) * dh, row + width, v);
+        }
+    });
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void qkv_rope(std::byte *q, std::byte *k_cache, std::byte *v_cache, std::byte *in, std::byte *weight, std::byte *bias, const int64_t *pos_ids,
+              const int64_t *slots, float theta, llaisysDataType_t type, size_t m, size_t k, size_t nh, size_t nkvh, size_t dh, size_t nslots,
+              const WeightScales &scales) {
+    for (size_t i = 0; i < m; i++) {
+        CHECK_ARGUMENT(slots[i] >= 0 && static_cast<size_t>(slots[i]) < nslots, "QKVRoPE: cache slot out of range.");
+    }
+    // The projection is stored once, rounded as linear would store q, k and
+    // v; it stays cache resident while it is rotated and scattered, which
+    // during decode is a few KiB.
+    RopeAngles rope(theta, dh, pos_ids, m);
+    size_t width = (nh + 2 * nkvh) * dh;
+    thread_local std::vector<std::byte> qkv;
+    qkv.resize(m * width * utils::dsize(type));
+    linear(qkv.data(), in, weight, bias, m, k, width, type, {}, scales);
+
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return scatter_(reinterpret_cast<float *>(q), reinterpret_cast<float *>(k_cache), reinterpret_cast<float *>(v_cache),
+                        reinterpret_cast<const float *>(qkv.data()), rope, slots, m, nh, nkvh, dh);
+    case LLAISYS_DTYPE_BF16:
+        return scatter_(reinterpret_cast<llaisys::bf16_t *>(q), reinterpret_cast<llaisys::bf16_t *>(k_cache),
+                        reinterpret_cast<llaisys::bf16_t *>(v_cache), reinterpret_cast<const llaisys::bf16_t *>(qkv.data()), rope, slots, m, nh, nkvh, dh);
+    case LLAISYS_DTYPE_F16:
+        return scatter_(reinterpret_cast<llaisys::fp16_t *>(q), reinterpret_cast<llaisys::fp16_t *>(k_cache),
+                        reinterpret_cast<llaisys::fp16_t *>(v_cache), reinterpret_cast<const llaisys::fp16_t *>(qkv.data()), rope, slots, m, nh, nkvh, dh);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
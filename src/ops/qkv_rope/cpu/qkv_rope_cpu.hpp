@@ -0,0 +1,14 @@
+#pragma once
+#include "llaisys.h"
+
+#include "../../linear/cpu/weight_scales.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace llaisys::ops::cpu {
+// See ops::qkv_rope; the caches hold nslots rows of [nkvh, dh].
+void qkv_rope(std::byte *q, std::byte *k_cache, std::byte *v_cache, std::byte *in, std::byte *weight, std::byte *bias, const int64_t *pos_ids,
+              const int64_t *slots, float theta, llaisysDataType_t type, size_t m, size_t k, size_t nh, size_t nkvh, size_t dh, size_t nslots,
+              const WeightScales &scales = {});
+}
@@ -0,0 +1,53 @@
+#include "op.hpp"
+
+#include "../../core/llaisys_core.hpp"
+#include "../../utils.hpp"
+
+#include "../linear/op.hpp"
+#include "cpu/qkv_rope_cpu.hpp"
+
+namespace llaisys::ops {
+void qkv_rope(tensor_t q, tensor_t k_cache, tensor_t v_cache, tensor_t in, tensor_t qkv_weight, tensor_t qkv_bias, tensor_t pos_ids,
+              tensor_t slots, float theta, tensor_t qkv_scales) {
+    CHECK_SAME_DEVICE(q, k_cache, v_cache, in, qkv_weight, pos_ids, slots);
+    CHECK_SAME_DTYPE(q->dtype(), k_cache->dtype(), v_cache->dtype(), in->dtype());
+    ASSERT(q->isContiguous() && k_cache->isContiguous() && v_cache->isContiguous() && in->isContiguous() && qkv_weight->isContiguous() &&
+               pos_ids->isContiguous() && slots->isContiguous(),
+           "QKVRoPE: all tensors must be contiguous.");
+    ASSERT(q->ndim() == 3 && in->ndim() == 2 && qkv_weight->ndim() == 2 && k_cache->ndim() >= 2, "QKVRoPE: bad tensor ranks.");
+    ASSERT(pos_ids->dtype() == LLAISYS_DTYPE_I64 && slots->dtype() == LLAISYS_DTYPE_I64, "QKVRoPE: pos_ids and slots must be int64.");
+    CHECK_SAME_SHAPE(k_cache->shape(), v_cache->shape());
+
+    size_t m = in->shape()[0];
+    size_t k = in->shape()[1];
+    size_t nh = q->shape()[1];
+    size_t dh = q->shape()[2];
+    size_t nkvh = k_cache->shape()[k_cache->ndim() - 2];
+    CHECK_ARGUMENT(dh % 2 == 0 && k_cache->shape()[k_cache->ndim() - 1] == dh, "QKVRoPE: q and the caches need the same even head size.");
+    CHECK_ARGUMENT(q->shape()[0] == m && pos_ids->numel() == m && slots->numel() == m, "QKVRoPE: q, pos_ids and slots need one row per token.");
+    CHECK_ARGUMENT(qkv_weight->shape()[0] == (nh + 2 * nkvh) * dh && qkv_weight->shape()[1] == k, "QKVRoPE: qkv_weight has the wrong shape.");
+    if (qkv_bias != nullptr) {
+        CHECK_SAME_DEVICE(q, qkv_bias);
+        CHECK_SAME_DTYPE(q->dtype(), qkv_bias->dtype());
+        ASSERT(qkv_bias->isContiguous(), "QKVRoPE: all tensors must be contiguous.");
+        CHECK_ARGUMENT(qkv_bias->numel() == qkv_weight->shape()[0], "QKVRoPE: qkv_bias does not match qkv_weight.");
+    }
+    cpu::WeightScales scales = weight_scales(qkv_weight, qkv_scales, q->dtype());
+
+    llaisys::core::context().setDevice(q->deviceType(), q->deviceId());
+
+    switch (q->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        return cpu::qkv_rope(q->data(), k_cache->data(), v_cache->data(), in->data(), qkv_weight->data(), qkv_bias ? qkv_bias->data() : nullptr,
+                             reinterpret_cast<const int64_t *>(pos_ids->data()), reinterpret_cast<const int64_t *>(slots->data()), theta,
+                             q->dtype(), m, k, nh, nkvh, dh, k_cache->numel() / (nkvh * dh), scales);
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+} // namespace llaisys::ops
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "../../tensor/tensor.hpp"
+
+namespace llaisys::ops {
+// One attention input projection for a step: in [m, k] times qkv_weight
+// [(nh + 2 * nkvh) * dh, k], whose rows are the q rows, then the k rows, then
+// the v rows (qkv_bias, which may be nullptr, is laid out the same way).
+// q [m, nh, dh] receives the rotated queries. The rotated keys and the values
+// of token i go straight to row slots[i] of k_cache and v_cache, which are
+// [..., nkvh, dh] pools such as the blocks of a paged KV cache. An int8
+// qkv_weight comes with qkv_scales, as for ops::linear.
+void qkv_rope(tensor_t q, tensor_t k_cache, tensor_t v_cache, tensor_t in, tensor_t qkv_weight, tensor_t qkv_bias, tensor_t pos_ids,
+              tensor_t slots, float theta, tensor_t qkv_scales = nullptr);
+}
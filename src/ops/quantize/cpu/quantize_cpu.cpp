@@ -0,0 +1,50 @@
+#include "quantize_cpu.hpp"
+
+#include "../../../core/thread_pool/thread_pool.hpp"
+#include "../../../utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+template <typename T>
+void quantize_(int8_t *out, float *scales, const T *in, size_t n, size_t k, size_t group) {
+    size_t groups = k / group;
+    llaisys::core::parallel_for(n, 16, [&](size_t begin, size_t end) {
+        thread_local std::vector<float> row;
+        row.resize(k);
+        for (size_t j = begin; j < end; j++) {
+            llaisys::utils::cast(row.data(), in + j * k, k);
+            for (size_t g = 0; g < groups; g++) {
+                const float *x = row.data() + g * group;
+                float amax = 0.0f;
+                for (size_t p = 0; p < group; p++) {
+                    amax = std::max(amax, std::abs(x[p]));
+                }
+                float scale = amax / 127.0f;
+                scales[j * groups + g] = scale;
+                int8_t *q = out + j * k + g * group;
+                for (size_t p = 0; p < group; p++) {
+                    // An all-zero group has scale 0 and stays 0.
+                    float v = scale > 0.0f ? std::nearbyint(x[p] / scale) : 0.0f;
+                    q[p] = static_cast<int8_t>(std::clamp(v, -127.0f, 127.0f));
+                }
+            }
+        }
+    });
+}
+
+namespace llaisys::ops::cpu {
+void quantize(int8_t *out, float *scales, const std::byte *in, llaisysDataType_t type, size_t n, size_t k, size_t group) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return quantize_(out, scales, reinterpret_cast<const float *>(in), n, k, group);
+    case LLAISYS_DTYPE_BF16:
+        return quantize_(out, scales, reinterpret_cast<const llaisys::bf16_t *>(in), n, k, group);
+    case LLAISYS_DTYPE_F16:
+        return quantize_(out, scales, reinterpret_cast<const llaisys::fp16_t *>(in), n, k, group);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
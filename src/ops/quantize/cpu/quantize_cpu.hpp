@@ -0,0 +1,9 @@
+#pragma once
+#include "llaisys.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace llaisys::ops::cpu {
+void quantize(int8_t *out, float *scales, const std::byte *in, llaisysDataType_t type, size_t n, size_t k, size_t group);
+}
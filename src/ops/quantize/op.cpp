@@ -0,0 +1,33 @@
+#include "op.hpp"
+
+#include "../../core/llaisys_core.hpp"
+#include "../../utils.hpp"
+
+#include "../linear/op.hpp"
+#include "cpu/quantize_cpu.hpp"
+
+namespace llaisys::ops {
+void quantize(tensor_t out, tensor_t scales, tensor_t in) {
+    CHECK_SAME_DEVICE(out, scales, in);
+    ASSERT(out->dtype() == LLAISYS_DTYPE_I8, "Quantize: out must be int8.");
+    ASSERT(out->isContiguous() && in->isContiguous(), "Quantize: all tensors must be contiguous.");
+    ASSERT(in->ndim() == 2, "Quantize: in must be 2-D.");
+    CHECK_SAME_SHAPE(out->shape(), in->shape());
+    cpu::WeightScales layout = weight_scales(out, scales, in->dtype());
+
+    llaisys::core::context().setDevice(out->deviceType(), out->deviceId());
+
+    switch (out->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        return cpu::quantize(reinterpret_cast<int8_t *>(out->data()), reinterpret_cast<float *>(scales->data()), in->data(), in->dtype(),
+                             in->shape()[0], in->shape()[1], layout.group);
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+} // namespace llaisys::ops
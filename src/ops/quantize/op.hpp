@@ -0,0 +1,11 @@
+#pragma once
+
+#include "../../tensor/tensor.hpp"
+
+namespace llaisys::ops {
+// Symmetric int8 quantization of a weight in [n, k] for ops::linear. Every
+// output channel is split into groups of k / groups columns, where scales is
+// [n, groups]; a group's scale is its largest magnitude over 127, and out
+// [n, k] holds in / scale rounded to the nearest integer.
+void quantize(tensor_t out, tensor_t scales, tensor_t in);
+}
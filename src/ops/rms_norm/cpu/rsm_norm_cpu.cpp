@@ -1,38 +1,92 @@
 #include "rsm_norm_cpu.hpp"
 
+#include "../../../core/thread_pool/thread_pool.hpp"
 #include "../../../utils.hpp"
+#include "../../../utils/simd.hpp"
 
 #include <cmath>
 
+namespace {
+namespace simd = llaisys::utils::simd;
+
+template <typename T>
+float sum_squares(const T *x, size_t n) {
+    float sum = 0.0f;
+    size_t j = 0;
+#if defined(LLAISYS_AVX512) || defined(LLAISYS_AVX2)
+    simd::vec_t acc = simd::zero();
+    for (; j + simd::VLEN <= n; j += simd::VLEN) {
+        simd::vec_t v = simd::load(x + j);
+        acc = simd::fma(v, v, acc);
+    }
+    sum = simd::hsum(acc);
+#endif
+    for (; j < n; j++) {
+        float v = llaisys::utils::cast<float>(x[j]);
+        sum += v * v;
+    }
+    return sum;
+}
+
+// out = x * weight * scale.
+template <typename T>
+void scale_row(T *out, const T *x, const T *weight, float scale, size_t n) {
+    size_t j = 0;
+#if defined(LLAISYS_AVX512) || defined(LLAISYS_AVX2)
+    simd::vec_t s = simd::set1(scale);
+    for (; j + simd::VLEN <= n; j += simd::VLEN) {
+        simd::store(out + j, simd::mul(simd::mul(simd::load(x + j), simd::load(weight + j)), s));
+    }
+#endif
+    for (; j < n; j++) {
+        out[j] = llaisys::utils::cast<T>(llaisys::utils::cast<float>(x[j]) * llaisys::utils::cast<float>(weight[j]) * scale);
+    }
+}
+
+// residual += in, rounded to T; returns the sum of squares of the result.
+template <typename T>
+float add_sum_squares(T *residual, const T *in, size_t n) {
+    float sum = 0.0f;
+    size_t j = 0;
+#if defined(LLAISYS_AVX512) || defined(LLAISYS_AVX2)
+    simd::vec_t acc = simd::zero();
+    for (; j + simd::VLEN <= n; j += simd::VLEN) {
+        simd::store(residual + j, simd::add(simd::load(residual + j), simd::load(in + j)));
+        // Reloaded so the norm sees the stored, rounded values.
+        simd::vec_t v = simd::load(residual + j);
+        acc = simd::fma(v, v, acc);
+    }
+    sum = simd::hsum(acc);
+#endif
+    for (; j < n; j++) {
+        residual[j] = llaisys::utils::cast<T>(llaisys::utils::cast<float>(residual[j]) + llaisys::utils::cast<float>(in[j]));
+        float v = llaisys::utils::cast<float>(residual[j]);
+        sum += v * v;
+    }
+    return sum;
+}
+} // namespace
+
 template <typename T>
 void rsm_norm_(T *out, const T *in, const T* weight, float eps, size_t height, size_t width) {
-    for (size_t i = 0; i < height; i++) {
-        float div = 0;
-        if constexpr (std::is_same_v<T, llaisys::bf16_t> || std::is_same_v<T, llaisys::fp16_t>) { 
-            for (size_t j = 0; j < width; j++) {
-                float in_temp = llaisys::utils::cast<float>(in[i*width+j]);
-                div += in_temp * in_temp;
-            }
-        } else { 
-            for (size_t j = 0; j < width; j++) {
-                div += in[i*width+j] * in[i*width+j];
-            }
+    llaisys::core::parallel_for(height, 1, [&](size_t row_begin, size_t row_end) {
+        for (size_t i = row_begin; i < row_end; i++) {
+            float scale = 1.0f / std::sqrt(sum_squares(in + i * width, width) / width + eps);
+            scale_row(out + i * width, in + i * width, weight, scale, width);
         }
-        div /= width;
-        div += eps;
-        div = sqrt(div);
-        if constexpr (std::is_same_v<T, llaisys::bf16_t> || std::is_same_v<T, llaisys::fp16_t>) {
-            for (size_t j = 0; j < width; j++) {
-                out[i*width+j] = llaisys::utils::cast<T>(
-                    llaisys::utils::cast<float>(weight[j]) * llaisys::utils::cast<float>(in[i*width+j]) / div
-                );
-            }
-        } else {
-            for (size_t j = 0; j < width; j++) {
-                out[i*width+j] = weight[j] * in[i*width+j] / div;
-            }
+    });
+}
+
+// The row is still in L1 when it is scaled, so the hidden state is read and
+// written once for both the residual add and the norm.
+template <typename T>
+void add_rms_norm_(T *out, T *residual, const T *in, const T *weight, float eps, size_t height, size_t width) {
+    llaisys::core::parallel_for(height, 1, [&](size_t row_begin, size_t row_end) {
+        for (size_t i = row_begin; i < row_end; i++) {
+            float scale = 1.0f / std::sqrt(add_sum_squares(residual + i * width, in + i * width, width) / width + eps);
+            scale_row(out + i * width, residual + i * width, weight, scale, width);
         }
-    }
+    });
 }
 
 namespace llaisys::ops::cpu {
@@ -64,4 +118,21 @@ void rsm_norm(std::byte *out, const std::byte *in, const std::byte *weight, floa
         EXCEPTION_UNSUPPORTED_DATATYPE(type);
     }
 }
-} // namespace llaisys::ops::cpu
\ No newline at end of file
+
+void add_rms_norm(std::byte *out, std::byte *residual, const std::byte *in, const std::byte *weight, float eps, llaisysDataType_t type,
+                  size_t height, size_t width) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return add_rms_norm_(reinterpret_cast<float *>(out), reinterpret_cast<float *>(residual), reinterpret_cast<const float *>(in),
+                             reinterpret_cast<const float *>(weight), eps, height, width);
+    case LLAISYS_DTYPE_BF16:
+        return add_rms_norm_(reinterpret_cast<llaisys::bf16_t *>(out), reinterpret_cast<llaisys::bf16_t *>(residual),
+                             reinterpret_cast<const llaisys::bf16_t *>(in), reinterpret_cast<const llaisys::bf16_t *>(weight), eps, height, width);
+    case LLAISYS_DTYPE_F16:
+        return add_rms_norm_(reinterpret_cast<llaisys::fp16_t *>(out), reinterpret_cast<llaisys::fp16_t *>(residual),
+                             reinterpret_cast<const llaisys::fp16_t *>(in), reinterpret_cast<const llaisys::fp16_t *>(weight), eps, height, width);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
@@ -5,4 +5,6 @@
 
 namespace llaisys::ops::cpu {
 void rsm_norm(std::byte *out, const std::byte *in, const std::byte *weight, float eps, llaisysDataType_t type, size_t height, size_t width);
+void add_rms_norm(std::byte *out, std::byte *residual, const std::byte *in, const std::byte *weight, float eps, llaisysDataType_t type,
+                  size_t height, size_t width);
 }
\ No newline at end of file
@@ -26,4 +26,29 @@ void rms_norm(tensor_t out, tensor_t in, tensor_t weight, float eps) {
         EXCEPTION_UNSUPPORTED_DEVICE;
     }
 }
+
+void add_rms_norm(tensor_t out, tensor_t residual, tensor_t in, tensor_t weight, float eps) {
+    CHECK_SAME_DEVICE(out, residual, in, weight);
+    CHECK_SAME_SHAPE(out->shape(), residual->shape(), in->shape());
+    CHECK_SAME_DTYPE(out->dtype(), residual->dtype(), in->dtype(), weight->dtype());
+    ASSERT(out->isContiguous() && residual->isContiguous() && in->isContiguous() && weight->isContiguous(),
+           "Add RMS Norm: all tensors must be contiguous.");
+    ASSERT(residual->ndim() == 2 && weight->ndim() == 1 && weight->shape()[0] == residual->shape()[1],
+           "Add RMS Norm: expected residual/in/out [m, n] and weight [n].");
+
+    llaisys::core::context().setDevice(weight->deviceType(), weight->deviceId());
+
+    switch (weight->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        return cpu::add_rms_norm(out->data(), residual->data(), in->data(), weight->data(), eps, weight->dtype(), residual->shape()[0],
+                                 residual->shape()[1]);
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
 } // namespace llaisys::ops
@@ -4,4 +4,7 @@
 
 namespace llaisys::ops {
 void rms_norm(tensor_t out, tensor_t in, tensor_t weight, float eps);
+// The residual add before a norm, fused with it: residual += in, then
+// out = rms_norm(residual, weight, eps), in one sweep over each row.
+void add_rms_norm(tensor_t out, tensor_t residual, tensor_t in, tensor_t weight, float eps);
 }
@@ -1,54 +1,33 @@
 #include "rope_cpu.hpp"
 
+#include "../../../core/thread_pool/thread_pool.hpp"
 #include "../../../utils.hpp"
 
-#include <cmath>
+#include "rotary.hpp"
 
 template <typename T>
-void rope_(T *out, const T *in, const int64_t *pos_ids, float theta, size_t seqlen, size_t nhead, size_t d) {
-    for (size_t seq = 0; seq < seqlen; seq++) {
-        int64_t p = pos_ids[seq];
-        for (size_t i = 0; i < nhead; i++) {
-            size_t offset_a = seq*nhead*d+i*d;
-            size_t offset_b = offset_a + d/2;
-            for (size_t j = 0; j < d/2; j++) {
-                double fai = p * std::pow(static_cast<double>(theta), -2* static_cast<double>(j)/d); 
-                float cos_fai = std::cos(fai);
-                float sin_fai = std::sin(fai);
-
-                float a, b;
-                if constexpr (std::is_same_v<T, llaisys::bf16_t> || std::is_same_v<T, llaisys::fp16_t>) {
-                    a = llaisys::utils::cast<float>(in[offset_a+j]);
-                    b = llaisys::utils::cast<float>(in[offset_b+j]);
-                } else {
-                    a = in[offset_a+j];
-                    b = in[offset_b+j];
-                }
-                float a_out = a*cos_fai-b*sin_fai;
-                float b_out = b*cos_fai+a*sin_fai;
-                if constexpr (std::is_same_v<T, llaisys::bf16_t> || std::is_same_v<T, llaisys::fp16_t>) {
-                    out[offset_a+j] = llaisys::utils::cast<T>(a_out);
-                    out[offset_b+j] = llaisys::utils::cast<T>(b_out);
-                } else {
-                    out[offset_a+j] = a_out;
-                    out[offset_b+j] = b_out;
-                }
-            }
+void rope_(T *out, const T *in, const llaisys::ops::cpu::RopeAngles &angles, size_t seqlen, size_t nhead, size_t d) {
+    llaisys::core::parallel_for(seqlen, 1, [&](size_t seq_begin, size_t seq_end) {
+        for (size_t seq = seq_begin; seq < seq_end; seq++) {
+            size_t offset = seq * nhead * d;
+            llaisys::ops::cpu::rotate_heads(out + offset, in + offset, nhead, angles.row(seq), d);
         }
-    }
+    });
 }
 
 namespace llaisys::ops::cpu {
 void rope(std::byte *out, const std::byte *in, const std::byte *pos_ids, float theta, llaisysDataType_t type, size_t seqlen, size_t nhead, size_t d) {
+    const int64_t *pos = reinterpret_cast<const int64_t *>(pos_ids);
+    RopeAngles angles(theta, d, pos, seqlen);
         switch (type) {
     case LLAISYS_DTYPE_F32:
-        return rope_(reinterpret_cast<float *>(out), reinterpret_cast<const float *>(in), reinterpret_cast<const int64_t *>(pos_ids), theta, seqlen, nhead, d);
+        return rope_(reinterpret_cast<float *>(out), reinterpret_cast<const float *>(in), angles, seqlen, nhead, d);
     case LLAISYS_DTYPE_BF16:
-        return rope_(reinterpret_cast<llaisys::bf16_t *>(out), reinterpret_cast<const llaisys::bf16_t *>(in), reinterpret_cast<const int64_t *>(pos_ids), theta, seqlen, nhead, d);
+        return rope_(reinterpret_cast<llaisys::bf16_t *>(out), reinterpret_cast<const llaisys::bf16_t *>(in), angles, seqlen, nhead, d);
     case LLAISYS_DTYPE_F16:
-        return rope_(reinterpret_cast<llaisys::fp16_t *>(out), reinterpret_cast<const llaisys::fp16_t *>(in), reinterpret_cast<const int64_t *>(pos_ids), theta, seqlen, nhead, d);
+        return rope_(reinterpret_cast<llaisys::fp16_t *>(out), reinterpret_cast<const llaisys::fp16_t *>(in), angles, seqlen, nhead, d);
     default:
         EXCEPTION_UNSUPPORTED_DATATYPE(type);
     }
 }
-}
\ No newline at end of file
+}
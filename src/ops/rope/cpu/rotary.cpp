@@ -0,0 +1,64 @@
+#include "rotary.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace {
+// Angles of one position for (theta, d).
+void fill_row(float *row, float theta, size_t d, size_t pos) {
+    size_t half = d / 2;
+    for (size_t j = 0; j < half; j++) {
+        double fai = static_cast<double>(pos) * std::pow(static_cast<double>(theta), -2 * static_cast<double>(j) / d);
+        row[j] = static_cast<float>(std::cos(fai));
+        row[half + j] = static_cast<float>(std::sin(fai));
+    }
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+rope_table_t rope_table(float theta, size_t d, size_t npos) {
+    static std::mutex mutex;
+    static std::map<std::pair<uint32_t, size_t>, rope_table_t> tables;
+
+    ASSERT(npos <= ROPE_CACHED_POSITIONS, "RoPE: table too long.");
+    uint32_t theta_bits;
+    std::memcpy(&theta_bits, &theta, sizeof(theta_bits));
+    std::lock_guard<std::mutex> lock(mutex);
+    rope_table_t &table = tables[{theta_bits, d}];
+    size_t have = table ? table->size() / d : 0;
+    if (have >= npos) {
+        return table;
+    }
+    // Doubling keeps a long generation from rebuilding the table every step.
+    size_t want = std::min(std::max(npos, 2 * have), ROPE_CACHED_POSITIONS);
+    auto grown = std::make_shared<std::vector<float>>(want * d);
+    if (table) {
+        std::copy(table->begin(), table->end(), grown->begin());
+    }
+    for (size_t pos = have; pos < want; pos++) {
+        fill_row(grown->data() + pos * d, theta, d, pos);
+    }
+    table = std::move(grown);
+    return table;
+}
+
+RopeAngles::RopeAngles(float theta, size_t d, const int64_t *pos_ids, size_t n) : _pos_ids(pos_ids), _d(d) {
+    int64_t last = 0;
+    for (size_t i = 0; i < n; i++) {
+        CHECK_ARGUMENT(pos_ids[i] >= 0, "RoPE: negative position.");
+        last = std::max(last, pos_ids[i]);
+    }
+    if (static_cast<uint64_t>(last) < ROPE_CACHED_POSITIONS) {
+        _table = rope_table(theta, d, static_cast<size_t>(last) + 1);
+        return;
+    }
+    _own.resize(n * d);
+    for (size_t i = 0; i < n; i++) {
+        fill_row(_own.data() + i * d, theta, d, static_cast<size_t>(pos_ids[i]));
+    }
+}
+} // namespace llaisys::ops::cpu
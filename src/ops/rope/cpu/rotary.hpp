@@ -0,0 +1,75 @@
+#pragma once
+#include "llaisys.h"
+
+#include "../../../utils.hpp"
+#include "../../../utils/simd.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace llaisys::ops::cpu {
+// Positions the shared tables below cover at most.
+constexpr size_t ROPE_CACHED_POSITIONS = size_t(1) << 16;
+
+// cos and sin of the rotation angles of positions [0, npos) for one (theta,
+// head size d): row p holds the d / 2 cosines, then the d / 2 sines. Tables
+// are built once and shared by every rope kernel; a longer position than any
+// seen before grows the table, up to ROPE_CACHED_POSITIONS rows, and callers
+// keep the snapshot they were given.
+using rope_table_t = std::shared_ptr<const std::vector<float>>;
+rope_table_t rope_table(float theta, size_t d, size_t npos);
+
+// Angle rows, laid out as in rope_table(), of n positions, which must not be
+// negative. They come from the shared table unless a position is past
+// ROPE_CACHED_POSITIONS; then the call computes a row per position of its
+// own, so one far position never costs a table up to it.
+class RopeAngles {
+public:
+    RopeAngles(float theta, size_t d, const int64_t *pos_ids, size_t n);
+
+    // Angles of position pos_ids[i].
+    const float *row(size_t i) const {
+        return _own.empty() ? _table->data() + static_cast<size_t>(_pos_ids[i]) * _d : _own.data() + i * _d;
+    }
+
+private:
+    const int64_t *_pos_ids;
+    size_t _d;
+    rope_table_t _table;
+    std::vector<float> _own;
+};
+
+// Rotates nhead consecutive heads of d values with the angles of one table
+// row, pairing element j of a head with element j + d / 2. out may be in.
+template <typename T>
+void rotate_heads(T *out, const T *in, size_t nhead, const float *angles, size_t d) {
+    size_t half = d / 2;
+    const float *cos = angles;
+    const float *sin = angles + half;
+    size_t j = 0;
+#if defined(LLAISYS_AVX512) || defined(LLAISYS_AVX2)
+    namespace simd = utils::simd;
+    for (; j + simd::VLEN <= half; j += simd::VLEN) {
+        // One load of the angles serves every head.
+        simd::vec_t c = simd::load(cos + j);
+        simd::vec_t s = simd::load(sin + j);
+        for (size_t h = 0; h < nhead; h++) {
+            simd::vec_t a = simd::load(in + h * d + j);
+            simd::vec_t b = simd::load(in + h * d + half + j);
+            simd::store(out + h * d + j, simd::sub(simd::mul(a, c), simd::mul(b, s)));
+            simd::store(out + h * d + half + j, simd::add(simd::mul(b, c), simd::mul(a, s)));
+        }
+    }
+#endif
+    for (; j < half; j++) {
+        for (size_t h = 0; h < nhead; h++) {
+            float a = utils::cast<float>(in[h * d + j]);
+            float b = utils::cast<float>(in[h * d + half + j]);
+            out[h * d + j] = utils::cast<T>(a * cos[j] - b * sin[j]);
+            out[h * d + half + j] = utils::cast<T>(b * cos[j] + a * sin[j]);
+        }
+    }
+}
+} // namespace llaisys::ops::cpu
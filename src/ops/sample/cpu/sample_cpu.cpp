@@ -0,0 +1,168 @@
+#include "sample_cpu.hpp"
+
+#include "../../../utils.hpp"
+#include "../../../utils/math.hpp"
+#include "../../../utils/simd.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace {
+namespace simd = llaisys::utils::simd;
+
+// Tokens more than 30 temperature units below the best one carry under e^-30
+// of its probability; dropping them first keeps the selection small.
+constexpr float SPREAD = 30.0f;
+
+// Every earlier token is penalized once, however often it occurred.
+void penalize(float *x, const int64_t *ids, size_t n, const int64_t *prev_tokens, size_t nprev, float repetition, float presence) {
+    thread_local std::vector<int64_t> seen;
+    seen.assign(prev_tokens, prev_tokens + nprev);
+    std::sort(seen.begin(), seen.end());
+    seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+
+    auto apply = [&](float &logit) {
+        logit = logit > 0.0f ? logit / repetition : logit * repetition;
+        logit -= presence;
+    };
+    if (ids == nullptr) {
+        for (int64_t token : seen) {
+            CHECK_ARGUMENT(token >= 0 && static_cast<size_t>(token) < n, "Sample: previous token out of range.");
+            apply(x[token]);
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            if (std::binary_search(seen.begin(), seen.end(), ids[i])) {
+                apply(x[i]);
+            }
+        }
+    }
+}
+
+float max_of(const float *x, size_t n) {
+    float best = -std::numeric_limits<float>::infinity();
+    size_t i = 0;
+#if defined(LLAISYS_AVX512) || defined(LLAISYS_AVX2)
+    simd::vec_t acc = simd::set1(best);
+    for (; i + simd::VLEN <= n; i += simd::VLEN) {
+        acc = simd::max(acc, simd::load(x + i));
+    }
+    best = simd::hmax(acc);
+#endif
+    for (; i < n; i++) {
+        best = std::max(best, x[i]);
+    }
+    return best;
+}
+
+template <typename T>
+int64_t sample_(const T *logits, const int64_t *ids, const int64_t *prev_tokens, size_t n, size_t nprev, float temperature, size_t top_k,
+                float top_p, float repetition_penalty, float presence_penalty, llaisys::utils::Rng &rng, int64_t draft) {
+    thread_local std::vector<float> x;
+    x.resize(n);
+    llaisys::utils::cast(x.data(), logits, n);
+    if (nprev > 0 && (repetition_penalty != 1.0f || presence_penalty != 0.0f)) {
+        penalize(x.data(), ids, n, prev_tokens, nprev, repetition_penalty, presence_penalty);
+    }
+    auto token = [&](size_t pos) { return ids == nullptr ? static_cast<int64_t>(pos) : ids[pos]; };
+
+    float hi = max_of(x.data(), n);
+    if (temperature <= 0.0f || top_k == 1) {
+        return token(static_cast<size_t>(std::find(x.begin(), x.end(), hi) - x.begin()));
+    }
+
+    thread_local std::vector<size_t> cand;
+    cand.clear();
+    float floor = hi - SPREAD * temperature;
+    for (size_t pos = 0; pos < n; pos++) {
+        if (x[pos] >= floor) {
+            cand.push_back(pos);
+        }
+    }
+    if (top_k > 0 && top_k < cand.size()) {
+        auto better = [&](size_t a, size_t b) { return x[a] > x[b] || (x[a] == x[b] && a < b); };
+        std::nth_element(cand.begin(), cand.begin() + static_cast<std::ptrdiff_t>(top_k - 1), cand.end(), better);
+        cand.resize(top_k);
+    }
+
+    size_t c = cand.size();
+    thread_local std::vector<float> w;
+    w.resize(c);
+    for (size_t i = 0; i < c; i++) {
+        w[i] = x[cand[i]];
+    }
+    float total = llaisys::utils::exp_sum(w.data(), c, hi, 1.0f / temperature);
+
+    // The kept candidates, as indices into cand and w.
+    thread_local std::vector<size_t> order;
+    order.resize(c);
+    std::iota(order.begin(), order.end(), 0);
+    size_t nkept = c;
+    float kept = total;
+    if (top_p > 0.0f && top_p < 1.0f) {
+        // Pops the most likely candidates off a heap until they cover top_p;
+        // they collect at the back of order.
+        auto less = [&](size_t a, size_t b) { return w[a] < w[b] || (w[a] == w[b] && cand[a] > cand[b]); };
+        std::make_heap(order.begin(), order.end(), less);
+        auto end = order.end();
+        nkept = 0;
+        kept = 0.0f;
+        while (nkept < c && (nkept == 0 || kept < top_p * total)) {
+            std::pop_heap(order.begin(), end, less);
+            --end;
+            kept += w[*end];
+            nkept++;
+        }
+    }
+    size_t *sel = order.data() + (c - nkept);
+
+    auto draw = [&](size_t m, float mass) {
+        float u = rng.uniform() * mass;
+        for (size_t i = 0; i + 1 < m; i++) {
+            u -= w[sel[i]];
+            if (u < 0.0f) {
+                return token(cand[sel[i]]);
+            }
+        }
+        return token(cand[sel[m - 1]]);
+    };
+
+    if (draft >= 0) {
+        for (size_t i = 0; i < nkept; i++) {
+            if (token(cand[sel[i]]) != draft) {
+                continue;
+            }
+            float p = w[sel[i]];
+            if (nkept == 1 || rng.uniform() * kept < p) {
+                return draft;
+            }
+            // Rejected: draw from the rest of the distribution.
+            std::swap(sel[i], sel[nkept - 1]);
+            return draw(nkept - 1, kept - p);
+        }
+    }
+    return draw(nkept, kept);
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+int64_t sample(const std::byte *logits, const int64_t *ids, const int64_t *prev_tokens, llaisysDataType_t type, size_t n, size_t nprev,
+               float temperature, size_t top_k, float top_p, float repetition_penalty, float presence_penalty, utils::Rng &rng,
+               int64_t draft) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return sample_(reinterpret_cast<const float *>(logits), ids, prev_tokens, n, nprev, temperature, top_k, top_p, repetition_penalty,
+                       presence_penalty, rng, draft);
+    case LLAISYS_DTYPE_BF16:
+        return sample_(reinterpret_cast<const llaisys::bf16_t *>(logits), ids, prev_tokens, n, nprev, temperature, top_k, top_p,
+                       repetition_penalty, presence_penalty, rng, draft);
+    case LLAISYS_DTYPE_F16:
+        return sample_(reinterpret_cast<const llaisys::fp16_t *>(logits), ids, prev_tokens, n, nprev, temperature, top_k, top_p,
+                       repetition_penalty, presence_penalty, rng, draft);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
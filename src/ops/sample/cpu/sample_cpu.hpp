@@ -0,0 +1,13 @@
+#pragma once
+#include "llaisys.h"
+
+#include "../../../utils/random.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace llaisys::ops::cpu {
+int64_t sample(const std::byte *logits, const int64_t *ids, const int64_t *prev_tokens, llaisysDataType_t type, size_t n, size_t nprev,
+               float temperature, size_t top_k, float top_p, float repetition_penalty, float presence_penalty, utils::Rng &rng,
+               int64_t draft);
+}
@@ -0,0 +1,47 @@
+#include "op.hpp"
+
+#include "../../core/llaisys_core.hpp"
+#include "../../utils.hpp"
+
+#include "cpu/sample_cpu.hpp"
+
+namespace llaisys::ops {
+void sample(tensor_t out_idx, tensor_t logits, tensor_t ids, tensor_t prev_tokens, const SampleParams &params, utils::Rng &rng,
+            int64_t draft) {
+    CHECK_SAME_DEVICE(out_idx, logits);
+    ASSERT(out_idx->dtype() == LLAISYS_DTYPE_I64 && out_idx->numel() == 1, "Sample: out_idx must be a single int64.");
+    ASSERT(logits->isContiguous() && logits->ndim() == 1, "Sample: logits must be a contiguous 1-D tensor.");
+    size_t n = logits->shape()[0];
+    CHECK_ARGUMENT(n > 0, "Sample: logits must not be empty.");
+    if (ids) {
+        CHECK_SAME_DEVICE(ids, logits);
+        ASSERT(ids->dtype() == LLAISYS_DTYPE_I64 && ids->isContiguous(), "Sample: ids must be contiguous int64.");
+        CHECK_SAME_SHAPE(ids->shape(), logits->shape());
+    }
+    if (prev_tokens) {
+        CHECK_SAME_DEVICE(prev_tokens, logits);
+        ASSERT(prev_tokens->dtype() == LLAISYS_DTYPE_I64 && prev_tokens->isContiguous() && prev_tokens->ndim() == 1,
+               "Sample: prev_tokens must be a contiguous 1-D int64 tensor.");
+    }
+    CHECK_ARGUMENT(params.repetition_penalty > 0.0f, "Sample: repetition_penalty must be positive.");
+
+    llaisys::core::context().setDevice(logits->deviceType(), logits->deviceId());
+
+    switch (logits->deviceType()) {
+    case LLAISYS_DEVICE_CPU:
+        *reinterpret_cast<int64_t *>(out_idx->data()) = cpu::sample(
+            logits->data(), ids ? reinterpret_cast<const int64_t *>(ids->data()) : nullptr,
+            prev_tokens ? reinterpret_cast<const int64_t *>(prev_tokens->data()) : nullptr, logits->dtype(), n,
+            prev_tokens ? prev_tokens->numel() : 0, params.temperature, params.top_k, params.top_p, params.repetition_penalty,
+            params.presence_penalty, rng, draft);
+        return;
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+} // namespace llaisys::ops
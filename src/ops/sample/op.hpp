@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../../tensor/tensor.hpp"
+#include "../../utils/random.hpp"
+
+namespace llaisys::ops {
+struct SampleParams {
+    // Divides the logits; 0 or less picks the best token.
+    float temperature = 1.0f;
+    // Keeps the top_k best tokens; 0 keeps them all and 1 is greedy.
+    size_t top_k = 0;
+    // Keeps the fewest best tokens whose probability reaches top_p.
+    float top_p = 1.0f;
+    // Divides positive and multiplies negative logits of earlier tokens; 1 is off.
+    float repetition_penalty = 1.0f;
+    // Subtracted once from the logit of every earlier token; 0 is off.
+    float presence_penalty = 0.0f;
+};
+
+// Draws one token from logits [n] into out_idx [1]. Without ids the logits
+// cover the vocabulary; with ids [n] they belong to those candidate tokens
+// (e.g. the output of lm_head_topk). prev_tokens [p], if given, lists the
+// tokens the penalties apply to. Selection is partial: tokens far below the
+// best one are dropped, top_k is an nth_element and top_p pops a heap, so
+// nothing is sorted. When draft >= 0 the draw is a speculative decoding
+// check: draft is returned with its probability under the distribution and
+// otherwise a token drawn from the rest of it.
+void sample(tensor_t out_idx, tensor_t logits, tensor_t ids, tensor_t prev_tokens, const SampleParams &params, utils::Rng &rng,
+            int64_t draft = -1);
+} // namespace llaisys::ops
@@ -0,0 +1,338 @@
+#pragma once
+
+#include "../../../core/thread_pool/thread_pool.hpp"
+#include "../../../utils.hpp"
+#include "../../../utils/math.hpp"
+#include "../../../utils/simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Flash-style causal attention shared by the CPU attention ops. The kernel is
+// templated on the K/V layout, which only has to map (token, kv head) to a row.
+namespace llaisys::ops::cpu::flash {
+namespace simd = llaisys::utils::simd;
+
+// K/V rows stored contiguously as [total_len, nkvhead, d].
+template <typename T>
+struct ContiguousKV {
+    const T *k;
+    const T *v;
+    size_t nkvhead, d, dv;
+
+    const T *key(size_t j, size_t h) const { return k + (j * nkvhead + h) * d; }
+    const T *value(size_t j, size_t h) const { return v + (j * nkvhead + h) * dv; }
+};
+
+// K/V rows stored in fixed-size blocks [nblocks, block_size, nkvhead, d];
+// token j of the sequence lives in block block_table[j / block_size].
+template <typename T>
+struct PagedKV {
+    const T *k;
+    const T *v;
+    const int64_t *block_table;
+    size_t block_size, nkvhead, d, dv;
+
+    size_t row(size_t j, size_t h) const { return (static_cast<size_t>(block_table[j / block_size]) * block_size + j % block_size) * nkvhead + h; }
+    const T *key(size_t j, size_t h) const { return k + row(j, h) * d; }
+    const T *value(size_t j, size_t h) const { return v + row(j, h) * dv; }
+};
+
+// Keys per K/V tile, and the number of query rows (queries x heads sharing a
+// kv head) scored against each tile. The f32 K/V tiles and the running output
+// of all rows stay cache resident while the tile is consumed.
+constexpr size_t BK = 64;
+constexpr size_t TILE_ROWS = 64;
+
+inline float dot(const float *a, const float *b, size_t n) {
+    size_t i = 0;
+    float sum = 0.0f;
+#if defined(LLAISYS_AVX512) || defined(LLAISYS_AVX2)
+    simd::vec_t acc = simd::zero();
+    for (; i + simd::VLEN <= n; i += simd::VLEN) {
+        acc = simd::fma(simd::load(a + i), simd::load(b + i), acc);
+    }
+    sum = simd::hsum(acc);
+#endif
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// y = y * beta + alpha * x
+inline void scale_axpy(float *y, float beta, float alpha, const float *x, size_t n) {
+    size_t i = 0;
+#if defined(LLAISYS_AVX512) || defined(LLAISYS_AVX2)
+    simd::vec_t vb = simd::set1(beta);
+    simd::vec_t va = simd::set1(alpha);
+    for (; i + simd::VLEN <= n; i += simd::VLEN) {
+        simd::store(y + i, simd::fma(va, simd::load(x + i), simd::mul(vb, simd::load(y + i))));
+    }
+#endif
+    for (; i < n; i++) {
+        y[i] = y[i] * beta + alpha * x[i];
+    }
+}
+
+// Keys per KV split below which splitting the sequence across threads costs
+// more in merging than it gains.
+constexpr size_t MIN_SPLIT_KEYS = 256;
+
+// Running online-softmax state of a tile of query rows: the unnormalized
+// output, the max score and the sum of exponentials seen so far.
+struct RowState {
+    float *acc;
+    float *max;
+    float *sum;
+};
+
+// Queries [i0, i1) of every head that maps to kv head h_kv, against keys
+// [j_begin, j_end) clipped to the causal limit of each query. Each row keeps
+// its running state, so scores never leave the tile. Row r is query
+// i0 + r / group of head h_kv * group + r % group.
+template <typename T, typename KV>
+void attend_range(RowState state, const T *q, const KV &kv, float scale, size_t seqlen, size_t nhead, size_t d,
+                  size_t total_len, size_t nkvhead, size_t dv, size_t h_kv, size_t i0, size_t i1, size_t j_begin, size_t j_end) {
+    size_t group = nhead / nkvhead;
+    size_t past_len = total_len - seqlen;
+    size_t rows = (i1 - i0) * group;
+
+    thread_local std::vector<float> q_tile, k_tile, v_tile, score;
+    q_tile.resize(rows * d);
+    k_tile.resize(BK * d);
+    v_tile.resize(BK * dv);
+    score.resize(BK);
+    std::fill(state.acc, state.acc + rows * dv, 0.0f);
+    std::fill(state.max, state.max + rows, -std::numeric_limits<float>::infinity());
+    std::fill(state.sum, state.sum + rows, 0.0f);
+
+    for (size_t r = 0; r < rows; r++) {
+        size_t h_q = h_kv * group + r % group;
+        float *qr = q_tile.data() + r * d;
+        llaisys::utils::cast(qr, q + ((i0 + r / group) * nhead + h_q) * d, d);
+        for (size_t l = 0; l < d; l++) {
+            qr[l] *= scale;
+        }
+    }
+
+    // Tiles past the last query's causal limit are fully masked.
+    j_end = std::min(j_end, past_len + i1);
+    for (size_t j0 = j_begin; j0 < j_end; j0 += BK) {
+        size_t jn = std::min(BK, j_end - j0);
+        for (size_t j = 0; j < jn; j++) {
+            llaisys::utils::cast(k_tile.data() + j * d, kv.key(j0 + j, h_kv), d);
+            llaisys::utils::cast(v_tile.data() + j * dv, kv.value(j0 + j, h_kv), dv);
+        }
+
+        for (size_t r = 0; r < rows; r++) {
+            size_t limit = past_len + i0 + r / group + 1;
+            if (limit <= j0) {
+                continue;
+            }
+            size_t visible = std::min(jn, limit - j0);
+
+            const float *qr = q_tile.data() + r * d;
+            float tile_max = -std::numeric_limits<float>::infinity();
+            for (size_t j = 0; j < visible; j++) {
+                score[j] = dot(qr, k_tile.data() + j * d, d);
+                tile_max = std::max(tile_max, score[j]);
+            }
+
+            float new_max = std::max(state.max[r], tile_max);
+            float correction = std::exp(state.max[r] - new_max);
+            state.max[r] = new_max;
+
+            float *out = state.acc + r * dv;
+            float sum = llaisys::utils::exp_sum(score.data(), visible, new_max);
+            for (size_t j = 0; j < visible; j++) {
+                scale_axpy(out, j == 0 ? correction : 1.0f, score[j], v_tile.data() + j * dv, dv);
+            }
+            state.sum[r] = state.sum[r] * correction + sum;
+        }
+    }
+}
+
+// Normalizes the rows of a tile and writes them to attn_val. With several KV
+// splits, their partial states are first merged by log-sum-exp: each split is
+// rescaled by exp(max_s - max) before outputs and sums are added up.
+template <typename T>
+void finish_rows(T *attn_val, const float *acc, const float *row_max, const float *row_sum, size_t splits, size_t split_stride,
+                 size_t nhead, size_t nkvhead, size_t dv, size_t h_kv, size_t i0, size_t i1) {
+    size_t group = nhead / nkvhead;
+    size_t rows = (i1 - i0) * group;
+    thread_local std::vector<float> out;
+    out.resize(dv);
+
+    for (size_t r = 0; r < rows; r++) {
+        float max = -std::numeric_limits<float>::infinity();
+        for (size_t s = 0; s < splits; s++) {
+            max = std::max(max, row_max[s * split_stride + r]);
+        }
+        float sum = 0.0f;
+        std::fill(out.begin(), out.end(), 0.0f);
+        for (size_t s = 0; s < splits; s++) {
+            // Splits entirely past this row's causal limit hold no keys.
+            if (row_sum[s * split_stride + r] == 0.0f) {
+                continue;
+            }
+            float weight = std::exp(row_max[s * split_stride + r] - max);
+            sum += weight * row_sum[s * split_stride + r];
+            scale_axpy(out.data(), 1.0f, weight, acc + (s * split_stride + r) * dv, dv);
+        }
+        float inv = 1.0f / sum;
+        for (size_t m = 0; m < dv; m++) {
+            out[m] *= inv;
+        }
+        size_t h_q = h_kv * group + r % group;
+        llaisys::utils::cast(attn_val + ((i0 + r / group) * nhead + h_q) * dv, out.data(), dv);
+    }
+}
+
+// Causal attention over a packed batch of sequences. The queries of sequence
+// s are rows [cu_seqlens_q[s], cu_seqlens_q[s + 1]) of q and attn_val; they
+// are the last tokens of the batch.kvLen(s) keys in batch.kv(s), so the mask
+// of every sequence is aligned to its own past length and no row is padding.
+template <typename T, typename Batch>
+void varlen_attention(T *attn_val, const T *q, const Batch &batch, const int64_t *cu_seqlens_q, size_t nseq, float scale,
+                      size_t nhead, size_t d, size_t nkvhead, size_t dv) {
+    size_t group = nhead / nkvhead;
+    size_t bq = std::max<size_t>(1, TILE_ROWS / group);
+    size_t max_rows = bq * group;
+
+    // Tiles [tile_begin[s], tile_begin[s + 1]) cover the (query block, kv
+    // head) pairs of sequence s.
+    // The workers read the caller's copy through this reference.
+    thread_local std::vector<size_t> tile_begin_buffer;
+    std::vector<size_t> &tile_begin = tile_begin_buffer;
+    tile_begin.assign(nseq + 1, 0);
+    size_t max_kv_len = 0;
+    for (size_t s = 0; s < nseq; s++) {
+        size_t seqlen = static_cast<size_t>(cu_seqlens_q[s + 1] - cu_seqlens_q[s]);
+        tile_begin[s + 1] = tile_begin[s] + (seqlen + bq - 1) / bq * nkvhead;
+        max_kv_len = std::max(max_kv_len, batch.kvLen(s));
+    }
+    size_t tiles = tile_begin[nseq];
+    if (tiles == 0) {
+        return;
+    }
+
+    struct Tile {
+        size_t seq, h_kv, i0, i1, seqlen, total_len;
+    };
+    auto tile_at = [&](size_t tile) {
+        size_t s = std::upper_bound(tile_begin.begin(), tile_begin.begin() + nseq + 1, tile) - tile_begin.begin() - 1;
+        size_t local = tile - tile_begin[s];
+        size_t seqlen = static_cast<size_t>(cu_seqlens_q[s + 1] - cu_seqlens_q[s]);
+        size_t i0 = (local / nkvhead) * bq;
+        return Tile{s, local % nkvhead, i0, std::min(seqlen, i0 + bq), seqlen, batch.kvLen(s)};
+    };
+    auto q_of = [&](const Tile &t) { return q + static_cast<size_t>(cu_seqlens_q[t.seq]) * nhead * d; };
+    auto out_of = [&](const Tile &t) { return attn_val + static_cast<size_t>(cu_seqlens_q[t.seq]) * nhead * dv; };
+
+    // Decode (and other short query batches) leaves threads idle with one task
+    // per (query block, kv head); split the KV sequences across them instead.
+    size_t threads = llaisys::core::threadPool().numThreads();
+    size_t splits = 1;
+    if (tiles < threads) {
+        splits = std::min((threads + tiles - 1) / tiles, std::max<size_t>(1, max_kv_len / MIN_SPLIT_KEYS));
+    }
+
+    if (splits == 1) {
+        // One task per tile: heads of a group share the K/V tiles.
+        llaisys::core::parallel_for(tiles, 1, [&](size_t begin, size_t end) {
+            thread_local std::vector<float> acc, row_max, row_sum;
+            acc.resize(max_rows * dv);
+            row_max.resize(max_rows);
+            row_sum.resize(max_rows);
+            for (size_t tile = begin; tile < end; tile++) {
+                Tile t = tile_at(tile);
+                attend_range(RowState{acc.data(), row_max.data(), row_sum.data()}, q_of(t), batch.kv(t.seq), scale, t.seqlen, nhead, d,
+                             t.total_len, nkvhead, dv, t.h_kv, t.i0, t.i1, 0, t.total_len);
+                finish_rows(out_of(t), acc.data(), row_max.data(), row_sum.data(), 1, max_rows, nhead, nkvhead, dv, t.h_kv, t.i0, t.i1);
+            }
+        });
+        return;
+    }
+
+    // Partial states per (tile, split), laid out as [tile][split][row]. Each
+    // sequence divides its own keys into `splits` chunks. Like tile_begin,
+    // they live in the caller's thread and the workers use its copies.
+    thread_local std::vector<float> acc_buffer, row_max_buffer, row_sum_buffer;
+    std::vector<float> &acc = acc_buffer;
+    std::vector<float> &row_max = row_max_buffer;
+    std::vector<float> &row_sum = row_sum_buffer;
+    acc.resize(tiles * splits * max_rows * dv);
+    row_max.resize(tiles * splits * max_rows);
+    row_sum.resize(tiles * splits * max_rows);
+    llaisys::core::parallel_for(tiles * splits, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Tile t = tile_at(i / splits);
+            size_t split = i % splits;
+            size_t chunk = (t.total_len + splits - 1) / splits;
+            size_t offset = i * max_rows;
+            RowState state{acc.data() + offset * dv, row_max.data() + offset, row_sum.data() + offset};
+            attend_range(state, q_of(t), batch.kv(t.seq), scale, t.seqlen, nhead, d, t.total_len, nkvhead, dv, t.h_kv, t.i0, t.i1,
+                         std::min(t.total_len, split * chunk), std::min(t.total_len, (split + 1) * chunk));
+        }
+    });
+
+    llaisys::core::parallel_for(tiles, 1, [&](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++) {
+            Tile t = tile_at(tile);
+            size_t offset = tile * splits * max_rows;
+            finish_rows(out_of(t), acc.data() + offset * dv, row_max.data() + offset, row_sum.data() + offset, splits, max_rows,
+                        nhead, nkvhead, dv, t.h_kv, t.i0, t.i1);
+        }
+    });
+}
+
+// A batch of one sequence whose queries are the last seqlen of total_len keys.
+template <typename KV>
+struct SingleBatch {
+    KV keys;
+    size_t total_len;
+
+    size_t kvLen(size_t) const { return total_len; }
+    const KV &kv(size_t) const { return keys; }
+};
+
+// Sequences whose K/V rows are packed back to back as [total_k, nkvhead, d];
+// sequence s owns rows [cu_seqlens_k[s], cu_seqlens_k[s + 1]).
+template <typename T>
+struct PackedBatch {
+    const T *k;
+    const T *v;
+    const int64_t *cu_seqlens_k;
+    size_t nkvhead, d, dv;
+
+    size_t kvLen(size_t s) const { return static_cast<size_t>(cu_seqlens_k[s + 1] - cu_seqlens_k[s]); }
+    ContiguousKV<T> kv(size_t s) const {
+        size_t row = static_cast<size_t>(cu_seqlens_k[s]) * nkvhead;
+        return ContiguousKV<T>{k + row * d, v + row * dv, nkvhead, d, dv};
+    }
+};
+
+// Sequences sharing a paged cache; row s of block_tables, [nseq, max_blocks],
+// maps the first kv_lens[s] tokens of sequence s.
+template <typename T>
+struct PagedBatch {
+    const T *k;
+    const T *v;
+    const int64_t *block_tables;
+    const int64_t *kv_lens;
+    size_t max_blocks, block_size, nkvhead, d, dv;
+
+    size_t kvLen(size_t s) const { return static_cast<size_t>(kv_lens[s]); }
+    PagedKV<T> kv(size_t s) const { return PagedKV<T>{k, v, block_tables + s * max_blocks, block_size, nkvhead, d, dv}; }
+};
+
+template <typename T, typename KV>
+void attention(T *attn_val, const T *q, const KV &kv, float scale, size_t seqlen, size_t nhead, size_t d, size_t total_len, size_t nkvhead, size_t dv) {
+    int64_t cu_seqlens_q[2] = {0, static_cast<int64_t>(seqlen)};
+    varlen_attention(attn_val, q, SingleBatch<KV>{kv, total_len}, cu_seqlens_q, 1, scale, nhead, d, nkvhead, dv);
+}
+} // namespace llaisys::ops::cpu::flash
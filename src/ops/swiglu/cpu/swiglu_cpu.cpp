@@ -1,21 +1,14 @@
 #include "swiglu_cpu.hpp"
 
+#include "../../../core/thread_pool/thread_pool.hpp"
 #include "../../../utils.hpp"
-
-#include <cmath>
+#include "../../../utils/math.hpp"
 
 template <typename T>
 void swiglu_(T *out, const T *gate, const T *up, size_t size){
-    for (size_t i = 0; i < size; i++) {
-        if constexpr (std::is_same_v<T, llaisys::bf16_t> || std::is_same_v<T, llaisys::fp16_t>) {
-            float gate_i = llaisys::utils::cast<float>(gate[i]);
-            out[i] = llaisys::utils::cast<T>(
-                llaisys::utils::cast<float>(up[i]) * gate_i / (1+std::exp(-gate_i))
-            );
-        } else {
-            out[i] = up[i] * gate[i] / (1+std::exp(-gate[i]));
-        }
-    }
+    llaisys::core::parallel_for(size, 4096, [&](size_t begin, size_t end) {
+        llaisys::utils::silu_mul(out + begin, gate + begin, up + begin, end - begin);
+    });
 }
 
 namespace llaisys::ops::cpu {
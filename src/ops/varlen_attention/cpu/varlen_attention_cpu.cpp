@@ -0,0 +1,33 @@
+#include "varlen_attention_cpu.hpp"
+
+#include "../../self_attention/cpu/flash_attention.hpp"
+
+namespace {
+template <typename T>
+void varlen_attention_(T *attn_val, const T *q, const T *k, const T *v, const int64_t *cu_seqlens_q, const int64_t *cu_seqlens_k, float scale,
+                       size_t nseq, size_t nhead, size_t d, size_t nkvhead, size_t dv) {
+    llaisys::ops::cpu::flash::PackedBatch<T> batch{k, v, cu_seqlens_k, nkvhead, d, dv};
+    llaisys::ops::cpu::flash::varlen_attention(attn_val, q, batch, cu_seqlens_q, nseq, scale, nhead, d, nkvhead, dv);
+}
+} // namespace
+
+namespace llaisys::ops::cpu {
+void varlen_attention(std::byte *attn_val, const std::byte *q, const std::byte *k, const std::byte *v, const int64_t *cu_seqlens_q, const int64_t *cu_seqlens_k,
+                      llaisysDataType_t type, float scale, size_t nseq, size_t nhead, size_t d, size_t nkvhead, size_t dv) {
+    switch (type) {
+    case LLAISYS_DTYPE_F32:
+        return varlen_attention_(reinterpret_cast<float *>(attn_val), reinterpret_cast<const float *>(q), reinterpret_cast<const float *>(k),
+                                 reinterpret_cast<const float *>(v), cu_seqlens_q, cu_seqlens_k, scale, nseq, nhead, d, nkvhead, dv);
+    case LLAISYS_DTYPE_BF16:
+        return varlen_attention_(reinterpret_cast<llaisys::bf16_t *>(attn_val), reinterpret_cast<const llaisys::bf16_t *>(q),
+                                 reinterpret_cast<const llaisys::bf16_t *>(k), reinterpret_cast<const llaisys::bf16_t *>(v), cu_seqlens_q, cu_seqlens_k,
+                                 scale, nseq, nhead, d, nkvhead, dv);
+    case LLAISYS_DTYPE_F16:
+        return varlen_attention_(reinterpret_cast<llaisys::fp16_t *>(attn_val), reinterpret_cast<const llaisys::fp16_t *>(q),
+                                 reinterpret_cast<const llaisys::fp16_t *>(k), reinterpret_cast<const llaisys::fp16_t *>(v), cu_seqlens_q, cu_seqlens_k,
+                                 scale, nseq, nhead, d, nkvhead, dv);
+    default:
+        EXCEPTION_UNSUPPORTED_DATATYPE(type);
+    }
+}
+} // namespace llaisys::ops::cpu
@@ -0,0 +1,10 @@
+#pragma once
+#include "llaisys.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace llaisys::ops::cpu {
+void varlen_attention(std::byte *attn_val, const std::byte *q, const std::byte *k, const std::byte *v, const int64_t *cu_seqlens_q, const int64_t *cu_seqlens_k,
+                      llaisysDataType_t type, float scale, size_t nseq, size_t nhead, size_t d, size_t nkvhead, size_t dv);
+}
@@ -0,0 +1,52 @@
+#include "op.hpp"
+
+#include "../../core/llaisys_core.hpp"
+#include "../../utils.hpp"
+
+#include "cpu/varlen_attention_cpu.hpp"
+
+namespace llaisys::ops {
+void varlen_attention(tensor_t attn_val, tensor_t q, tensor_t k, tensor_t v, tensor_t cu_seqlens_q, tensor_t cu_seqlens_k, float scale) {
+    CHECK_SAME_DEVICE(attn_val, q, k, v, cu_seqlens_q, cu_seqlens_k);
+    CHECK_SAME_DTYPE(attn_val->dtype(), q->dtype(), k->dtype(), v->dtype());
+    ASSERT(cu_seqlens_q->dtype() == LLAISYS_DTYPE_I64 && cu_seqlens_k->dtype() == LLAISYS_DTYPE_I64, "Varlen Attention: offsets must be int64.");
+    ASSERT(attn_val->isContiguous() && q->isContiguous() && k->isContiguous() && v->isContiguous() && cu_seqlens_q->isContiguous()
+               && cu_seqlens_k->isContiguous(),
+           "Varlen Attention: all tensors must be contiguous.");
+    ASSERT(q->ndim() == 3 && attn_val->ndim() == 3 && k->ndim() == 3 && v->ndim() == 3 && cu_seqlens_q->ndim() == 1 && cu_seqlens_k->ndim() == 1,
+           "Varlen Attention: expected q [total_q, nhead, d], k/v [total_k, nkvhead, d] and 1-D offsets.");
+
+    size_t total_q = q->shape()[0], nhead = q->shape()[1], d = q->shape()[2];
+    size_t total_k = k->shape()[0], nkvhead = k->shape()[1], dv = v->shape()[2];
+    CHECK_ARGUMENT(k->shape()[2] == d && v->shape()[0] == total_k && v->shape()[1] == nkvhead && nhead % nkvhead == 0,
+                   "Varlen Attention: k and v shapes do not match q.");
+    CHECK_ARGUMENT(attn_val->shape()[0] == total_q && attn_val->shape()[1] == nhead && attn_val->shape()[2] == dv,
+                   "Varlen Attention: output shape does not match q and v.");
+    CHECK_ARGUMENT(cu_seqlens_q->numel() >= 2 && cu_seqlens_q->numel() == cu_seqlens_k->numel(),
+                   "Varlen Attention: cu_seqlens_q and cu_seqlens_k need nseq + 1 entries each.");
+    size_t nseq = cu_seqlens_q->numel() - 1;
+
+    llaisys::core::context().setDevice(q->deviceType(), q->deviceId());
+
+    switch (q->deviceType()) {
+    case LLAISYS_DEVICE_CPU: {
+        auto cu_q = reinterpret_cast<const int64_t *>(cu_seqlens_q->data());
+        auto cu_k = reinterpret_cast<const int64_t *>(cu_seqlens_k->data());
+        CHECK_ARGUMENT(cu_q[0] == 0 && cu_k[0] == 0 && static_cast<size_t>(cu_q[nseq]) == total_q && static_cast<size_t>(cu_k[nseq]) == total_k,
+                       "Varlen Attention: offsets must run from 0 to the number of rows.");
+        for (size_t s = 0; s < nseq; s++) {
+            CHECK_ARGUMENT(cu_q[s + 1] >= cu_q[s] && cu_k[s + 1] - cu_k[s] >= cu_q[s + 1] - cu_q[s],
+                           "Varlen Attention: every sequence needs at least as many keys as queries.");
+        }
+        return cpu::varlen_attention(attn_val->data(), q->data(), k->data(), v->data(), cu_q, cu_k, q->dtype(), scale, nseq, nhead, d, nkvhead, dv);
+    }
+#ifdef ENABLE_NVIDIA_API
+    case LLAISYS_DEVICE_NVIDIA:
+        TO_BE_IMPLEMENTED();
+        return;
+#endif
+    default:
+        EXCEPTION_UNSUPPORTED_DEVICE;
+    }
+}
+} // namespace llaisys::ops
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "../../tensor/tensor.hpp"
+
+namespace llaisys::ops {
+// Causal attention over several sequences packed without padding. q and
+// attn_val are [total_q, nhead, d], k and v [total_k, nkvhead, d]; sequence s
+// owns query rows [cu_seqlens_q[s], cu_seqlens_q[s + 1]) and key rows
+// [cu_seqlens_k[s], cu_seqlens_k[s + 1]). Its queries are the last tokens of
+// its keys, so its past length is the difference of the two lengths.
+void varlen_attention(tensor_t attn_val, tensor_t q, tensor_t k, tensor_t v, tensor_t cu_seqlens_q, tensor_t cu_seqlens_k, float scale);
+}
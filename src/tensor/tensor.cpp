@@ -36,6 +36,22 @@ tensor_t Tensor::create(const std::vector<size_t> &shape,
     }
 }
 
+tensor_t Tensor::create(const std::vector<size_t> &shape,
+                        llaisysDataType_t dtype,
+                        core::storage_t storage,
+                        size_t offset) {
+    size_t ndim_ = shape.size();
+    std::vector<ptrdiff_t> strides(ndim_);
+    size_t stride = 1;
+    for (size_t i = 1; i <= ndim_; i++) {
+        strides[ndim_ - i] = stride;
+        stride *= shape[ndim_ - i];
+    }
+    CHECK_ARGUMENT(offset + stride * utils::dsize(dtype) <= storage->size(), "Tensor: view exceeds its storage.");
+    TensorMeta meta{dtype, shape, strides};
+    return std::shared_ptr<Tensor>(new Tensor(meta, std::move(storage), offset));
+}
+
 std::byte *Tensor::data() {
     return _storage->memory() + _offset;
 }
@@ -197,7 +213,7 @@ tensor_t Tensor::permute(const std::vector<size_t> &order) const {
         new_meta.shape[i] = _meta.shape[order[i]];
         new_meta.strides[i] = _meta.strides[order[i]];
     }
-    return std::shared_ptr<Tensor>(new Tensor(new_meta, _storage));
+    return std::shared_ptr<Tensor>(new Tensor(new_meta, _storage, _offset));
 }
 
 tensor_t Tensor::view(const std::vector<size_t> &shape) const {
@@ -232,7 +248,7 @@ tensor_t Tensor::view(const std::vector<size_t> &shape) const {
             new_meta.strides[new_ndim-i] = stride;
             stride *= static_cast<ptrdiff_t>(shape[new_ndim-i]);
         }
-        return std::shared_ptr<Tensor>(new Tensor(new_meta, _storage));
+        return std::shared_ptr<Tensor>(new Tensor(new_meta, _storage, _offset));
     }
 }
 
@@ -247,7 +263,8 @@ tensor_t Tensor::slice(size_t dim, size_t start, size_t end) const {
 }
 
 void Tensor::load(const void *src_) {
-    size_t total_size = this->_storage->size();
+    ASSERT(this->isContiguous(), "Tensor: load needs a contiguous tensor.");
+    size_t total_size = this->numel() * this->elementSize();
     if (this->deviceType() == LLAISYS_DEVICE_CPU) {
         // device_type是CPU(HOST TO HOST)
         core::context().runtime().api()->memcpy_sync(
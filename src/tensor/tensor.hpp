@@ -25,6 +25,12 @@ public:
         llaisysDataType_t dtype,
         llaisysDeviceType_t device_type = LLAISYS_DEVICE_CPU,
         int device = 0);
+    // Contiguous tensor over existing storage, starting `offset` bytes in.
+    static tensor_t create(
+        const std::vector<size_t> &shape,
+        llaisysDataType_t dtype,
+        core::storage_t storage,
+        size_t offset);
     ~Tensor() = default;
     // Info
     std::byte *data();
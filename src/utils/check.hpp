@@ -1,3 +1,4 @@
+#pragma once
 #include <iostream>
 #include <stdexcept>
 
@@ -43,13 +44,19 @@
         throw std::runtime_error("Unimplemented function");                                   \
     } while (0)
 
-#define CHECK_SAME(ERR, FIRST, ...)                \
-    do {                                           \
-        for (const auto &arg___ : {__VA_ARGS__}) { \
-            if (FIRST != arg___) {                 \
-                { ERR; }                           \
-            }                                      \
-        }                                          \
+namespace llaisys::utils {
+// Compares in place; an initializer list would copy every shape vector.
+template <typename T, typename... Ts>
+bool all_same(const T &first, const Ts &...rest) {
+    return ((first == rest) && ...);
+}
+} // namespace llaisys::utils
+
+#define CHECK_SAME(ERR, FIRST, ...)                              \
+    do {                                                         \
+        if (!::llaisys::utils::all_same(FIRST, __VA_ARGS__)) {   \
+            { ERR; }                                             \
+        }                                                        \
     } while (0)
 
 #define EXCEPTION_SHAPE_MISMATCH                                                       \
@@ -0,0 +1,75 @@
+#include "math.hpp"
+
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace llaisys::utils {
+namespace {
+template <typename T>
+void silu_mul_(T *out, const T *gate, const T *up, size_t n) {
+    size_t i = 0;
+#if defined(LLAISYS_AVX512) || defined(LLAISYS_AVX2)
+    for (; i + simd::VLEN <= n; i += simd::VLEN) {
+        simd::store(out + i, simd::mul(simd::load(up + i), simd::silu(simd::load(gate + i))));
+    }
+    if (i < n) {
+        float g[simd::VLEN] = {}, u[simd::VLEN] = {}, o[simd::VLEN];
+        cast(g, gate + i, n - i);
+        cast(u, up + i, n - i);
+        simd::store(o, simd::mul(simd::load(u), simd::silu(simd::load(g))));
+        cast(out + i, o, n - i);
+    }
+#else
+    for (; i < n; i++) {
+        float g = cast<float>(gate[i]);
+        out[i] = cast<T>(cast<float>(up[i]) * (g / (1.0f + std::exp(-g))));
+    }
+#endif
+}
+} // namespace
+
+float exp_sum(float *x, size_t n, float shift, float scale) {
+    float total = 0.0f;
+#if defined(LLAISYS_AVX512) || defined(LLAISYS_AVX2)
+    simd::vec_t vscale = simd::set1(scale);
+    simd::vec_t vshift = simd::set1(-shift * scale);
+    simd::vec_t acc = simd::zero();
+    size_t i = 0;
+    for (; i + simd::VLEN <= n; i += simd::VLEN) {
+        simd::vec_t e = simd::exp(simd::fma(simd::load(x + i), vscale, vshift));
+        simd::store(x + i, e);
+        acc = simd::add(acc, e);
+    }
+    total = simd::hsum(acc);
+    if (i < n) {
+        float tail[simd::VLEN] = {};
+        std::copy(x + i, x + n, tail);
+        simd::store(tail, simd::exp(simd::fma(simd::load(tail), vscale, vshift)));
+        for (size_t j = 0; i + j < n; j++) {
+            x[i + j] = tail[j];
+            total += tail[j];
+        }
+    }
+#else
+    for (size_t i = 0; i < n; i++) {
+        x[i] = std::exp((x[i] - shift) * scale);
+        total += x[i];
+    }
+#endif
+    return total;
+}
+
+void silu_mul(float *out, const float *gate, const float *up, size_t n) {
+    silu_mul_(out, gate, up, n);
+}
+
+void silu_mul(bf16_t *out, const bf16_t *gate, const bf16_t *up, size_t n) {
+    silu_mul_(out, gate, up, n);
+}
+
+void silu_mul(fp16_t *out, const fp16_t *gate, const fp16_t *up, size_t n) {
+    silu_mul_(out, gate, up, n);
+}
+} // namespace llaisys::utils
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstddef>
+
+// Element-wise math over whole rows for CPU kernels, on top of the vector
+// exp / sigmoid / silu in simd.hpp (error bounds documented there). Tails go
+// through the same vector code, so an element's result never depends on
+// where a row was split; without SIMD these fall back to libm.
+namespace llaisys::utils {
+// x[i] = e^((x[i] - shift) * scale); returns the sum of the results.
+float exp_sum(float *x, size_t n, float shift, float scale = 1.0f);
+
+// out[i] = silu(gate[i]) * up[i], computed in f32 and rounded once. out may
+// be gate or up.
+void silu_mul(float *out, const float *gate, const float *up, size_t n);
+void silu_mul(bf16_t *out, const bf16_t *gate, const bf16_t *up, size_t n);
+void silu_mul(fp16_t *out, const fp16_t *gate, const fp16_t *up, size_t n);
+} // namespace llaisys::utils
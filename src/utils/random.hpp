@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+namespace llaisys::utils {
+// xoshiro256** seeded through splitmix64. Unlike the std distributions its
+// output is fully specified, so a seed gives the same samples on every
+// platform. (<random> is also unusable next to llaisys.h on x86, where it
+// pulls in intrinsic headers that name a parameter `__C`.)
+class Rng {
+public:
+    explicit Rng(uint64_t seed = 0) {
+        this->seed(seed);
+    }
+
+    void seed(uint64_t seed) {
+        for (auto &s : _state) {
+            seed += 0x9E3779B97F4A7C15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            s = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = _rotl(_state[1] * 5, 7) * 9;
+        uint64_t t = _state[1] << 17;
+        _state[2] ^= _state[0];
+        _state[3] ^= _state[1];
+        _state[1] ^= _state[2];
+        _state[0] ^= _state[3];
+        _state[2] ^= t;
+        _state[3] = _rotl(_state[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, 1).
+    float uniform() {
+        return static_cast<float>(next() >> 40) * (1.0f / 16777216.0f);
+    }
+
+private:
+    static uint64_t _rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t _state[4];
+};
+} // namespace llaisys::utils
@@ -0,0 +1,179 @@
+#pragma once
+
+// Instruction set selection for CPU kernels. The `cpu-native` build option
+// compiles for the host ISA; kernels test these macros and otherwise fall back
+// to portable scalar code.
+#if defined(__AVX512F__)
+#define LLAISYS_AVX512
+#endif
+
+#if defined(__AVX2__) && ((defined(__FMA__) && defined(__F16C__)) || defined(_MSC_VER))
+#define LLAISYS_AVX2
+#endif
+
+#if defined(LLAISYS_AVX512) || defined(LLAISYS_AVX2)
+// Compiler intrinsic headers use `__C` as a parameter name, which clashes with
+// the macro from llaisys.h. GCC 12 also reports the deliberately undefined
+// pass-through operands of its AVX-512 intrinsics as uninitialized.
+#pragma push_macro("__C")
+#undef __C
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#pragma pop_macro("__C")
+#endif
+
+#include "types.hpp"
+
+namespace llaisys::utils::simd {
+// One f32 register: load() widens bf16/fp16/int8 on the fly and store() narrows
+// with round-to-nearest-even, so kernels can be written once for all dtypes.
+#if defined(LLAISYS_AVX512)
+constexpr size_t VLEN = 16;
+using vec_t = __m512;
+
+inline vec_t zero() { return _mm512_setzero_ps(); }
+inline vec_t set1(float x) { return _mm512_set1_ps(x); }
+inline vec_t add(vec_t a, vec_t b) { return _mm512_add_ps(a, b); }
+inline vec_t sub(vec_t a, vec_t b) { return _mm512_sub_ps(a, b); }
+inline vec_t mul(vec_t a, vec_t b) { return _mm512_mul_ps(a, b); }
+inline vec_t div(vec_t a, vec_t b) { return _mm512_div_ps(a, b); }
+inline vec_t max(vec_t a, vec_t b) { return _mm512_max_ps(a, b); }
+inline vec_t fma(vec_t a, vec_t b, vec_t c) { return _mm512_fmadd_ps(a, b, c); }
+inline float hsum(vec_t v) { return _mm512_reduce_add_ps(v); }
+inline float hmax(vec_t v) { return _mm512_reduce_max_ps(v); }
+inline vec_t abs(vec_t a) { return _mm512_abs_ps(a); }
+// neg where x < 0, pos elsewhere.
+inline vec_t where_negative(vec_t x, vec_t neg, vec_t pos) { return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, zero(), _CMP_LT_OQ), pos, neg); }
+// e^x within 2 ulp (Cephes polynomial). Results below 2^-126 round to
+// subnormals and reach 0 under x = -103.3; x is capped at 88 so that the
+// result stays finite.
+inline vec_t exp(vec_t x) {
+    x = _mm512_max_ps(_mm512_min_ps(x, set1(88.0f)), set1(-104.0f));
+    vec_t n = _mm512_roundscale_ps(mul(x, set1(1.44269504f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    vec_t r = _mm512_fnmadd_ps(n, set1(0.693359375f), x);
+    r = _mm512_fnmadd_ps(n, set1(-2.12194440e-4f), r);
+    vec_t p = fma(set1(1.9875691500e-4f), r, set1(1.3981999507e-3f));
+    p = fma(p, r, set1(8.3334519073e-3f));
+    p = fma(p, r, set1(4.1665795894e-2f));
+    p = fma(p, r, set1(1.6666665459e-1f));
+    p = fma(p, r, set1(5.0000001201e-1f));
+    p = fma(p, mul(r, r), add(r, set1(1.0f)));
+    // Rounds a subnormal result once.
+    return _mm512_scalef_ps(p, n);
+}
+
+inline vec_t load(const float *p) { return _mm512_loadu_ps(p); }
+inline vec_t load(const bf16_t *p) {
+    __m512i wide = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(wide, 16));
+}
+inline vec_t load(const fp16_t *p) { return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))); }
+inline vec_t load(const int8_t *p) { return _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)))); }
+
+inline void store(float *p, vec_t v) { _mm512_storeu_ps(p, v); }
+inline void store(bf16_t *p, vec_t v) {
+    // Not vcvtneps2bf16: it flushes subnormals, while this matches the scalar path bit for bit.
+    __m512i bits = _mm512_castps_si512(v);
+    __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(1));
+    __m512i rounded = _mm512_srli_epi32(_mm512_add_epi32(bits, _mm512_add_epi32(lsb, _mm512_set1_epi32(0x7FFF))), 16);
+    __m512i quiet_nan = _mm512_or_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(0x40));
+    __mmask16 is_nan = _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+    rounded = _mm512_mask_blend_epi32(is_nan, rounded, quiet_nan);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm512_cvtepi32_epi16(rounded));
+}
+inline void store(fp16_t *p, vec_t v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+#elif defined(LLAISYS_AVX2)
+constexpr size_t VLEN = 8;
+using vec_t = __m256;
+
+inline vec_t zero() { return _mm256_setzero_ps(); }
+inline vec_t set1(float x) { return _mm256_set1_ps(x); }
+inline vec_t add(vec_t a, vec_t b) { return _mm256_add_ps(a, b); }
+inline vec_t sub(vec_t a, vec_t b) { return _mm256_sub_ps(a, b); }
+inline vec_t mul(vec_t a, vec_t b) { return _mm256_mul_ps(a, b); }
+inline vec_t div(vec_t a, vec_t b) { return _mm256_div_ps(a, b); }
+inline vec_t max(vec_t a, vec_t b) { return _mm256_max_ps(a, b); }
+inline vec_t fma(vec_t a, vec_t b, vec_t c) { return _mm256_fmadd_ps(a, b, c); }
+inline float hsum(vec_t v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+inline float hmax(vec_t v) {
+    __m128 s = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_max_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+inline vec_t abs(vec_t a) { return _mm256_andnot_ps(set1(-0.0f), a); }
+inline vec_t where_negative(vec_t x, vec_t neg, vec_t pos) { return _mm256_blendv_ps(pos, neg, x); }
+inline vec_t exp(vec_t x) {
+    x = _mm256_max_ps(_mm256_min_ps(x, set1(88.0f)), set1(-104.0f));
+    vec_t n = _mm256_round_ps(mul(x, set1(1.44269504f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    vec_t r = _mm256_fnmadd_ps(n, set1(0.693359375f), x);
+    r = _mm256_fnmadd_ps(n, set1(-2.12194440e-4f), r);
+    vec_t p = fma(set1(1.9875691500e-4f), r, set1(1.3981999507e-3f));
+    p = fma(p, r, set1(8.3334519073e-3f));
+    p = fma(p, r, set1(4.1665795894e-2f));
+    p = fma(p, r, set1(1.6666665459e-1f));
+    p = fma(p, r, set1(5.0000001201e-1f));
+    p = fma(p, mul(r, r), add(r, set1(1.0f)));
+    // 2^n as two normal factors, so that a subnormal result is rounded once.
+    __m256i ni = _mm256_cvtps_epi32(n);
+    __m256i half = _mm256_srai_epi32(ni, 1);
+    __m256i bias = _mm256_set1_epi32(127);
+    vec_t scale_lo = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(half, bias), 23));
+    vec_t scale_hi = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_sub_epi32(ni, half), bias), 23));
+    return mul(mul(p, scale_lo), scale_hi);
+}
+
+inline vec_t load(const float *p) { return _mm256_loadu_ps(p); }
+inline vec_t load(const bf16_t *p) {
+    __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16));
+}
+inline vec_t load(const fp16_t *p) { return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))); }
+inline vec_t load(const int8_t *p) { return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)))); }
+
+inline void store(float *p, vec_t v) { _mm256_storeu_ps(p, v); }
+inline void store(bf16_t *p, vec_t v) {
+    __m256i bits = _mm256_castps_si256(v);
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+    __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(bits, _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7FFF))), 16);
+    __m256i quiet_nan = _mm256_or_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(0x40));
+    __m256i is_nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+    rounded = _mm256_blendv_epi8(rounded, quiet_nan, is_nan);
+    // packus works per 128-bit lane; gather the two low quadwords afterwards.
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(rounded, rounded), 0xD8);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm256_castsi256_si128(packed));
+}
+inline void store(fp16_t *p, vec_t v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+#endif
+
+#if defined(LLAISYS_AVX512) || defined(LLAISYS_AVX2)
+// 1 / (1 + e^-x) within 3 ulp over all floats, subnormal results included:
+// negative x take e^x / (1 + e^x), which underflows to 0 along with e^x.
+inline vec_t sigmoid(vec_t x) {
+    vec_t one = set1(1.0f);
+    vec_t e = exp(sub(zero(), abs(x)));
+    vec_t r = div(one, add(one, e));
+    return where_negative(x, mul(e, r), r);
+}
+// x * sigmoid(x) within 4 ulp where sigmoid(x) is a normal float, that is
+// for x > -87.3. Below, the subnormal sigmoid's error is scaled by |x|, to at
+// most |x| * 2^-149, and the result goes to -0 as x does to -inf.
+inline vec_t silu(vec_t x) { return mul(x, sigmoid(x)); }
+#endif
+} // namespace llaisys::utils::simd
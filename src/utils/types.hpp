@@ -1,7 +1,11 @@
+#pragma once
 #include "llaisys.h"
 
+#include <cmath>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <type_traits>
 
 namespace llaisys {
 struct CustomFloat16 {
@@ -107,11 +111,68 @@ inline const char *dtype_to_str(llaisysDataType_t dtype) {
     }
 }
 
-float _f16_to_f32(fp16_t val);
-fp16_t _f32_to_f16(float val);
+// Scalar conversions. Both narrowing conversions round to nearest even and
+// keep NaNs quiet; they are branch-free so per-element use stays cheap.
+inline float _bits_to_f32(uint32_t bits) {
+    float val;
+    std::memcpy(&val, &bits, sizeof(val));
+    return val;
+}
+
+inline uint32_t _f32_to_bits(float val) {
+    uint32_t bits;
+    std::memcpy(&bits, &val, sizeof(bits));
+    return bits;
+}
 
-float _bf16_to_f32(bf16_t val);
-bf16_t _f32_to_bf16(float val);
+inline float _f16_to_f32(fp16_t val) {
+    const uint32_t w = static_cast<uint32_t>(val._v) << 16;
+    const uint32_t sign = w & 0x80000000u;
+    const uint32_t two_w = w + w;
+    // Normal numbers (and Inf/NaN): re-bias the exponent by scaling.
+    const float normalized = _bits_to_f32((two_w >> 4) + (0xE0u << 23)) * 0x1.0p-112f;
+    // Subnormals: place the mantissa under a 0.5 magic exponent and subtract it.
+    const float denormalized = _bits_to_f32((two_w >> 17) | (126u << 23)) - 0.5f;
+    const uint32_t bits = two_w < (1u << 27) ? _f32_to_bits(denormalized) : _f32_to_bits(normalized);
+    return _bits_to_f32(sign | bits);
+}
+
+inline fp16_t _f32_to_f16(float val) {
+    // Scaling up then down rounds the mantissa to fp16 precision (RNE) and
+    // flushes overflow to Inf in the FPU.
+    float base = (std::abs(val) * 0x1.0p+112f) * 0x1.0p-110f;
+    const uint32_t w = _f32_to_bits(val);
+    const uint32_t shl1_w = w + w;
+    const uint32_t sign = w & 0x80000000u;
+    uint32_t bias = shl1_w & 0xFF000000u;
+    if (bias < 0x71000000u) {
+        bias = 0x71000000u;
+    }
+    base = _bits_to_f32((bias >> 1) + 0x07800000u) + base;
+    const uint32_t bits = _f32_to_bits(base);
+    const uint32_t nonsign = ((bits >> 13) & 0x00007C00u) + (bits & 0x00000FFFu);
+    return fp16_t{static_cast<uint16_t>((sign >> 16) | (shl1_w > 0xFF000000u ? 0x7E00u : nonsign))};
+}
+
+inline float _bf16_to_f32(bf16_t val) {
+    return _bits_to_f32(static_cast<uint32_t>(val._v) << 16);
+}
+
+inline bf16_t _f32_to_bf16(float val) {
+    const uint32_t bits = _f32_to_bits(val);
+    if ((bits & 0x7FFFFFFFu) > 0x7F800000u) {
+        return bf16_t{static_cast<uint16_t>((bits >> 16) | 0x0040u)};
+    }
+    const uint32_t rounding_bias = 0x00007FFFu + ((bits >> 16) & 1);
+    return bf16_t{static_cast<uint16_t>((bits + rounding_bias) >> 16)};
+}
+
+// Bulk conversions over contiguous buffers, vectorized with F16C / AVX2 /
+// AVX-512 when the build targets them. Results match the scalar versions.
+void f16_to_f32(float *dst, const fp16_t *src, size_t n);
+void f32_to_f16(fp16_t *dst, const float *src, size_t n);
+void bf16_to_f32(float *dst, const bf16_t *src, size_t n);
+void f32_to_bf16(bf16_t *dst, const float *src, size_t n);
 
 template <typename TypeTo, typename TypeFrom>
 TypeTo cast(TypeFrom val) {
@@ -138,5 +199,26 @@ TypeTo cast(TypeFrom val) {
     }
 }
 
+// Converts n contiguous elements, e.g. a whole row of a bf16 tensor into an
+// f32 scratch buffer.
+template <typename TypeTo, typename TypeFrom>
+void cast(TypeTo *dst, const TypeFrom *src, size_t n) {
+    if constexpr (std::is_same<TypeTo, TypeFrom>::value) {
+        std::memcpy(dst, src, n * sizeof(TypeTo));
+    } else if constexpr (std::is_same<TypeTo, float>::value && std::is_same<TypeFrom, fp16_t>::value) {
+        f16_to_f32(dst, src, n);
+    } else if constexpr (std::is_same<TypeTo, float>::value && std::is_same<TypeFrom, bf16_t>::value) {
+        bf16_to_f32(dst, src, n);
+    } else if constexpr (std::is_same<TypeTo, fp16_t>::value && std::is_same<TypeFrom, float>::value) {
+        f32_to_f16(dst, src, n);
+    } else if constexpr (std::is_same<TypeTo, bf16_t>::value && std::is_same<TypeFrom, float>::value) {
+        f32_to_bf16(dst, src, n);
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = cast<TypeTo>(src[i]);
+        }
+    }
+}
+
 } // namespace utils
 } // namespace llaisys
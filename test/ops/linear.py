@@ -54,6 +54,8 @@ if __name__ == "__main__":
     args = parser.parse_args()
     testShapes = [
         ((2, 3), (2, 4), (3, 4), True),
+        ((67, 129), (67, 300), (129, 300), False),
+        ((5, 1536), (5, 1536), (1536, 1536), True),
         ((512, 4096), (512, 4096), (4096, 4096), True),
     ]
     testDtypePrec = [
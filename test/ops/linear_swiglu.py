@@ -0,0 +1,115 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, check_equal, benchmark
+from swiglu import torch_swiglu
+
+
+def torch_linear_swiglu(out, x, gate_up_w, gate_up_b):
+    n = gate_up_w.shape[0] // 2
+    gate_up = torch.nn.functional.linear(x, gate_up_w, gate_up_b)
+    torch_swiglu(out, gate_up[:, :n].contiguous(), gate_up[:, n:].contiguous())
+
+
+def torch_linear_residual(out, x, w, bias, residual):
+    torch.add(residual, torch.nn.functional.linear(x, w, bias), out=out)
+
+
+def test_op_linear_swiglu(
+    m,
+    k,
+    n,
+    use_bias=True,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+):
+    print(f"   swiglu m={m} k={k} n={n} bias {use_bias} dtype <{dtype_name}>")
+    x, x_ = random_tensor((m, k), dtype_name, device_name, scale=0.1)
+    w, w_ = random_tensor((2 * n, k), dtype_name, device_name, scale=0.1)
+
+    bias, bias_ = None, None
+    if use_bias:
+        bias, bias_ = random_tensor((2 * n,), dtype_name, device_name)
+
+    out, out_ = random_tensor((m, n), dtype_name, device_name)
+    torch_linear_swiglu(out, x, w, bias)
+    llaisys.Ops.linear_swiglu(out_, x_, w_, bias_)
+
+    assert check_equal(out_, out, atol=atol, rtol=rtol)
+
+    if profile:
+        benchmark(
+            lambda: torch_linear_swiglu(out, x, w, bias),
+            lambda: llaisys.Ops.linear_swiglu(out_, x_, w_, bias_),
+            device_name,
+        )
+
+
+def test_op_linear_residual(
+    m,
+    k,
+    n,
+    use_bias=True,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+):
+    print(f"   residual m={m} k={k} n={n} bias {use_bias} dtype <{dtype_name}>")
+    x, x_ = random_tensor((m, k), dtype_name, device_name, scale=0.1)
+    w, w_ = random_tensor((n, k), dtype_name, device_name, scale=0.01)
+
+    bias, bias_ = None, None
+    if use_bias:
+        bias, bias_ = random_tensor((n,), dtype_name, device_name)
+
+    # The residual is accumulated in place, as the model does.
+    out, out_ = random_tensor((m, n), dtype_name, device_name)
+    torch_linear_residual(out, x, w, bias, out.clone())
+    llaisys.Ops.linear(out_, x_, w_, bias_, residual=out_)
+
+    assert check_equal(out_, out, atol=atol, rtol=rtol)
+
+    if profile:
+        benchmark(
+            lambda: torch_linear_residual(out, x, w, bias, out),
+            lambda: llaisys.Ops.linear(out_, x_, w_, bias_, residual=out_),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        # (m, k, n, use_bias)
+        (1, 4, 3, True),
+        (5, 300, 129, False),
+        (67, 300, 129, True),
+        (512, 1536, 4096, False),
+    ]
+    testDtypePrec = [
+        # type, atol, rtol
+        ("f32", 1e-5, 1e-5),
+        ("f16", 1e-3, 1e-3),
+        ("bf16", 1e-2, 1e-2),
+    ]
+    print(f"Testing Ops.linear_swiglu and Ops.linear with residual on {args.device}")
+    for shapes in testShapes:
+        for dtype_name, atol, rtol in testDtypePrec:
+            test_op_linear_swiglu(*shapes, dtype_name, atol, rtol, args.device, args.profile)
+            test_op_linear_residual(*shapes, dtype_name, atol, rtol, args.device, args.profile)
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -0,0 +1,98 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, zero_tensor, check_equal, benchmark
+from rms_norm import torch_rms_norm
+from argmax import torch_argmax
+
+
+def torch_lm_head_logits(hidden, norm_w, out_embed, eps):
+    normed = torch.empty_like(hidden)
+    torch_rms_norm(normed, hidden, norm_w, eps)
+    return normed @ out_embed.T
+
+
+def torch_lm_head_topk(top_idx, top_val, hidden, norm_w, out_embed, eps):
+    logits = torch_lm_head_logits(hidden, norm_w, out_embed, eps)
+    torch.topk(logits, top_idx.shape[1], dim=-1, out=(top_val, top_idx))
+
+
+def read_back(torch_like, llaisys_tensor):
+    out = torch.zeros_like(torch_like)
+    api = llaisys.RuntimeAPI(llaisys_tensor.device_type())
+    api.memcpy_sync(
+        out.data_ptr(), llaisys_tensor.data_ptr(), out.numel() * out.element_size(), llaisys.MemcpyKind.D2D
+    )
+    return out
+
+
+def test_op_lm_head_topk(
+    m,
+    hs,
+    voc,
+    k,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+):
+    print(f"   m={m} hs={hs} voc={voc} k={k} dtype <{dtype_name}>")
+    hidden, hidden_ = random_tensor((m, hs), dtype_name, device_name, scale=2.0, bias=-1.0)
+    norm_w, norm_w_ = random_tensor((hs,), dtype_name, device_name)
+    out_embed, out_embed_ = random_tensor((voc, hs), dtype_name, device_name, scale=0.2, bias=-0.1)
+    eps = 1e-6
+
+    top_idx, top_idx_ = zero_tensor((m, k), "i64", device_name)
+    top_val, top_val_ = zero_tensor((m, k), dtype_name, device_name)
+    torch_lm_head_topk(top_idx, top_val, hidden, norm_w, out_embed, eps)
+    llaisys.Ops.lm_head_topk(top_idx_, top_val_, hidden_, norm_w_, out_embed_, eps)
+
+    # Rounding may reorder near ties, so the values are compared by rank and
+    # the ids through the logits they point at.
+    assert check_equal(top_val_, top_val, atol=atol, rtol=rtol)
+    logits = torch_lm_head_logits(hidden, norm_w, out_embed, eps)
+    ids = read_back(top_idx, top_idx_)
+    assert torch.allclose(logits.gather(1, ids), top_val, atol=atol, rtol=rtol)
+    assert all(len(set(row.tolist())) == k for row in ids)
+
+    if profile:
+        max_idx, max_idx_ = zero_tensor((m, 1), "i64", device_name)
+        max_val, max_val_ = zero_tensor((m, 1), dtype_name, device_name)
+        benchmark(
+            lambda: torch_argmax(max_idx, max_val, torch_lm_head_logits(hidden, norm_w, out_embed, eps)),
+            lambda: llaisys.Ops.lm_head_topk(max_idx_, max_val_, hidden_, norm_w_, out_embed_, eps),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        # (m, hs, voc, k)
+        (1, 64, 1000, 1),
+        (1, 256, 4096, 40),
+        (4, 128, 3001, 8),
+        (12, 128, 5000, 5),
+    ]
+    testDtypePrec = [
+        # type, atol, rtol
+        ("f32", 1e-4, 1e-4),
+        ("f16", 1e-2, 1e-2),
+        ("bf16", 5e-2, 5e-2),
+    ]
+    print(f"Testing Ops.lm_head_topk on {args.device}")
+    for m, hs, voc, k in testShapes:
+        for dtype_name, atol, rtol in testDtypePrec:
+            test_op_lm_head_topk(m, hs, voc, k, dtype_name, atol, rtol, args.device, args.profile)
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -0,0 +1,97 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import arrange_tensor, random_tensor, check_equal, benchmark, llaisys_device
+from rope import torch_rope
+
+
+def torch_qkv_rope(q, k_cache, v_cache, x, w, b, pos_ids, slots, theta):
+    m, nh, dh = q.shape
+    nkvh = k_cache.shape[-2]
+    qkv = torch.nn.functional.linear(x, w, b)
+    q_, k_, v_ = qkv.split([nh * dh, nkvh * dh, nkvh * dh], dim=-1)
+    k = torch.empty((m, nkvh, dh), dtype=q.dtype)
+    torch_rope(q, q_.reshape(m, nh, dh), pos_ids, theta)
+    torch_rope(k, k_.reshape(m, nkvh, dh), pos_ids, theta)
+    k_cache.view(-1, nkvh, dh)[slots] = k
+    v_cache.view(-1, nkvh, dh)[slots] = v_.reshape(m, nkvh, dh)
+
+
+def to_llaisys_i64(t, device_name):
+    t_ = llaisys.Tensor(tuple(t.shape), dtype=llaisys.DataType.I64, device=llaisys_device(device_name))
+    api = llaisys.RuntimeAPI(t_.device_type())
+    api.memcpy_sync(t_.data_ptr(), t.contiguous().data_ptr(), t.numel() * 8, llaisys.MemcpyKind.D2D)
+    return t_
+
+
+def test_op_qkv_rope(
+    m,
+    hs,
+    nh,
+    nkvh,
+    dh,
+    past,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+):
+    print(f"   m={m} hs={hs} nh={nh} nkvh={nkvh} dh={dh} past={past} dtype <{dtype_name}>")
+    nblocks, block_size = 8, 16
+    x, x_ = random_tensor((m, hs), dtype_name, device_name, scale=0.1)
+    w, w_ = random_tensor(((nh + 2 * nkvh) * dh, hs), dtype_name, device_name, scale=0.1)
+    b, b_ = random_tensor(((nh + 2 * nkvh) * dh,), dtype_name, device_name)
+    pos_ids, pos_ids_ = arrange_tensor(past, past + m, device_name)
+    slots = torch.randperm(nblocks * block_size)[:m]
+    slots_ = to_llaisys_i64(slots, device_name)
+    theta = 10000.0
+
+    q, q_ = random_tensor((m, nh, dh), dtype_name, device_name)
+    k_cache, k_cache_ = random_tensor((nblocks, block_size, nkvh, dh), dtype_name, device_name)
+    v_cache, v_cache_ = random_tensor((nblocks, block_size, nkvh, dh), dtype_name, device_name)
+    torch_qkv_rope(q, k_cache, v_cache, x, w, b, pos_ids, slots, theta)
+    llaisys.Ops.qkv_rope(q_, k_cache_, v_cache_, x_, w_, b_, pos_ids_, slots_, theta)
+
+    assert check_equal(q_, q, atol=atol, rtol=rtol)
+    assert check_equal(k_cache_, k_cache, atol=atol, rtol=rtol)
+    assert check_equal(v_cache_, v_cache, atol=atol, rtol=rtol)
+
+    if profile:
+        benchmark(
+            lambda: torch_qkv_rope(q, k_cache, v_cache, x, w, b, pos_ids, slots, theta),
+            lambda: llaisys.Ops.qkv_rope(q_, k_cache_, v_cache_, x_, w_, b_, pos_ids_, slots_, theta),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        # (m, hs, nh, nkvh, dh, past)
+        (1, 64, 4, 2, 16, 0),
+        (1, 1536, 12, 2, 128, 37),
+        (5, 256, 8, 4, 32, 100),
+        (64, 512, 8, 2, 64, 0),
+    ]
+    testDtypePrec = [
+        # type, atol, rtol
+        ("f32", 1e-4, 1e-4),
+        ("f16", 1e-2, 1e-2),
+        ("bf16", 5e-2, 5e-2),
+    ]
+    print(f"Testing Ops.qkv_rope on {args.device}")
+    for shapes in testShapes:
+        for dtype_name, atol, rtol in testDtypePrec:
+            test_op_qkv_rope(*shapes, dtype_name, atol, rtol, args.device, args.profile)
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -0,0 +1,66 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, zero_tensor, check_equal, benchmark
+
+
+def torch_quantize(w, groups):
+    n, k = w.shape
+    x = w.float().view(n, groups, k // groups)
+    scales = x.abs().amax(dim=-1) / 127
+    q = torch.round(x / scales.unsqueeze(-1)).clamp(-127, 127)
+    return q.to(torch.int8).view(n, k), scales
+
+
+def test_op_quantize(
+    n,
+    k,
+    groups,
+    dtype_name="f32",
+    device_name="cpu",
+    profile=False,
+):
+    print(f"   n={n} k={k} groups={groups} dtype <{dtype_name}>")
+    w, w_ = random_tensor((n, k), dtype_name, device_name, scale=2.0, bias=-1.0)
+    q, scales = torch_quantize(w, groups)
+
+    _, q_ = zero_tensor((n, k), "i8", device_name)
+    _, scales_ = zero_tensor((n, groups), "f32", device_name)
+    llaisys.Ops.quantize(q_, scales_, w_)
+
+    assert check_equal(scales_, scales, strict=True)
+    assert check_equal(q_, q, strict=True)
+
+    if profile:
+        benchmark(
+            lambda: torch_quantize(w, groups),
+            lambda: llaisys.Ops.quantize(q_, scales_, w_),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        # (n, k, groups)
+        (1, 4, 1),
+        (129, 300, 1),
+        (67, 256, 8),
+        (4096, 1536, 12),
+    ]
+    testDtype = ["f32", "f16", "bf16"]
+    print(f"Testing Ops.quantize on {args.device}")
+    for shapes in testShapes:
+        for dtype_name in testDtype:
+            test_op_quantize(*shapes, dtype_name, args.device, args.profile)
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -0,0 +1,135 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, random_int_tensor, zero_tensor, benchmark
+
+
+def torch_sample_probs(logits, prev_tokens, temperature, top_k, top_p, repetition_penalty, presence_penalty):
+    logits = logits.float().clone()
+    if prev_tokens is not None:
+        seen = prev_tokens.unique()
+        picked = logits[seen]
+        picked = torch.where(picked > 0, picked / repetition_penalty, picked * repetition_penalty)
+        logits[seen] = picked - presence_penalty
+    if temperature <= 0 or top_k == 1:
+        probs = torch.zeros_like(logits)
+        probs[logits.argmax()] = 1.0
+        return probs
+    vals, ids = torch.sort(logits, descending=True, stable=True)
+    if top_k > 0:
+        vals, ids = vals[:top_k], ids[:top_k]
+    probs = torch.softmax(vals / temperature, dim=-1)
+    if 0 < top_p < 1:
+        # The fewest tokens whose mass reaches top_p.
+        keep = int((probs.cumsum(0) < top_p).sum()) + 1
+        probs, ids = probs[:keep], ids[:keep]
+    out = torch.zeros_like(logits)
+    out[ids] = probs / probs.sum()
+    return out
+
+
+def llaisys_histogram(out_idx_, logits_, prev_tokens_, n, draws, **params):
+    counts = torch.zeros(n)
+    token = torch.zeros((1,), dtype=torch.int64)
+    api = llaisys.RuntimeAPI(out_idx_.device_type())
+    for seed in range(draws):
+        llaisys.Ops.sample(out_idx_, logits_, prev_tokens=prev_tokens_, seed=seed, **params)
+        api.memcpy_sync(token.data_ptr(), out_idx_.data_ptr(), 8, llaisys.MemcpyKind.D2D)
+        counts[token] += 1
+    return counts / draws
+
+
+def test_op_sample(
+    n,
+    temperature,
+    top_k,
+    top_p,
+    repetition_penalty=1.0,
+    presence_penalty=0.0,
+    dtype_name="f32",
+    device_name="cpu",
+    draws=4000,
+    profile=False,
+):
+    print(
+        f"   n={n} temperature={temperature} top_k={top_k} top_p={top_p} "
+        f"repetition={repetition_penalty} presence={presence_penalty} dtype <{dtype_name}>"
+    )
+    logits, logits_ = random_tensor((n,), dtype_name, device_name, scale=6.0, bias=-3.0)
+    prev_tokens, prev_tokens_ = random_int_tensor((8,), device_name, high=n)
+    out_idx, out_idx_ = zero_tensor((1,), "i64", device_name)
+    params = dict(
+        temperature=temperature,
+        top_k=top_k,
+        top_p=top_p,
+        repetition_penalty=repetition_penalty,
+        presence_penalty=presence_penalty,
+    )
+
+    expected = torch_sample_probs(logits, prev_tokens, **params)
+    got = llaisys_histogram(out_idx_, logits_, prev_tokens_, n, draws, **params)
+    assert (got[expected == 0] == 0).all(), "sampled a token outside the kept set"
+    # Total variation distance against the exact distribution.
+    assert 0.5 * (got - expected).abs().sum() < 0.1
+
+    if profile:
+        benchmark(
+            lambda: torch.multinomial(torch_sample_probs(logits, prev_tokens, **params), 1),
+            lambda: llaisys.Ops.sample(out_idx_, logits_, prev_tokens=prev_tokens_, **params),
+            device_name,
+        )
+
+
+def test_op_sample_candidates(dtype_name="f32", device_name="cpu"):
+    print(f"   candidates from lm_head_topk order dtype <{dtype_name}>")
+    n, k = 1000, 16
+    logits, logits_ = random_tensor((n,), dtype_name, device_name, scale=4.0)
+    top_val, top_idx = torch.topk(logits, k)
+    top_val_ = llaisys.Tensor((k,), dtype=logits_.dtype(), device=logits_.device_type())
+    top_idx_ = llaisys.Tensor((k,), dtype=llaisys.DataType.I64, device=logits_.device_type())
+    api = llaisys.RuntimeAPI(logits_.device_type())
+    api.memcpy_sync(top_val_.data_ptr(), top_val.contiguous().data_ptr(), k * top_val.element_size(), llaisys.MemcpyKind.D2D)
+    api.memcpy_sync(top_idx_.data_ptr(), top_idx.contiguous().data_ptr(), k * 8, llaisys.MemcpyKind.D2D)
+    _, out_idx_ = zero_tensor((1,), "i64", device_name)
+    token = torch.zeros((1,), dtype=torch.int64)
+    for seed in range(200):
+        llaisys.Ops.sample(out_idx_, top_val_, ids=top_idx_, temperature=1.0, seed=seed)
+        api.memcpy_sync(token.data_ptr(), out_idx_.data_ptr(), 8, llaisys.MemcpyKind.D2D)
+        assert int(token) in top_idx.tolist()
+    llaisys.Ops.sample(out_idx_, top_val_, ids=top_idx_, temperature=0.0)
+    api.memcpy_sync(token.data_ptr(), out_idx_.data_ptr(), 8, llaisys.MemcpyKind.D2D)
+    assert int(token) == int(top_idx[0])
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testCases = [
+        # (n, temperature, top_k, top_p, repetition_penalty, presence_penalty)
+        (64, 0.0, 0, 1.0, 1.3, 0.5),
+        (64, 1.0, 0, 1.0, 1.0, 0.0),
+        (100, 0.7, 10, 1.0, 1.0, 0.0),
+        (100, 1.0, 0, 0.8, 1.0, 0.0),
+        (1000, 0.8, 20, 0.9, 1.0, 0.0),
+        (100, 1.0, 0, 1.0, 1.5, 0.0),
+        (100, 1.0, 8, 0.95, 1.2, 1.0),
+    ]
+    testDtype = ["f32", "f16", "bf16"]
+    print(f"Testing Ops.sample on {args.device}")
+    for n, temperature, top_k, top_p, repetition, presence in testCases:
+        for dtype_name in testDtype:
+            test_op_sample(
+                n, temperature, top_k, top_p, repetition, presence, dtype_name, args.device, profile=args.profile
+            )
+    for dtype_name in testDtype:
+        test_op_sample_candidates(dtype_name, args.device)
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -72,6 +72,8 @@ if __name__ == "__main__":
         # qlen, kvlen, nh, nkvh, hd
         (2, 2, 1, 1, 4),
         (5, 11, 4, 2, 8),
+        (70, 200, 8, 2, 32),
+        (1, 1000, 12, 2, 64),
     ]
     testDtypePrec = [
         # type, atol, rtol
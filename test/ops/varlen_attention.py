@@ -0,0 +1,122 @@
+import sys
+import os
+
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, parent_dir)
+import llaisys
+import torch
+from test_utils import random_tensor, check_equal, benchmark, torch_device, llaisys_device, llaisys_dtype
+from self_attention import torch_self_attention
+
+
+def int_tensor(values, device_name, shape=None):
+    torch_tensor = torch.tensor(values, dtype=torch.int64, device=torch_device(device_name))
+    if shape is not None:
+        torch_tensor = torch_tensor.reshape(shape)
+    llaisys_tensor = llaisys.Tensor(
+        tuple(torch_tensor.shape), dtype=llaisys_dtype("i64"), device=llaisys_device(device_name)
+    )
+    api = llaisys.RuntimeAPI(llaisys_device(device_name))
+    api.memcpy_sync(
+        llaisys_tensor.data_ptr(),
+        torch_tensor.data_ptr(),
+        torch_tensor.numel() * torch_tensor.element_size(),
+        llaisys.MemcpyKind.D2D,
+    )
+    return torch_tensor, llaisys_tensor
+
+
+def torch_varlen_attention(attn_val, query, key, value, cu_seqlens_q, cu_seqlens_k, scale):
+    for s in range(len(cu_seqlens_q) - 1):
+        q0, q1 = cu_seqlens_q[s], cu_seqlens_q[s + 1]
+        k0, k1 = cu_seqlens_k[s], cu_seqlens_k[s + 1]
+        torch_self_attention(attn_val[q0:q1], query[q0:q1], key[k0:k1], value[k0:k1], scale)
+
+
+def test_op_varlen_attention(
+    lens,
+    nh,
+    nkvh,
+    hd,
+    block_size,
+    dtype_name="f32",
+    atol=1e-5,
+    rtol=1e-5,
+    device_name="cpu",
+    profile=False,
+):
+    print(f"   lens={lens} nh={nh} nkvh={nkvh} hd={hd} dtype <{dtype_name}>")
+    cu_q, cu_k = [0], [0]
+    for qlen, kvlen in lens:
+        cu_q.append(cu_q[-1] + qlen)
+        cu_k.append(cu_k[-1] + kvlen)
+    q, q_ = random_tensor((cu_q[-1], nh, hd), dtype_name, device_name)
+    k, k_ = random_tensor((cu_k[-1], nkvh, hd), dtype_name, device_name)
+    v, v_ = random_tensor((cu_k[-1], nkvh, hd), dtype_name, device_name)
+    _, cu_q_ = int_tensor(cu_q, device_name)
+    _, cu_k_ = int_tensor(cu_k, device_name)
+    scale = 1.0 / (hd**0.5)
+
+    attn_val, attn_val_ = random_tensor((cu_q[-1], nh, hd), dtype_name, device_name)
+    torch_varlen_attention(attn_val, q, k, v, cu_q, cu_k, scale)
+    llaisys.Ops.varlen_attention(attn_val_, q_, k_, v_, cu_q_, cu_k_, scale)
+    assert check_equal(attn_val_, attn_val, atol=atol, rtol=rtol)
+
+    # The same batch read from a paged cache, each sequence in its own blocks.
+    nseq = len(lens)
+    max_blocks = max((kvlen + block_size - 1) // block_size for _, kvlen in lens)
+    block_tables = torch.randperm(nseq * max_blocks).reshape(nseq, max_blocks)
+    k_cache = torch.zeros((nseq * max_blocks, block_size, nkvh, hd), dtype=k.dtype, device=k.device)
+    v_cache = torch.zeros_like(k_cache)
+    for s, (_, kvlen) in enumerate(lens):
+        blocks = block_tables[s]
+        for j in range(kvlen):
+            k_cache[blocks[j // block_size], j % block_size] = k[cu_k[s] + j]
+            v_cache[blocks[j // block_size], j % block_size] = v[cu_k[s] + j]
+    k_cache_ = llaisys.Tensor(tuple(k_cache.shape), dtype=llaisys_dtype(dtype_name), device=llaisys_device(device_name))
+    v_cache_ = llaisys.Tensor(tuple(v_cache.shape), dtype=llaisys_dtype(dtype_name), device=llaisys_device(device_name))
+    api = llaisys.RuntimeAPI(llaisys_device(device_name))
+    for dst, src in ((k_cache_, k_cache), (v_cache_, v_cache)):
+        api.memcpy_sync(dst.data_ptr(), src.data_ptr(), src.numel() * src.element_size(), llaisys.MemcpyKind.D2D)
+    _, block_tables_ = int_tensor(block_tables.flatten().tolist(), device_name, (nseq, max_blocks))
+    _, kv_lens_ = int_tensor([kvlen for _, kvlen in lens], device_name)
+
+    paged_val, paged_val_ = random_tensor((cu_q[-1], nh, hd), dtype_name, device_name)
+    llaisys.Ops.paged_varlen_attention(paged_val_, q_, k_cache_, v_cache_, block_tables_, cu_q_, kv_lens_, scale)
+    assert check_equal(paged_val_, attn_val, atol=atol, rtol=rtol)
+
+    if profile:
+        benchmark(
+            lambda: torch_varlen_attention(attn_val, q, k, v, cu_q, cu_k, scale),
+            lambda: llaisys.Ops.varlen_attention(attn_val_, q_, k_, v_, cu_q_, cu_k_, scale),
+            device_name,
+        )
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--profile", action="store_true")
+    args = parser.parse_args()
+    testShapes = [
+        # [(qlen, kvlen) per sequence], nh, nkvh, hd, block_size
+        ([(5, 11), (1, 1), (7, 7), (1, 300)], 4, 2, 8, 16),
+        ([(1, 40), (1, 900), (1, 3)], 8, 2, 32, 16),
+        ([(70, 200), (3, 3)], 12, 2, 32, 4),
+    ]
+    testDtypePrec = [
+        # type, atol, rtol
+        ("f32", 1e-5, 1e-5),
+        ("f16", 1e-3, 1e-3),
+        ("bf16", 1e-2, 1e-2),
+    ]
+    print(f"Testing Ops.varlen_attention on {args.device}")
+    for shape in testShapes:
+        for dtype_name, atol, rtol in testDtypePrec:
+            test_op_varlen_attention(
+                *shape, dtype_name, atol, rtol, args.device, args.profile
+            )
+
+    print("\033[92mTest passed!\033[0m\n")
@@ -0,0 +1,181 @@
+import argparse
+import os
+
+import numpy as np
+
+import llaisys
+from test_utils import llaisys_device
+
+
+def load_model_path(model_path=None):
+    model_id = "deepseek-ai/DeepSeek-R1-Distill-Qwen-1.5B"
+
+    if model_path and os.path.isdir(model_path):
+        return model_path
+    from huggingface_hub import snapshot_download
+
+    return snapshot_download(model_id)
+
+
+def random_prompt(model, length, seed=0):
+    rng = np.random.default_rng(seed)
+    return [int(t) for t in rng.integers(0, model.meta.voc, length)]
+
+
+def test_preemption(model_path, device_name, max_new_tokens=32):
+    print("Testing preemption...")
+    # A small cache so that a second sequence can take every free block.
+    model = llaisys.models.Qwen2(model_path, llaisys_device(device_name), max_seq_len=128)
+    model.set_prefix_caching(False)
+    prompt = random_prompt(model, 20)
+    for sampling in ({"top_k": 1}, {"top_k": 20, "temperature": 0.9, "seed": 7}):
+        expected = model.generate(prompt, max_new_tokens=max_new_tokens, **sampling)
+        expected = expected[len(prompt) :]
+
+        model.submit(prompt, max_new_tokens=max_new_tokens, **sampling)
+        tokens = [token for _, token, _ in model.schedule_step()]
+        hog = model.create_sequence()
+        assert model.step([(hog, [0] * model.free_kv_tokens())]) is not None
+        preempted = False
+        while model.pending():
+            events = model.schedule_step()
+            if not events and hog is not None:
+                model.release_sequence(hog)
+                hog = None
+                preempted = True
+            tokens += [token for _, token, _ in events]
+
+        assert preempted
+        assert tokens == expected, f"{sampling}: {tokens} != {expected}"
+    print("     Passed")
+
+
+def run_requests(model, prompts, max_new_tokens, **sampling):
+    """Serves the prompts through the scheduler and returns their outputs."""
+    ids = [model.submit(prompt, max_new_tokens=max_new_tokens, **sampling) for prompt in prompts]
+    outputs = {request: [] for request in ids}
+    while model.pending():
+        for request, token, _ in model.schedule_step():
+            outputs[request].append(token)
+    return [outputs[request] for request in ids]
+
+
+def test_prefix_caching(model_path, device_name, max_new_tokens=16):
+    print("Testing prefix caching...")
+    model = llaisys.models.Qwen2(model_path, llaisys_device(device_name), max_seq_len=512)
+    free = model.free_kv_tokens()
+    # Two full KV blocks of shared prefix, then different suffixes.
+    prefix = random_prompt(model, 40, seed=1)
+    prompts = [prefix + random_prompt(model, 5, seed=2), prefix + random_prompt(model, 7, seed=3)]
+
+    model.set_prefix_caching(False)
+    expected = [run_requests(model, [prompt], max_new_tokens)[0] for prompt in prompts]
+    model.set_prefix_caching(True)
+    cached = [run_requests(model, [prompt], max_new_tokens)[0] for prompt in prompts]
+    assert cached == expected, f"{cached} != {expected}"
+
+    model.set_prefix_caching(False)
+    assert model.free_kv_tokens() == free, f"{model.free_kv_tokens()} != {free}"
+    print("     Passed")
+
+
+def test_batched_step(model_path, device_name, max_new_tokens=16):
+    print("Testing batched step...")
+    model = llaisys.models.Qwen2(model_path, llaisys_device(device_name), max_seq_len=256)
+    prompts = [random_prompt(model, n, seed=n) for n in (3, 17, 30)]
+    expected = [model.generate(prompt, max_new_tokens=max_new_tokens)[len(prompt) :] for prompt in prompts]
+
+    seqs = [model.create_sequence() for _ in prompts]
+    outputs = [[] for _ in prompts]
+    # Prefills and decodes share steps: the last sequence joins one step late.
+    feed = {seqs[0]: prompts[0], seqs[1]: prompts[1]}
+    for step in range(max_new_tokens + 1):
+        if step == 1:
+            feed[seqs[2]] = prompts[2]
+        batch = [(seq, tokens) for seq, tokens in feed.items()]
+        tokens = model.step(batch)
+        assert tokens is not None
+        feed = {}
+        for (seq, _), token in zip(batch, tokens):
+            i = seqs.index(seq)
+            if len(outputs[i]) < max_new_tokens:
+                outputs[i].append(token)
+                feed[seq] = [token]
+    for seq in seqs:
+        model.release_sequence(seq)
+
+    assert outputs == expected, f"{outputs} != {expected}"
+    print("     Passed")
+
+
+def test_chunked_prefill(model_path, device_name, max_new_tokens=16):
+    print("Testing chunked prefill...")
+    model = llaisys.models.Qwen2(model_path, llaisys_device(device_name), max_seq_len=256)
+    model.set_prefix_caching(False)
+    prompts = [random_prompt(model, 50, seed=4), random_prompt(model, 9, seed=5)]
+    expected = [model.generate(prompt, max_new_tokens=max_new_tokens)[len(prompt) :] for prompt in prompts]
+
+    # Smaller than either prompt, so both are split across steps.
+    model.set_chunk_tokens(8)
+    outputs = run_requests(model, prompts, max_new_tokens)
+    assert outputs == expected, f"{outputs} != {expected}"
+    print("     Passed")
+
+
+def test_generate_n(model_path, device_name, max_new_tokens=16):
+    print("Testing generate_n...")
+    model = llaisys.models.Qwen2(model_path, llaisys_device(device_name), max_seq_len=256)
+    prompt = random_prompt(model, 21, seed=6)
+    expected = model.generate(prompt, max_new_tokens=max_new_tokens, top_k=0, temperature=0.0)[len(prompt) :]
+
+    # Greedy forks of one prefill must not diverge.
+    outputs = model.generate_n(prompt, 2, max_new_tokens=max_new_tokens, top_k=0, temperature=0.0)
+    assert outputs == [expected, expected], f"{outputs} != {[expected, expected]}"
+    print("     Passed")
+
+
+def test_speculative(model_path, device_name, max_new_tokens=24):
+    print("Testing speculative decoding...")
+    model = llaisys.models.Qwen2(model_path, llaisys_device(device_name), max_seq_len=256)
+    # A repeating prompt gives prompt lookup something to draft from.
+    prompt = random_prompt(model, 8, seed=7) * 3
+    expected = model.generate(prompt, max_new_tokens=max_new_tokens)
+
+    draft_model = llaisys.models.Qwen2(model_path, llaisys_device(device_name), max_seq_len=256)
+    for drafter in (None, draft_model):
+        tokens, stats = model.generate_speculative(prompt, max_new_tokens=max_new_tokens, num_draft=4, draft_model=drafter)
+        assert stats["drafted"] > 0
+        assert tokens == expected, f"{tokens} != {expected}"
+    print("     Passed")
+
+
+def test_kv_capacity(model_path, device_name, max_new_tokens=8):
+    print("Testing KV cache capacity...")
+    # Room for three sequences of max_seq_len tokens each.
+    model = llaisys.models.Qwen2(model_path, llaisys_device(device_name), max_seq_len=128, kv_cache_tokens=384)
+    assert model.free_kv_tokens() == 384
+    prompts = [random_prompt(model, 120 - max_new_tokens, seed=s) for s in (8, 9, 10)]
+    expected = [model.generate(prompt, max_new_tokens=max_new_tokens)[len(prompt) :] for prompt in prompts]
+
+    model.set_prefix_caching(False)
+    outputs = run_requests(model, prompts, max_new_tokens)
+    assert outputs == expected, f"{outputs} != {expected}"
+    print("     Passed")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
+    parser.add_argument("--model", default=None, type=str)
+    args = parser.parse_args()
+
+    model_path = load_model_path(args.model)
+    test_preemption(model_path, args.device)
+    test_prefix_caching(model_path, args.device)
+    test_batched_step(model_path, args.device)
+    test_chunked_prefill(model_path, args.device)
+    test_generate_n(model_path, args.device)
+    test_speculative(model_path, args.device)
+    test_kv_capacity(model_path, args.device)
+
+    print("\033[92mTest passed!\033[0m\n")
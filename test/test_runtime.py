@@ -1,5 +1,7 @@
 import llaisys
+from llaisys.libllaisys import LIB_LLAISYS
 import torch
+from ctypes import byref
 from test_utils import *
 import argparse
 
@@ -53,10 +55,64 @@ def test_memcpy(api, size_bytes: int):
     torch.testing.assert_close(a, b)
 
 
+def test_thread_pool():
+    print("Testing thread pool...")
+    llaisys.set_num_threads(2)
+    assert llaisys.get_num_threads() == 2
+    llaisys.set_num_threads(0)
+    assert llaisys.get_num_threads() >= 1
+    print("     Passed")
+
+
+def test_caching_allocator(device_name: str = "cpu"):
+    print("Testing caching allocator...")
+    llaisys.set_allocator(llaisys.AllocatorType.CACHING)
+    # Small and large size classes, released together.
+    sizes = [256, 4096, 100_000, 3 << 20]
+    reserved = None
+    for _ in range(3):
+        tensors = [
+            llaisys.Tensor((n,), dtype=llaisys.DataType.F32, device=llaisys_device(device_name))
+            for n in sizes
+        ]
+        assert llaisys.memory_allocated() >= sum(sizes) * 4
+        del tensors
+        assert llaisys.memory_allocated() == 0
+        # Later rounds are served from the cache.
+        if reserved is None:
+            reserved = llaisys.memory_reserved()
+        assert llaisys.memory_reserved() == reserved
+
+    llaisys.empty_cache()
+    assert llaisys.memory_reserved() == 0
+    print("     Passed")
+
+
+def test_activation_planner():
+    print("Testing activation planner...")
+    # DeepSeek-R1-Distill-Qwen-1.5B in bf16.
+    meta = llaisys.libllaisys.LlaisysQwen2Meta(
+        dtype=llaisys.DataType.BF16, nlayer=28, hs=1536, nh=12, nkvh=2, dh=128,
+        di=8960, maxseq=4096, voc=151936, epsilon=1e-6, theta=10000.0, end_token=151643,
+    )
+    for tokens, seqs in [(1, 1), (16, 16), (512, 8), (2048, 1)]:
+        arena = LIB_LLAISYS.llaisysQwen2ActivationBytes(byref(meta), tokens, seqs)
+        e = 2
+        per_token = 3 * 8 + (5 * meta.hs + 2 * meta.nh * meta.dh + meta.di) * e
+        per_seq = (2 * meta.hs + meta.voc + 1) * e + 8
+        total = tokens * per_token + seqs * per_seq
+        # The logits alone must fit, and buffers with disjoint lifetimes share bytes.
+        assert seqs * meta.voc * e <= arena < total, f"{tokens}/{seqs}: {arena} vs {total}"
+    print("     Passed")
+
+
 if __name__ == "__main__":
     parser = argparse.ArgumentParser()
     parser.add_argument("--device", default="cpu", choices=["cpu", "nvidia"], type=str)
     args = parser.parse_args()
     test_basic_runtime_api(args.device)
+    test_thread_pool()
+    test_caching_allocator(args.device)
+    test_activation_planner()
     
     print("\033[92mTest passed!\033[0m\n")
@@ -4,6 +4,20 @@ set_encodings("utf-8")
 add_includedirs("include")
 
 -- CPU --
+option("cpu-native")
+    set_default(true)
+    set_showmenu(true)
+    set_description("Whether to compile CPU kernels for the host instruction set (AVX2/AVX-512)")
+option_end()
+
+if has_config("cpu-native") then
+    if is_plat("windows") then
+        add_cxflags("/arch:AVX2")
+    else
+        add_cxflags("-march=native")
+    end
+end
+
 includes("xmake/cpu.lua")
 
 -- NVIDIA --
@@ -95,6 +109,22 @@ target("llaisys-ops")
     on_install(function (target) end)
 target_end()
 
+target("llaisys-models")
+    set_kind("static")
+    add_deps("llaisys-tensor")
+    add_deps("llaisys-ops")
+
+    set_languages("cxx17")
+    set_warnings("all", "error")
+    if not is_plat("windows") then
+        add_cxflags("-fPIC", "-Wno-unknown-pragmas")
+    end
+
+    add_files("src/models/*/*.cpp")
+
+    on_install(function (target) end)
+target_end()
+
 target("llaisys")
     set_kind("shared")
     add_deps("llaisys-utils")
@@ -102,10 +132,14 @@ target("llaisys")
     add_deps("llaisys-core")
     add_deps("llaisys-tensor")
     add_deps("llaisys-ops")
+    add_deps("llaisys-models")
 
     set_languages("cxx17")
     set_warnings("all", "error")
     add_files("src/llaisys/*.cc")
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
     set_installdir(".")
 
     